@@ -33,6 +33,9 @@
 
 #include "core/UBDocumentManager.h"
 #include "core/UBApplication.h"
+#include "core/UBPersistenceManager.h"
+
+#include "board/UBBoardController.h"
 
 #include "document/UBDocumentProxy.h"
 #include "document/UBDocumentController.h"
@@ -65,27 +68,35 @@ void UBExportDocument::persist(UBDocumentProxy* pDocumentProxy)
 
 bool UBExportDocument::persistsDocument(UBDocumentProxy* pDocumentProxy, const QString &filename)
 {
-    QuaZip zip(filename);
-    zip.setFileNameCodec("UTF-8");
-    if(!zip.open(QuaZip::mdCreate))
-    {
-        qWarning("Export failed. Cause: zip.open(): %d", zip.getZipError());
-        return false;
-    }
+    // the folder must not change while it is compressed: pages still queued for saving are written first,
+    // the ones saved during the export are written afterwards
+    if (UBApplication::boardController)
+        UBApplication::boardController->stopAutosave();
 
-    QDir documentDir = QDir(pDocumentProxy->persistencePath());
+    UBPersistenceManager::persistenceManager()->suspendPersistence(pDocumentProxy);
 
-    QuaZipFile outFile(&zip);
-    UBFileSystemUtils::compressDirInZip(documentDir, "", &outFile, true, this);
+    UBExportDocumentThread exportThread(pDocumentProxy->persistencePath(), filename);
+    connect(&exportThread, SIGNAL(progress(const QString&, int, int)), this, SLOT(processing(const QString&, int, int)));
 
-    zip.close();
+    // keep painting and showing progress while the document is compressed, but do not let the user change it.
+    // Window manager close requests still get through the loop, the application refuses them meanwhile
+    UBApplication::app()->setClosingBlocked(true);
 
-    if(zip.getZipError() != 0)
-    {
-        qWarning("Export failed. Cause: zip.close(): %d", zip.getZipError());
-        return false;
-    }
+    QEventLoop loop;
+    connect(&exportThread, SIGNAL(finished()), &loop, SLOT(quit()));
+    exportThread.start();
+    loop.exec(QEventLoop::ExcludeUserInputEvents);
+    exportThread.wait();
+
+    UBApplication::app()->setClosingBlocked(false);
 
+    UBPersistenceManager::persistenceManager()->resumePersistence(pDocumentProxy);
+
+    if (UBApplication::boardController)
+        UBApplication::boardController->restartAutosave();
+
+    if (!exportThread.succeeded())
+        return false;
 
     UBPlatformUtils::setFileType(filename, 0x5542647A /* UBdz */);
 
@@ -122,3 +133,48 @@ bool UBExportDocument::associatedActionactionAvailableFor(const QModelIndex &sel
 
     return true;
 }
+
+UBExportDocumentThread::UBExportDocumentThread(const QString& documentPath, const QString& filename, QObject *parent)
+    : QThread(parent)
+    , mDocumentPath(documentPath)
+    , mFilename(filename)
+    , mSucceeded(false)
+{
+    // NOOP
+}
+
+UBExportDocumentThread::~UBExportDocumentThread()
+{
+    wait();
+}
+
+void UBExportDocumentThread::run()
+{
+    QuaZip zip(mFilename);
+    zip.setFileNameCodec("UTF-8");
+    if(!zip.open(QuaZip::mdCreate))
+    {
+        qWarning("Export failed. Cause: zip.open(): %d", zip.getZipError());
+        return;
+    }
+
+    QDir documentDir = QDir(mDocumentPath);
+
+    QuaZipFile outFile(&zip);
+    bool compressed = UBFileSystemUtils::compressDirInZip(documentDir, "", &outFile, true, this);
+
+    zip.close();
+
+    if(zip.getZipError() != 0)
+    {
+        qWarning("Export failed. Cause: zip.close(): %d", zip.getZipError());
+        return;
+    }
+
+    mSucceeded = compressed;
+}
+
+void UBExportDocumentThread::processing(const QString& pObjectName, int pCurrent, int pTotal)
+{
+    emit progress(pObjectName, pCurrent, pTotal);
+}
@@ -31,6 +31,7 @@
 #define UBEXPORTDOCUMENT_H_
 
 #include <QtCore>
+#include <QThread>
 
 #include "UBExportAdaptor.h"
 
@@ -39,6 +40,33 @@
 class UBDocumentProxy;
 
 
+/**
+ * @brief Writes a document folder to an UBZ file, away from the GUI thread
+ */
+class UBExportDocumentThread : public QThread, public UBProcessingProgressListener
+{
+    Q_OBJECT
+
+    public:
+        UBExportDocumentThread(const QString& documentPath, const QString& filename, QObject *parent = 0);
+        virtual ~UBExportDocumentThread();
+
+        void run();
+
+        virtual void processing(const QString& pObjectName, int pCurrent, int pTotal);
+
+        bool succeeded() const {return mSucceeded;}
+
+    signals:
+        void progress(const QString& pObjectName, int pCurrent, int pTotal);
+
+    private:
+        QString mDocumentPath;
+        QString mFilename;
+        bool mSucceeded;
+};
+
+
 class UBExportDocument : public UBExportAdaptor, public UBProcessingProgressListener
 {
     Q_OBJECT
@@ -53,9 +81,10 @@ class UBExportDocument : public UBExportAdaptor, public UBProcessingProgressList
 
         virtual bool persistsDocument(UBDocumentProxy* pDocument, const QString& filename);
 
-        virtual void processing(const QString& pObjectName, int pCurrent, int pTotal);
-
         virtual bool associatedActionactionAvailableFor(const QModelIndex &selectedIndex);
+
+    public slots:
+        virtual void processing(const QString& pObjectName, int pCurrent, int pTotal);
 };
 
 #endif /* UBEXPORTDOCUMENT_H_ */
@@ -32,6 +32,7 @@
 #include <QtCore>
 #include <QtSvg>
 #include <QPrinter>
+#include <QPdfWriter>
 
 #include "core/UBApplication.h"
 #include "core/UBSettings.h"
@@ -48,6 +49,7 @@
 #include "pdf/GraphicsPDFItem.h"
 
 #include "UBExportPDF.h"
+#include "UBSvgSubsetAdaptor.h"
 
 #include <Merger.h>
 #include <Exception.h>
@@ -79,10 +81,132 @@ UBExportFullPDF::~UBExportFullPDF()
 
 void UBExportFullPDF::saveOverlayPdf(UBDocumentProxy* pDocumentProxy, const QString& filename)
 {
+    mPagesMergeInfo.clear();
+
     if (!pDocumentProxy || filename.length() == 0 || pDocumentProxy->pageCount() == 0)
         return;
 
-    mSimpleExporter->persistsDocument(pDocumentProxy, filename);
+    QPdfWriter pdfWriter(filename);
+
+    pdfWriter.setResolution(UBSettings::settings()->pdfResolution->get().toInt());
+    pdfWriter.setPageMargins(QMarginsF());
+    pdfWriter.setTitle(pDocumentProxy->name());
+    pdfWriter.setCreator("OpenBoard PDF export");
+
+    QPainter pdfPainter;
+    bool painterNeedsBegin = true;
+
+    UBPersistenceManager* persistenceManager = UBPersistenceManager::persistenceManager();
+    persistenceManager->flushPendingSaves();
+
+    int existingPageCount = pDocumentProxy->pageCount();
+
+    for(int pageIndex = 0 ; pageIndex < existingPageCount; pageIndex++)
+    {
+        UBApplication::showMessage(tr("Exporting page %1 of %2").arg(pageIndex + 1).arg(existingPageCount));
+
+        // pages which are not in the scene cache are loaded for the export only, so that exporting a long
+        // document does not evict the pages being worked on
+        UBGraphicsScene* scene = persistenceManager->getDocumentScene(pDocumentProxy, pageIndex);
+        bool transientScene = !scene;
+
+        if (transientScene)
+            scene = UBSvgSubsetAdaptor::loadScene(pDocumentProxy, pageIndex);
+
+        if (!scene)
+        {
+            qWarning() << "cannot load page" << pageIndex << "for PDF export";
+            continue;
+        }
+
+        // The merge geometry below places the PDF background relative to the nominal page, so the overlay pages
+        // have the nominal size too. The raster export uses the size of the PDF background instead (sceneSize());
+        // both are the same for pages imported from a PDF at the document's ratio, and differ otherwise.
+        QSize pageSize = scene->nominalSize();
+
+        PageMergeInfo mergeInfo;
+        mergeInfo.pageSize = QSizeF(pageSize.width() * mScaleFactor, pageSize.height() * mScaleFactor);
+        mergeInfo.backgroundPageNumber = 0;
+        mergeInfo.xBackgroundOffset = 0;
+        mergeInfo.yBackgroundOffset = 0;
+        mergeInfo.backgroundScale = 1;
+
+        UBGraphicsPDFItem *pdfItem = qgraphicsitem_cast<UBGraphicsPDFItem*>(scene->backgroundObject());
+
+        if (pdfItem)
+        {
+            mHasPDFBackgrounds = true;
+
+            QString pdfName = UBPersistenceManager::objectDirectory + "/" + pdfItem->fileUuid().toString() + ".pdf";
+            QRectF annotationsRect = scene->annotationsBoundingRect();
+
+            // Original datas
+            double xAnnotation = qRound(annotationsRect.x());
+            double yAnnotation = qRound(annotationsRect.y());
+            double xPdf = qRound(pdfItem->sceneBoundingRect().x());
+            double yPdf = qRound(pdfItem->sceneBoundingRect().y());
+            double hPdf = qRound(pdfItem->sceneBoundingRect().height());
+
+            // Exportation-transformed datas
+            double hScaleFactor = pageSize.width()/annotationsRect.width();
+            double vScaleFactor = pageSize.height()/annotationsRect.height();
+            double scaleFactor = qMin(hScaleFactor, vScaleFactor);
+
+            double hPdfTransformed = qRound(hPdf * scaleFactor);
+
+            // Here, we force the PDF page to be on the topleft corner of the page
+            double xPdfOffset = 0;
+            double yPdfOffset = (hPdf - hPdfTransformed) * mScaleFactor;
+
+            // Now we align the items
+            xPdfOffset += (xPdf - xAnnotation) * scaleFactor * mScaleFactor;
+            yPdfOffset -= (yPdf - yAnnotation) * scaleFactor * mScaleFactor;
+
+            // If the PDF was scaled when added to the scene (e.g if it was loaded from a document with a different DPI
+            // than the current one), it should also be scaled here.
+            mergeInfo.backgroundPath = pDocumentProxy->persistencePath() + "/" + pdfName;
+            mergeInfo.backgroundPageNumber = pdfItem->pageNumber();
+            mergeInfo.xBackgroundOffset = xPdfOffset;
+            mergeInfo.yBackgroundOffset = yPdfOffset;
+            mergeInfo.backgroundScale = scaleFactor * pdfItem->scale();
+        }
+
+        mPagesMergeInfo << mergeInfo;
+
+        // set background to white, no crossing for PDF output
+        bool isDark = scene->isDarkBackground();
+        UBPageBackground pageBackground = scene->pageBackground();
+        scene->setBackground(false, UBPageBackground::plain);
+
+        // the PDF backgrounds are not part of the overlay, they are merged as vectors afterwards
+        scene->setRenderingQuality(UBItem::RenderingQualityHigh);
+        scene->setRenderingContext(UBGraphicsScene::PdfExport);
+
+        pdfWriter.setPageSize(QPageSize(mergeInfo.pageSize, QPageSize::Point));
+
+        // Call begin only once
+        if(painterNeedsBegin)
+            painterNeedsBegin = !pdfPainter.begin(&pdfWriter);
+        else
+            pdfWriter.newPage();
+
+        scene->render(&pdfPainter, QRectF(), scene->normalizedSceneRect());
+
+        if (transientScene)
+        {
+            delete scene;
+        }
+        else
+        {
+            // Restore screen rendering quality and background state
+            scene->setRenderingContext(UBGraphicsScene::Screen);
+            scene->setRenderingQuality(UBItem::RenderingQualityNormal);
+            scene->setBackground(isDark, pageBackground);
+        }
+    }
+
+    if(!painterNeedsBegin)
+        pdfPainter.end();
 }
 
 
@@ -92,11 +216,21 @@ void UBExportFullPDF::persist(UBDocumentProxy* pDocumentProxy)
 }
 
 
+/**
+ * @brief Export a document to PDF, with its PDF backgrounds merged as vectors if PDF/MergeBackgrounds is set
+ *
+ * Otherwise, the document is exported by the raster exporter, as before the merge was enabled. If the merger fails
+ * on any base document, the whole document falls back to the raster export as well.
+ */
 bool UBExportFullPDF::persistsDocument(UBDocumentProxy* pDocumentProxy, const QString& filename)
 {
     QFile file(filename);
     if (file.exists()) file.remove();
 
+    // the alignment of the merged backgrounds hasn't been checked on enough documents to be the default
+    if (!UBSettings::settings()->pdfMergeBackgrounds->get().toBool())
+        return mSimpleExporter->persistsDocument(pDocumentProxy, filename);
+
     QString overlayName = filename;
     overlayName.replace(".pdf", "_overlay.pdf");
 
@@ -122,56 +256,19 @@ bool UBExportFullPDF::persistsDocument(UBDocumentProxy* pDocumentProxy, const QS
 
             MergeDescription mergeInfo;
 
-            int existingPageCount = pDocumentProxy->pageCount();
-
-            for(int pageIndex = 0 ; pageIndex < existingPageCount; pageIndex++)
+            for(int pageIndex = 0 ; pageIndex < mPagesMergeInfo.size(); pageIndex++)
             {
-                UBGraphicsScene* scene = UBPersistenceManager::persistenceManager()->loadDocumentScene(pDocumentProxy, pageIndex);
-                UBGraphicsPDFItem *pdfItem = qgraphicsitem_cast<UBGraphicsPDFItem*>(scene->backgroundObject());
+                const PageMergeInfo& pageInfo = mPagesMergeInfo.at(pageIndex);
 
-                QSize pageSize = scene->nominalSize();
-                
-                if (pdfItem)
+                if (!pageInfo.backgroundPath.isEmpty())
                 {
-                    QString pdfName = UBPersistenceManager::objectDirectory + "/" + pdfItem->fileUuid().toString() + ".pdf";
-                    QString backgroundPath = pDocumentProxy->persistencePath() + "/" + pdfName;
-                    QRectF annotationsRect = scene->annotationsBoundingRect();
-
-                    // Original datas
-                    double xAnnotation = qRound(annotationsRect.x());
-                    double yAnnotation = qRound(annotationsRect.y());
-                    double xPdf = qRound(pdfItem->sceneBoundingRect().x());
-                    double yPdf = qRound(pdfItem->sceneBoundingRect().y());
-                    double hPdf = qRound(pdfItem->sceneBoundingRect().height());
-
-                    // Exportation-transformed datas
-                    double hScaleFactor = pageSize.width()/annotationsRect.width();
-                    double vScaleFactor = pageSize.height()/annotationsRect.height();
-                    double scaleFactor = qMin(hScaleFactor, vScaleFactor);
-
-                    double xAnnotationsOffset = 0;
-                    double yAnnotationsOffset = 0;
-                    double hPdfTransformed = qRound(hPdf * scaleFactor);
-
-                    // Here, we force the PDF page to be on the topleft corner of the page
-                    double xPdfOffset = 0;
-                    double yPdfOffset = (hPdf - hPdfTransformed) * mScaleFactor;
-
-                    // Now we align the items
-                    xPdfOffset += (xPdf - xAnnotation) * scaleFactor * mScaleFactor;
-                    yPdfOffset -= (yPdf - yAnnotation) * scaleFactor * mScaleFactor;
-
-                    // If the PDF was scaled when added to the scene (e.g if it was loaded from a document with a different DPI
-                    // than the current one), it should also be scaled here.
-                    qreal pdfScale = pdfItem->scale();
-
-                    TransformationDescription pdfTransform(xPdfOffset, yPdfOffset, scaleFactor * pdfScale, 0);
-                    TransformationDescription annotationTransform(xAnnotationsOffset, yAnnotationsOffset, 1, 0);
-
-                    MergePageDescription pageDescription(pageSize.width() * mScaleFactor,
-                                                         pageSize.height() * mScaleFactor,
-                                                         pdfItem->pageNumber(),
-                                                         QFile::encodeName(backgroundPath).constData(),
+                    TransformationDescription pdfTransform(pageInfo.xBackgroundOffset, pageInfo.yBackgroundOffset, pageInfo.backgroundScale, 0);
+                    TransformationDescription annotationTransform(0, 0, 1, 0);
+
+                    MergePageDescription pageDescription(pageInfo.pageSize.width(),
+                                                         pageInfo.pageSize.height(),
+                                                         pageInfo.backgroundPageNumber,
+                                                         QFile::encodeName(pageInfo.backgroundPath).constData(),
                                                          pdfTransform,
                                                          pageIndex + 1,
                                                          annotationTransform,
@@ -179,12 +276,13 @@ bool UBExportFullPDF::persistsDocument(UBDocumentProxy* pDocumentProxy, const QS
 
                     mergeInfo.push_back(pageDescription);
 
-                    merger.addBaseDocument(QFile::encodeName(backgroundPath).constData());
+                    // base documents are parsed once, whatever the number of pages using them
+                    merger.addBaseDocument(QFile::encodeName(pageInfo.backgroundPath).constData());
                 }
                 else
                 {
-                    MergePageDescription pageDescription(pageSize.width() * mScaleFactor,
-                             pageSize.height() * mScaleFactor,
+                    MergePageDescription pageDescription(pageInfo.pageSize.width(),
+                             pageInfo.pageSize.height(),
                              0,
                              "",
                              TransformationDescription(),
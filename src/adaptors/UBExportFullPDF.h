@@ -55,8 +55,20 @@ class UBExportFullPDF : public UBExportAdaptor
         void saveOverlayPdf(UBDocumentProxy* pDocumentProxy, const QString& filename);
 
     private:
+        // how a page of the overlay is merged with its PDF background, gathered while the overlay is rendered
+        struct PageMergeInfo
+        {
+            QSizeF pageSize;           // in points
+            QString backgroundPath;    // empty when the page has no PDF background
+            int backgroundPageNumber;
+            double xBackgroundOffset;
+            double yBackgroundOffset;
+            double backgroundScale;
+        };
+
         float mScaleFactor;
         bool mHasPDFBackgrounds;
+        QList<PageMergeInfo> mPagesMergeInfo;
 
         UBExportPDF * mSimpleExporter;
 };
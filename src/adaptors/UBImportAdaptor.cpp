@@ -54,6 +54,13 @@ UBPageBasedImportAdaptor::UBPageBasedImportAdaptor(QObject *parent)
     // NOOP
 }
 
+QImage UBPageBasedImportAdaptor::pageThumbnail(int pageIndex)
+{
+    Q_UNUSED(pageIndex);
+
+    return QImage();
+}
+
 UBDocumentBasedImportAdaptor::UBDocumentBasedImportAdaptor(QObject *parent)
     :UBImportAdaptor(true, parent)
 {
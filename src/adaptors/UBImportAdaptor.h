@@ -64,6 +64,9 @@ public:
         virtual QList<UBGraphicsItem*> import(const QUuid& uuid, const QString& filePath) = 0;
         virtual void placeImportedItemToScene(UBGraphicsScene* scene, UBGraphicsItem* item) = 0;
         virtual const QString& folderToCopy() = 0;
+
+        // thumbnail of an imported page, when the adaptor renders them itself
+        virtual QImage pageThumbnail(int pageIndex);
 };
 
 class UBDocumentBasedImportAdaptor : public UBImportAdaptor
@@ -33,15 +33,18 @@
 
 #include "core/UBApplication.h"
 #include "core/UBPersistenceManager.h"
+#include "core/UBSettings.h"
 
 #include "domain/UBGraphicsPDFItem.h"
 
 #include "pdf/PDFRenderer.h"
+#include "pdf/XPDFRenderer.h"
 
 #include "core/memcheck.h"
 
 UBImportPDF::UBImportPDF(QObject *parent)
     : UBPageBasedImportAdaptor(parent)
+    , mThumbnails(0)
 {
     QDesktopWidget* desktop = UBApplication::desktop();
     this->dpi = (desktop->physicalDpiX() + desktop->physicalDpiY()) / 2;
@@ -50,7 +53,7 @@ UBImportPDF::UBImportPDF(QObject *parent)
 
 UBImportPDF::~UBImportPDF()
 {
-    // NOOP
+    delete mThumbnails;
 }
 
 
@@ -81,6 +84,10 @@ QList<UBGraphicsItem*> UBImportPDF::import(const QUuid& uuid, const QString& fil
 
     int pdfPageCount = pdfRenderer->pageCount();
 
+    // thumbnails are rendered in the background while the pages are created
+    delete mThumbnails;
+    mThumbnails = new XPDFPageBatch(filePath, pdfPageCount, UBSettings::maxThumbnailWidth, this);
+
     for(int pdfPageNumber = 1; pdfPageNumber <= pdfPageCount; pdfPageNumber++)
     {
         UBApplication::showMessage(tr("Importing page %1 of %2").arg(pdfPageNumber).arg(pdfPageCount), true);
@@ -100,6 +107,14 @@ void UBImportPDF::placeImportedItemToScene(UBGraphicsScene* scene, UBGraphicsIte
     scene->setNominalSize(pdfItem->boundingRect().width(), pdfItem->boundingRect().height());
 }
 
+QImage UBImportPDF::pageThumbnail(int pageIndex)
+{
+    if (!mThumbnails)
+        return QImage();
+
+    return mThumbnails->takeImage(pageIndex + 1);
+}
+
 const QString& UBImportPDF::folderToCopy()
 {
     return UBPersistenceManager::objectDirectory;
@@ -34,6 +34,7 @@
 #include "UBImportAdaptor.h"
 
 class UBDocumentProxy;
+class XPDFPageBatch;
 
 class UBImportPDF : public UBPageBasedImportAdaptor
 {
@@ -49,9 +50,11 @@ class UBImportPDF : public UBPageBasedImportAdaptor
         virtual QList<UBGraphicsItem*> import(const QUuid& uuid, const QString& filePath);
         virtual void placeImportedItemToScene(UBGraphicsScene* scene, UBGraphicsItem* item);
         virtual const QString& folderToCopy();
+        virtual QImage pageThumbnail(int pageIndex);
 
     private:
         int dpi;
+        XPDFPageBatch* mThumbnails;
 };
 
 #endif /* UBIMPORTPDF_H_ */
@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2015-2018 Département de l'Instruction Publique (DIP-SEM)
+ *
+ * Copyright (C) 2013 Open Education Foundation
+ *
+ * Copyright (C) 2010-2013 Groupement d'Intérêt Public pour
+ * l'Education Numérique en Afrique (GIP ENA)
+ *
+ * This file is part of OpenBoard.
+ *
+ * OpenBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License,
+ * with a specific linking exception for the OpenSSL project's
+ * "OpenSSL" library (or with modified versions of it that use the
+ * same license as the "OpenSSL" library).
+ *
+ * OpenBoard is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenBoard. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#include "UBPageOrderAdaptor.h"
+
+#include <QSaveFile>
+
+#include "core/UBSettings.h"
+
+#include "frameworks/UBFileSystemUtils.h"
+
+#include "core/memcheck.h"
+
+const QString UBPageOrderAdaptor::pageOrderFilename = "pages.xml";
+
+
+/**
+ * @brief Return the file numbers of the pages of a document, in page order
+ *
+ * Pages missing from the manifest, e.g. because the document has the legacy layout or was edited by a
+ * version that doesn't know about the manifest, follow in the order of their file numbers.
+ */
+QList<int> UBPageOrderAdaptor::load(const QString& pDocumentPath)
+{
+    QList<int> existing = existingPageFiles(pDocumentPath);
+    QSet<int> remaining = existing.toSet();
+
+    QList<int> pageFiles;
+
+    QFile file(pDocumentPath + "/" + pageOrderFilename);
+
+    if (file.exists() && file.open(QIODevice::ReadOnly))
+    {
+        QXmlStreamReader xmlReader(&file);
+
+        while (!xmlReader.atEnd())
+        {
+            xmlReader.readNext();
+
+            if (xmlReader.isStartElement() && xmlReader.name() == "page")
+            {
+                bool ok = false;
+                int pageFile = xmlReader.attributes().value("file").toString().toInt(&ok);
+
+                if (ok && remaining.remove(pageFile))
+                    pageFiles << pageFile;
+            }
+        }
+
+        if (xmlReader.hasError())
+            qWarning() << "Error reading page order of" << pDocumentPath << ":" << xmlReader.errorString();
+
+        file.close();
+    }
+
+    foreach(int pageFile, existing)
+    {
+        if (remaining.contains(pageFile))
+            pageFiles << pageFile;
+    }
+
+    return pageFiles;
+}
+
+
+/**
+ * @brief Write the page order of a document
+ *
+ * Nothing is written when the pages are in the order of their file numbers: the manifest is removed so
+ * that the document keeps the layout older versions can read.
+ */
+bool UBPageOrderAdaptor::persist(const QString& pDocumentPath, const QList<int>& pPageFiles)
+{
+    QString fileName = pDocumentPath + "/" + pageOrderFilename;
+
+    QList<int> sortedPageFiles = pPageFiles;
+    qSort(sortedPageFiles);
+
+    if (pPageFiles == sortedPageFiles)
+    {
+        if (QFile::exists(fileName) && !QFile::remove(fileName))
+        {
+            qCritical() << "cannot remove " << fileName;
+            return false;
+        }
+
+        return true;
+    }
+
+    QSaveFile file(fileName);
+
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qCritical() << "cannot open " << fileName << " for writing ...";
+        return false;
+    }
+
+    QXmlStreamWriter xmlWriter(&file);
+    xmlWriter.setAutoFormatting(true);
+
+    xmlWriter.writeStartDocument();
+    xmlWriter.writeDefaultNamespace(UBSettings::uniboardDocumentNamespaceUri);
+    xmlWriter.writeStartElement("pages");
+
+    foreach(int pageFile, pPageFiles)
+    {
+        xmlWriter.writeEmptyElement("page");
+        xmlWriter.writeAttribute("file", QString::number(pageFile));
+    }
+
+    xmlWriter.writeEndElement();
+    xmlWriter.writeEndDocument();
+
+    if (!file.commit())
+    {
+        qCritical() << "cannot write " << fileName;
+        return false;
+    }
+
+    return true;
+}
+
+
+QString UBPageOrderAdaptor::sceneFileName(const QString& pDocumentPath, int pPageFile)
+{
+    return pDocumentPath + UBFileSystemUtils::digitFileFormat("/page%1.svg", pPageFile);
+}
+
+
+QString UBPageOrderAdaptor::thumbnailFileName(const QString& pDocumentPath, int pPageFile)
+{
+    return pDocumentPath + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.jpg", pPageFile);
+}
+
+
+/**
+ * @brief Return the numbers of the page files of a document, sorted
+ *
+ * A single directory listing is used rather than probing every page file, which is slow on network shares.
+ */
+QList<int> UBPageOrderAdaptor::existingPageFiles(const QString& pDocumentPath)
+{
+    QList<int> pageFiles;
+
+    if (pDocumentPath.isEmpty())
+        return pageFiles;
+
+    QRegExp pageFileName("^page(\\d+)\\.svg$");
+
+    foreach(QString fileName, QDir(pDocumentPath).entryList(QStringList() << "page*.svg", QDir::Files))
+    {
+        if (pageFileName.exactMatch(fileName))
+            pageFiles << pageFileName.cap(1).toInt();
+    }
+
+    qSort(pageFiles);
+
+    return pageFiles;
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2015-2018 Département de l'Instruction Publique (DIP-SEM)
+ *
+ * Copyright (C) 2013 Open Education Foundation
+ *
+ * Copyright (C) 2010-2013 Groupement d'Intérêt Public pour
+ * l'Education Numérique en Afrique (GIP ENA)
+ *
+ * This file is part of OpenBoard.
+ *
+ * OpenBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License,
+ * with a specific linking exception for the OpenSSL project's
+ * "OpenSSL" library (or with modified versions of it that use the
+ * same license as the "OpenSSL" library).
+ *
+ * OpenBoard is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenBoard. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#ifndef UBPAGEORDERADAPTOR_H_
+#define UBPAGEORDERADAPTOR_H_
+
+#include <QtCore>
+
+/**
+ * @brief Reads and writes the order of the pages of a document
+ *
+ * Pages are stored in pageNNN.svg files whose number doesn't change when pages are inserted, moved or
+ * deleted. When the pages are not in the order of their file numbers, the order is kept in a manifest
+ * next to the pages, so documents that were never reordered keep the legacy layout.
+ */
+class UBPageOrderAdaptor
+{
+    public:
+        static QList<int> load(const QString& pDocumentPath);
+        static bool persist(const QString& pDocumentPath, const QList<int>& pPageFiles);
+
+        static QString sceneFileName(const QString& pDocumentPath, int pPageFile);
+        static QString thumbnailFileName(const QString& pDocumentPath, int pPageFile);
+
+        static const QString pageOrderFilename;
+
+    private:
+        static QList<int> existingPageFiles(const QString& pDocumentPath);
+};
+
+#endif /* UBPAGEORDERADAPTOR_H_ */
@@ -32,7 +32,6 @@
 #include <QtCore>
 #include <QtXml>
 #include <QGraphicsTextItem>
-#include <QDomElement>
 #include <QGraphicsVideoItem>
 
 #include "domain/UBGraphicsSvgItem.h"
@@ -96,6 +95,231 @@ const QString tStrokeGroup = "strokeGroup";
 const QString tGroups = "groups";
 const QString aId = "id";
 
+// coordinates keep this many significant digits, like the former QString::arg() formatting, with at most
+// sSvgMaxDecimals decimals; trailing zeros are dropped
+static const int sSvgSignificantDigits = 6;
+static const int sSvgMaxDecimals = 6;
+static const qint64 sPowersOfTen[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+// larger coordinates would overflow the fixed point conversion, no scene gets anywhere near
+static const qreal sSvgMaxMagnitude = 1e15;
+
+// longest coordinate: sign, 16 integral digits, decimal point and decimals
+static const int sSvgNumberMaxLength = 1 + 16 + 1 + sSvgMaxDecimals;
+
+/**
+ * @brief Number of decimals giving @a magnitude sSvgSignificantDigits significant digits
+ */
+static int svgDecimals(qreal magnitude)
+{
+    int decimals = 0;
+    while (decimals < sSvgMaxDecimals && magnitude * sPowersOfTen[decimals] < sPowersOfTen[sSvgSignificantDigits - 1])
+        decimals++;
+
+    return decimals;
+}
+
+/**
+ * @brief Write a coordinate with six significant digits at @a out, without any intermediate string.
+ * @return the position following the last written character
+ */
+static char* writeSvgNumber(char* out, qreal value)
+{
+    if (!qIsFinite(value))
+        value = 0;
+
+    qreal magnitude = qMin(qAbs(value), sSvgMaxMagnitude);
+    int decimals = svgDecimals(magnitude);
+    qint64 scale = sPowersOfTen[decimals];
+
+    quint64 scaled = qRound64(magnitude * scale);
+
+    if (scaled && value < 0)
+        *out++ = '-';
+
+    quint64 integral = scaled / scale;
+    quint64 fraction = scaled % scale;
+
+    char digits[20];
+    int count = 0;
+    do
+    {
+        digits[count++] = '0' + integral % 10;
+        integral /= 10;
+    } while (integral);
+
+    while (count)
+        *out++ = digits[--count];
+
+    if (fraction)
+    {
+        *out++ = '.';
+
+        for (int i = decimals - 1; i >= 0; i--)
+        {
+            out[i] = '0' + fraction % 10;
+            fraction /= 10;
+        }
+
+        int length = decimals;
+        while (out[length - 1] == '0')
+            length--;
+
+        out += length;
+    }
+
+    return out;
+}
+
+/**
+ * @brief Append @a value to @a data as a zigzag mapped LEB128 varint
+ */
+static void appendPackedValue(QByteArray& data, qint64 value)
+{
+    quint64 encoded = (static_cast<quint64>(value) << 1) ^ static_cast<quint64>(value >> 63);
+
+    while (encoded >= 0x80)
+    {
+        data.append(static_cast<char>((encoded & 0x7f) | 0x80));
+        encoded >>= 7;
+    }
+    data.append(static_cast<char>(encoded));
+}
+
+/**
+ * @brief Encode a point list for the ub:packed-points attribute.
+ *
+ * The first value gives the number of decimals kept, the one the text format needs for the most
+ * precise coordinate of the list, so packing loses no more than writing the points attribute.
+ * Coordinates are then quantized, delta-encoded against the previous point, zigzag-mapped and
+ * written as LEB128 varints; the resulting bytes are base64 encoded. Consecutive stroke points are
+ * close to each other, so most coordinates fit in one or two bytes.
+ */
+QString UBSvgSubsetAdaptor::packPoints(const QVector<QPointF>& points)
+{
+    if (points.isEmpty())
+        return QString();
+
+    int decimals = 0;
+    foreach(const QPointF& point, points)
+    {
+        decimals = qMax(decimals, svgDecimals(qMin(qAbs(point.x()), sSvgMaxMagnitude)));
+        decimals = qMax(decimals, svgDecimals(qMin(qAbs(point.y()), sSvgMaxMagnitude)));
+    }
+
+    qreal scale = sPowersOfTen[decimals];
+
+    QByteArray data;
+    data.reserve(1 + points.size() * 6);
+
+    appendPackedValue(data, decimals);
+
+    qint64 previous[2] = {0, 0};
+
+    foreach(const QPointF& point, points)
+    {
+        qreal x = qIsFinite(point.x()) ? qBound(-sSvgMaxMagnitude, point.x(), sSvgMaxMagnitude) : 0;
+        qreal y = qIsFinite(point.y()) ? qBound(-sSvgMaxMagnitude, point.y(), sSvgMaxMagnitude) : 0;
+        qint64 current[2] = {qRound64(x * scale), qRound64(y * scale)};
+
+        for (int i = 0; i < 2; i++)
+        {
+            appendPackedValue(data, current[i] - previous[i]);
+            previous[i] = current[i];
+        }
+    }
+
+    return QString::fromLatin1(data.toBase64());
+}
+
+/**
+ * @brief Format a stroke point list as the value of its points attribute, or of its ub:packed-points attribute
+ * if @a compact is set
+ *
+ * @a buffer is reused between calls, so that a page is written with a single allocation.
+ */
+QByteArray UBSvgSubsetAdaptor::pointsAttributeValue(QVector<QPointF> points, bool compact, QByteArray& buffer)
+{
+    UBGeometryUtils::crashPointList(points);
+
+    if (compact)
+        return packPoints(points).toLatin1();
+
+    // "x,y " per point
+    int capacity = points.size() * (2 * sSvgNumberMaxLength + 2);
+    if (buffer.size() < capacity)
+        buffer.resize(capacity);
+
+    char* begin = buffer.data();
+    char* out = begin;
+
+    foreach(const QPointF& point, points)
+    {
+        out = writeSvgNumber(out, point.x());
+        *out++ = ',';
+        out = writeSvgNumber(out, point.y());
+        *out++ = ' ';
+    }
+
+    return QByteArray(begin, out - begin);
+}
+
+
+bool UBSvgSubsetAdaptor::unpackPoints(const QStringRef& packedPoints, QVector<QPointF>& points)
+{
+    QByteArray data = QByteArray::fromBase64(packedPoints.toLatin1());
+
+    if (data.isEmpty())
+        return true;
+
+    qint64 current[2] = {0, 0};
+    qreal scale = 0;
+    int coordinate = 0;
+    quint64 value = 0;
+    int shift = 0;
+
+    points.reserve(points.size() + data.size() / 4);
+
+    for (int i = 0; i < data.size(); i++)
+    {
+        quint8 byte = static_cast<quint8>(data.at(i));
+
+        if (shift > 63)
+            return false;
+
+        value |= static_cast<quint64>(byte & 0x7f) << shift;
+        shift += 7;
+
+        if (byte & 0x80)
+            continue;
+
+        qint64 decoded = static_cast<qint64>(value >> 1) ^ -static_cast<qint64>(value & 1);
+        value = 0;
+        shift = 0;
+
+        // the leading value holds the number of decimals
+        if (scale == 0)
+        {
+            if (decoded < 0 || decoded > sSvgMaxDecimals)
+                return false;
+
+            scale = sPowersOfTen[decoded];
+            continue;
+        }
+
+        current[coordinate] += decoded;
+
+        if (coordinate == 1)
+            points << QPointF(current[0] / scale, current[1] / scale);
+
+        coordinate = 1 - coordinate;
+    }
+
+    // a truncated stream leaves a pending byte sequence or a lone x coordinate
+    return shift == 0 && coordinate == 0;
+}
+
+
 QString UBSvgSubsetAdaptor::toSvgTransform(const QMatrix& matrix)
 {
     return QString("matrix(%1, %2, %3, %4, %5, %6)")
@@ -142,9 +366,7 @@ static bool itemZIndexComp(const QGraphicsItem* item1,
 void UBSvgSubsetAdaptor::upgradeScene(UBDocumentProxy* proxy, const int pageIndex)
 {
     //4.2
-    QDomDocument doc = loadSceneDocument(proxy, pageIndex);
-    QDomElement elSvg = doc.documentElement(); // SVG tag
-    QString ubVersion = elSvg.attributeNS(UBSettings::uniboardDocumentNamespaceUri, "version", "4.1"); // default to 4.1
+    QString ubVersion = sceneMetadata(proxy, pageIndex).version;
 
     if (ubVersion.startsWith("4.1") || ubVersion.startsWith("4.2") || ubVersion.startsWith("4.3"))
     {
@@ -156,32 +378,9 @@ void UBSvgSubsetAdaptor::upgradeScene(UBDocumentProxy* proxy, const int pageInde
 }
 
 
-QDomDocument UBSvgSubsetAdaptor::loadSceneDocument(UBDocumentProxy* proxy, const int pPageIndex)
-{
-    QString fileName = proxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.svg",pPageIndex);
-
-    QFile file(fileName);
-    QDomDocument doc("page");
-
-    if (file.exists())
-    {
-        if (!file.open(QIODevice::ReadOnly))
-        {
-            qWarning() << "Cannot open file " << fileName << " for reading ...";
-            return doc;
-        }
-
-        doc.setContent(&file, true);
-        file.close();
-    }
-
-    return doc;
-}
-
-
 void UBSvgSubsetAdaptor::setSceneUuid(UBDocumentProxy* proxy, const int pageIndex, QUuid pUuid)
 {
-    QString fileName = proxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.svg",pageIndex);
+    QString fileName = UBPersistenceManager::persistenceManager()->sceneFileName(proxy, pageIndex);
 
     QFile file(fileName);
 
@@ -238,7 +437,7 @@ QString UBSvgSubsetAdaptor::uniboardDocumentNamespaceUriFromVersion(int mFileVer
 
 UBGraphicsScene* UBSvgSubsetAdaptor::loadScene(UBDocumentProxy* proxy, const int pageIndex)
 {
-    QString fileName = proxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.svg", pageIndex);
+    QString fileName = UBPersistenceManager::persistenceManager()->sceneFileName(proxy, pageIndex);
     qDebug() << fileName;
     QFile file(fileName);
 
@@ -263,7 +462,7 @@ UBGraphicsScene* UBSvgSubsetAdaptor::loadScene(UBDocumentProxy* proxy, const int
 
 QByteArray UBSvgSubsetAdaptor::loadSceneAsText(UBDocumentProxy* proxy, const int pageIndex)
 {
-    QString fileName = proxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.svg", pageIndex);
+    QString fileName = UBPersistenceManager::persistenceManager()->sceneFileName(proxy, pageIndex);
     qDebug() << fileName;
     QFile file(fileName);
 
@@ -284,64 +483,185 @@ QByteArray UBSvgSubsetAdaptor::loadSceneAsText(UBDocumentProxy* proxy, const int
 }
 
 
-QUuid UBSvgSubsetAdaptor::sceneUuid(UBDocumentProxy* proxy, const int pageIndex)
+UBSvgSubsetAdaptor::SceneMetadata UBSvgSubsetAdaptor::sceneMetadata(UBDocumentProxy* proxy, const int pageIndex)
 {
-    QString fileName = proxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.svg", pageIndex);
+    QString fileName = UBPersistenceManager::persistenceManager()->sceneFileName(proxy, pageIndex);
 
     QFile file(fileName);
 
-    QUuid uuid;
+    SceneMetadata metadata;
 
-    if (file.exists())
+    if (!file.exists())
+        return metadata;
+
+    if (!file.open(QIODevice::ReadOnly))
     {
-        if (!file.open(QIODevice::ReadOnly))
-        {
-            qWarning() << "Cannot open file " << fileName << " for reading ...";
-            return 0;
-        }
+        qWarning() << "Cannot open file " << fileName << " for reading ...";
+        return metadata;
+    }
 
-        QXmlStreamReader xml(file.readAll());
+    // Only the root element is needed: read straight from the device and stop at the first start
+    // element, so that the cost does not depend on the size of the page content
+    QXmlStreamReader xml(&file);
 
-        bool foundSvg = false;
+    while (!xml.atEnd())
+    {
+        xml.readNext();
+
+        if (!xml.isStartElement())
+            continue;
 
-        while (!xml.atEnd() && !foundSvg)
+        if (xml.name() == "svg")
         {
-            xml.readNext();
+            QXmlStreamAttributes attributes = xml.attributes();
 
-            if (xml.isStartElement())
-            {
-                if (xml.name() == "svg")
-                {
-                    QStringRef svgSceneUuid = xml.attributes().value(UBSettings::uniboardDocumentNamespaceUri, "uuid");
-                    if (svgSceneUuid.isNull())
-                        svgSceneUuid = xml.attributes().value("http://www.mnemis.com/uniboard", "uuid");
+            QString namespaceUri = UBSettings::uniboardDocumentNamespaceUri;
+            if (!attributes.hasAttribute(namespaceUri, "uuid") && !attributes.hasAttribute(namespaceUri, "version"))
+                namespaceUri = sFormerUniboardDocumentNamespaceUri;
 
-                    if (!svgSceneUuid.isNull())
-                        uuid = QUuid(svgSceneUuid.toString());
+            QStringRef svgSceneUuid = attributes.value(namespaceUri, "uuid");
+            if (!svgSceneUuid.isNull())
+                metadata.uuid = QUuid(svgSceneUuid.toString());
 
-                    foundSvg = true;
-                }
-            }
+            // pages written before the version attribute existed are 4.1
+            metadata.version = attributes.value(UBSettings::uniboardDocumentNamespaceUri, "version").toString();
+            if (metadata.version.isEmpty())
+                metadata.version = "4.1";
+
+            metadata.isValid = true;
         }
 
-        file.close();
+        break;
     }
 
-    return uuid;
+    if (xml.hasError() && !metadata.isValid)
+        qWarning() << "Cannot read page attributes from" << fileName << ":" << xml.errorString();
+
+    file.close();
+
+    return metadata;
+}
+
+
+QUuid UBSvgSubsetAdaptor::sceneUuid(UBDocumentProxy* proxy, const int pageIndex)
+{
+    return sceneMetadata(proxy, pageIndex).uuid;
 }
 
 
 UBGraphicsScene* UBSvgSubsetAdaptor::loadScene(UBDocumentProxy* proxy, const QByteArray& pArray)
 {
-    UBSvgSubsetReader reader(proxy, UBTextTools::cleanHtmlCData(QString(pArray)).toUtf8());
+    UBSvgSubsetReader reader(proxy, cleanSceneData(pArray));
+    return reader.loadScene(proxy);
+}
+
+/**
+ * @brief Build a scene from page data prepared off the GUI thread
+ * @param pCleanedArray the page content, as returned by cleanSceneData
+ * @param pDecodedImages the page bitmaps, as returned by decodeSceneImages
+ */
+UBGraphicsScene* UBSvgSubsetAdaptor::loadScene(UBDocumentProxy* proxy, const QByteArray& pCleanedArray, const QHash<QString, QImage>& pDecodedImages)
+{
+    UBSvgSubsetReader reader(proxy, pCleanedArray, pDecodedImages);
     return reader.loadScene(proxy);
 }
 
-UBSvgSubsetAdaptor::UBSvgSubsetReader::UBSvgSubsetReader(UBDocumentProxy* pProxy, const QByteArray& pXmlData)
+QByteArray UBSvgSubsetAdaptor::cleanSceneData(const QByteArray& pArray)
+{
+    return UBTextTools::cleanHtmlCData(QString(pArray)).toUtf8();
+}
+
+/**
+ * @brief Decode the bitmaps referenced by a page
+ *
+ * Only uses QImage, so it can run on any thread; the result is meant to be given to loadScene.
+ */
+QHash<QString, QImage> UBSvgSubsetAdaptor::decodeSceneImages(const QString& documentPath, const QByteArray& pCleanedArray)
+{
+    QHash<QString, QImage> images;
+
+    QXmlStreamReader xml(pCleanedArray);
+
+    while (!xml.atEnd())
+    {
+        xml.readNext();
+
+        if (xml.isStartElement() && xml.name() == "image")
+        {
+            QString href = xml.attributes().value(nsXLink, "href").toString();
+
+            // same test as the reader uses to create pixmap items
+            if (href.contains("png"))
+            {
+                QString path = documentPath + "/" + UBFileSystemUtils::normalizeFilePath(href);
+
+                if (!images.contains(path))
+                {
+                    QImage image(path);
+                    if (!image.isNull())
+                        images.insert(path, image);
+                }
+            }
+        }
+    }
+
+    return images;
+}
+
+/**
+ * @brief Return the files of its document a page refers to, relative to the document directory
+ *
+ * The page is only scanned, no scene is created. The list covers the media, images, widgets and PDF files
+ * referenced by the items of the page.
+ */
+QStringList UBSvgSubsetAdaptor::sceneDependencies(const QByteArray& pCleanedArray)
+{
+    QStringList directories;
+    directories << UBPersistenceManager::imageDirectory << UBPersistenceManager::objectDirectory
+                << UBPersistenceManager::widgetDirectory << UBPersistenceManager::videoDirectory
+                << UBPersistenceManager::audioDirectory << UBPersistenceManager::fileDirectory;
+
+    QStringList dependencies;
+
+    QXmlStreamReader xml(pCleanedArray);
+
+    while (!xml.atEnd())
+    {
+        xml.readNext();
+
+        if (!xml.isStartElement())
+            continue;
+
+        foreach(QXmlStreamAttribute attribute, xml.attributes())
+        {
+            if (attribute.name() != "href" && attribute.name() != "src")
+                continue;
+
+            // PDF pages are referenced as file.pdf#page=n
+            QString path = UBFileSystemUtils::normalizeFilePath(attribute.value().toString()).section('#', 0, 0);
+            QString directory = path.section('/', 0, 0);
+
+            if (!directories.contains(directory) || dependencies.contains(path))
+                continue;
+
+            dependencies << path;
+
+            // widgets are saved along with a screenshot
+            if (directory == UBPersistenceManager::widgetDirectory && path.endsWith(".wgt"))
+                dependencies << directory + "/" + QFileInfo(path).completeBaseName().remove("{").remove("}") + ".png";
+        }
+    }
+
+    return dependencies;
+}
+
+UBSvgSubsetAdaptor::UBSvgSubsetReader::UBSvgSubsetReader(UBDocumentProxy* pProxy, const QByteArray& pXmlData,
+                                                         const QHash<QString, QImage>& pDecodedImages)
     : mXmlReader(pXmlData)
     , mProxy(pProxy)
     , mDocumentPath(pProxy->persistencePath())
     , mGroupHasInfo(false)
+    , mDecodedImages(pDecodedImages)
 {
     // NOOP
 }
@@ -1086,12 +1406,63 @@ void UBSvgSubsetAdaptor::persistScene(UBDocumentProxy* proxy, UBGraphicsScene* p
     writer.persistScene(proxy, pageIndex);
 }
 
+QByteArray UBSvgSubsetAdaptor::serializeScene(UBDocumentProxy* proxy, UBGraphicsScene* pScene, const int pageIndex)
+{
+    UBSvgSubsetWriter writer(proxy, pScene, pageIndex);
+    return writer.serializeScene(proxy);
+}
+
+/**
+ * @brief Serialize a page, leaving the formatting of its stroke points to serializeSnapshot()
+ *
+ * This needs the scene and must be done on the GUI thread. The snapshot only holds values: it can be completed on
+ * any thread while the scene is being modified.
+ */
+UBSvgSubsetAdaptor::SceneSnapshot UBSvgSubsetAdaptor::snapshotScene(UBDocumentProxy* proxy, UBGraphicsScene* pScene, const int pageIndex)
+{
+    UBSvgSubsetWriter writer(proxy, pScene, pageIndex);
+    return writer.snapshotScene(proxy);
+}
+
+/**
+ * @brief Return the content of the page file of a snapshot, with the points of its strokes formatted
+ */
+QByteArray UBSvgSubsetAdaptor::serializeSnapshot(const SceneSnapshot& snapshot)
+{
+    if (snapshot.points.isEmpty())
+        return snapshot.data;
+
+    QByteArray buffer;
+    QByteArray result;
+    result.reserve(snapshot.data.size() + snapshot.points.size() * 64);
+
+    // the markers appear in the same order as the point lists were recorded
+    int from = 0;
+    foreach(const QVector<QPointF>& points, snapshot.points)
+    {
+        int at = snapshot.data.indexOf(snapshot.pointsMarker, from);
+        if (at < 0)
+        {
+            qWarning() << "stroke points missing in scene snapshot";
+            break;
+        }
+
+        result.append(snapshot.data.constData() + from, at - from);
+        result.append(pointsAttributeValue(points, snapshot.compactPoints, buffer));
+        from = at + snapshot.pointsMarker.size();
+    }
+
+    result.append(snapshot.data.constData() + from, snapshot.data.size() - from);
+
+    return result;
+}
+
 
 UBSvgSubsetAdaptor::UBSvgSubsetWriter::UBSvgSubsetWriter(UBDocumentProxy* proxy, UBGraphicsScene* pScene, const int pageIndex)
     : mScene(pScene)
     , mDocumentPath(proxy->persistencePath())
     , mPageIndex(pageIndex)
-
+    , mCompactPoints(UBSettings::settings()->svgCompactStrokes->get().toBool())
 {
     // NOOP
 }
@@ -1154,10 +1525,27 @@ bool UBSvgSubsetAdaptor::UBSvgSubsetWriter::persistScene(UBDocumentProxy* proxy,
 {
     Q_UNUSED(pageIndex);
 
-    //Creating dom structure to store information
-    QDomDocument groupDomDocument;
-    QDomElement groupRoot = groupDomDocument.createElement(tGroups);
-    groupDomDocument.appendChild(groupRoot);
+    QByteArray data = serializeScene(proxy);
+
+    QString fileName = UBPersistenceManager::persistenceManager()->sceneFileName(proxy, mPageIndex);
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qCritical() << "cannot open " << fileName << " for writing ...";
+        return false;
+    }
+    file.write(data);
+    file.flush();
+    file.close();
+
+    return true;
+}
+
+QByteArray UBSvgSubsetAdaptor::UBSvgSubsetWriter::serializeScene(UBDocumentProxy* proxy)
+{
+    // groups reference their members by uuid, they are written after all the items
+    QList<QGraphicsItem*> groupItems;
 
     QBuffer buffer;
     buffer.open(QBuffer::WriteOnly);
@@ -1389,7 +1777,7 @@ bool UBSvgSubsetAdaptor::UBSvgSubsetWriter::persistScene(UBDocumentProxy* proxy,
         UBGraphicsGroupContainerItem *groupItem = qgraphicsitem_cast<UBGraphicsGroupContainerItem*>(item);
         if (groupItem && groupItem->isVisible())
         {
-            persistGroupToDom(groupItem, &groupRoot, &groupDomDocument);
+            groupItems << groupItem;
             continue;
         }
     }
@@ -1402,81 +1790,68 @@ bool UBSvgSubsetAdaptor::UBSvgSubsetWriter::persistScene(UBDocumentProxy* proxy,
     }
 
     //writing group data
-    if (groupRoot.hasChildNodes()) {
+    if (!groupItems.isEmpty()) {
         mXmlWriter.writeStartElement(tGroups);
-        QDomElement curElement = groupRoot.firstChildElement();
-        while (!curElement.isNull()) {
-            if (curElement.hasAttribute(aId)) {
-                mXmlWriter.writeStartElement(curElement.tagName());
-                mXmlWriter.writeAttribute(aId, curElement.attribute(aId));
-                if(curElement.hasAttribute("locked")){
-                    mXmlWriter.writeAttribute(UBSettings::uniboardDocumentNamespaceUri,"locked",curElement.attribute("locked"));
-                }
-                if(curElement.hasAttribute("layer")){
-                    mXmlWriter.writeAttribute(UBSettings::uniboardDocumentNamespaceUri,"layer",curElement.attribute("layer"));
-                }
-
-                QDomElement curSubElement = curElement.firstChildElement();
-                while (!curSubElement.isNull()) {
-                    if (curSubElement.hasAttribute(aId)) {
-                        mXmlWriter.writeStartElement(curSubElement.tagName());
-                        mXmlWriter.writeAttribute(aId, curSubElement.attribute(aId));
-                        mXmlWriter.writeEndElement();
-                        curSubElement = curSubElement.nextSiblingElement();
-                    }
-                }
-                mXmlWriter.writeEndElement();
-            }
-            curElement = curElement.nextSiblingElement();
-        }
+        foreach (QGraphicsItem *groupItem, groupItems)
+            groupToSvg(groupItem);
         mXmlWriter.writeEndElement();
     }
 
     mXmlWriter.writeEndDocument();
-    QString fileName = mDocumentPath + UBFileSystemUtils::digitFileFormat("/page%1.svg", mPageIndex);
-    QFile file(fileName);
 
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
-    {
-        qCritical() << "cannot open " << fileName << " for writing ...";
-        return false;
-    }
-    file.write(buffer.data());
-    file.flush();
-    file.close();
+    return buffer.data();
+}
 
-    return true;
+UBSvgSubsetAdaptor::SceneSnapshot UBSvgSubsetAdaptor::UBSvgSubsetWriter::snapshotScene(UBDocumentProxy* proxy)
+{
+    // a fresh uuid can't appear in the page content, nor need any XML escaping
+    mPointsMarker = QUuid::createUuid().toString();
+    mDeferredPoints.clear();
+
+    SceneSnapshot snapshot;
+    snapshot.data = serializeScene(proxy);
+    snapshot.pointsMarker = mPointsMarker.toLatin1();
+    snapshot.points = mDeferredPoints;
+    snapshot.compactPoints = mCompactPoints;
+
+    mPointsMarker.clear();
+    mDeferredPoints.clear();
+
+    return snapshot;
 }
 
-void UBSvgSubsetAdaptor::UBSvgSubsetWriter::persistGroupToDom(QGraphicsItem *groupItem, QDomElement *curParent, QDomDocument *groupDomDocument)
+void UBSvgSubsetAdaptor::UBSvgSubsetWriter::groupToSvg(QGraphicsItem *groupItem)
 {
     QUuid uuid = UBGraphicsScene::getPersonalUuid(groupItem);
-    if (!uuid.isNull()) {
-        QDomElement curGroupElement = groupDomDocument->createElement(tGroup);
-        curGroupElement.setAttribute(aId, uuid.toString());
-        UBGraphicsGroupContainerItem* group = dynamic_cast<UBGraphicsGroupContainerItem*>(groupItem);
-        if(group && group->Delegate()){
-            if(group->Delegate()->isLocked())
-                curGroupElement.setAttribute("locked", xmlTrue);
-            else
-                curGroupElement.setAttribute("locked", xmlFalse);
+    if (uuid.isNull())
+        return;
 
-            curGroupElement.setAttribute("layer", group->data(UBGraphicsItemData::ItemLayerType).toString());
-        }
-        curParent->appendChild(curGroupElement);
-        foreach (QGraphicsItem *item, groupItem->childItems()) {
-            QUuid tmpUuid = UBGraphicsScene::getPersonalUuid(item);
-            if (!tmpUuid.isNull()) {
-                if (item->type() == UBGraphicsGroupContainerItem::Type && item->childItems().count())
-                    persistGroupToDom(item, curParent, groupDomDocument);
-                else {
-                    QDomElement curSubElement = groupDomDocument->createElement(tElement);
-                    curSubElement.setAttribute(aId, tmpUuid.toString());
-                    curGroupElement.appendChild(curSubElement);
-                }
+    mXmlWriter.writeStartElement(tGroup);
+    mXmlWriter.writeAttribute(aId, uuid.toString());
+    UBGraphicsGroupContainerItem* group = dynamic_cast<UBGraphicsGroupContainerItem*>(groupItem);
+    if(group && group->Delegate()){
+        mXmlWriter.writeAttribute(UBSettings::uniboardDocumentNamespaceUri, "locked", group->Delegate()->isLocked() ? xmlTrue : xmlFalse);
+        mXmlWriter.writeAttribute(UBSettings::uniboardDocumentNamespaceUri, "layer", group->data(UBGraphicsItemData::ItemLayerType).toString());
+    }
+
+    // nested groups are written as siblings following their parent group
+    QList<QGraphicsItem*> nestedGroups;
+    foreach (QGraphicsItem *item, groupItem->childItems()) {
+        QUuid tmpUuid = UBGraphicsScene::getPersonalUuid(item);
+        if (!tmpUuid.isNull()) {
+            if (item->type() == UBGraphicsGroupContainerItem::Type && item->childItems().count())
+                nestedGroups << item;
+            else {
+                mXmlWriter.writeStartElement(tElement);
+                mXmlWriter.writeAttribute(aId, tmpUuid.toString());
+                mXmlWriter.writeEndElement();
             }
         }
     }
+    mXmlWriter.writeEndElement();
+
+    foreach (QGraphicsItem *item, nestedGroups)
+        groupToSvg(item);
 }
 
 void UBSvgSubsetAdaptor::UBSvgSubsetWriter::polygonItemToSvgLine(UBGraphicsPolygonItem* polygonItem, bool groupHoldsInfo)
@@ -1485,16 +1860,16 @@ void UBSvgSubsetAdaptor::UBSvgSubsetWriter::polygonItemToSvgLine(UBGraphicsPolyg
 
     QLineF line = polygonItem->originalLine();
 
-    mXmlWriter.writeAttribute("x1", QString::number(line.p1().x(), 'f', 2));
-    mXmlWriter.writeAttribute("y1", QString::number(line.p1().y(), 'f', 2));
+    mXmlWriter.writeAttribute("x1", svgNumber(line.p1().x()));
+    mXmlWriter.writeAttribute("y1", svgNumber(line.p1().y()));
 
     // SVG renderers (Chrome) do not like line where (x1, y1) == (x2, y2)
     qreal x2 = line.p2().x();
     if (line.p1() == line.p2())
         x2 += 0.01;
 
-    mXmlWriter.writeAttribute("x2", QString::number(x2, 'f', 2));
-    mXmlWriter.writeAttribute("y2", QString::number(line.p2().y(), 'f', 2));
+    mXmlWriter.writeAttribute("x2", svgNumber(x2));
+    mXmlWriter.writeAttribute("y2", svgNumber(line.p2().y()));
 
     mXmlWriter.writeAttribute("stroke-width", QString::number(polygonItem->originalWidth(), 'f', -1));
     mXmlWriter.writeAttribute("stroke", polygonItem->brush().color().name());
@@ -1516,6 +1891,37 @@ void UBSvgSubsetAdaptor::UBSvgSubsetWriter::polygonItemToSvgLine(UBGraphicsPolyg
 }
 
 
+QString UBSvgSubsetAdaptor::UBSvgSubsetWriter::svgNumber(qreal value)
+{
+    char buffer[sSvgNumberMaxLength];
+    char* end = writeSvgNumber(buffer, value);
+
+    return QString::fromLatin1(buffer, end - buffer);
+}
+
+
+void UBSvgSubsetAdaptor::UBSvgSubsetWriter::writePointsAttribute(const QVector<QPointF>& points)
+{
+    QString value;
+
+    if (mPointsMarker.isEmpty())
+    {
+        value = QString::fromLatin1(pointsAttributeValue(points, mCompactPoints, mNumberBuffer));
+    }
+    else
+    {
+        // the points are formatted when the snapshot is serialized
+        value = mPointsMarker;
+        mDeferredPoints << points;
+    }
+
+    if (mCompactPoints)
+        mXmlWriter.writeAttribute(UBSettings::uniboardDocumentNamespaceUri, "packed-points", value);
+    else
+        mXmlWriter.writeAttribute("points", value);
+}
+
+
 void UBSvgSubsetAdaptor::UBSvgSubsetWriter::strokeToSvgPolyline(UBGraphicsStroke* stroke, bool groupHoldsInfo)
 {
     QList<UBGraphicsPolygonItem*> pols = stroke->polygons();
@@ -1538,8 +1944,7 @@ void UBSvgSubsetAdaptor::UBSvgSubsetWriter::strokeToSvgPolyline(UBGraphicsStroke
             points[1] = QPointF(points[1].x() + 0.01, points[1].y());
         }
 
-        QString svgPoints = pointsToSvgPointsAttribute(points);
-        mXmlWriter.writeAttribute("points", svgPoints);
+        writePointsAttribute(points);
 
         UBGraphicsPolygonItem* firstPolygonItem = pols.at(0);
 
@@ -1601,8 +2006,7 @@ void UBSvgSubsetAdaptor::UBSvgSubsetWriter::polygonItemToSvgPolygon(UBGraphicsPo
     {
         mXmlWriter.writeStartElement("polygon");
 
-        QString points = pointsToSvgPointsAttribute(polygon);
-        mXmlWriter.writeAttribute("points", points);
+        writePointsAttribute(polygon);
         mXmlWriter.writeAttribute("transform",toSvgTransform(polygonItem->matrix()));
         mXmlWriter.writeAttribute("fill", polygonItem->brush().color().name());
 
@@ -1655,10 +2059,16 @@ UBGraphicsPolygonItem* UBSvgSubsetAdaptor::UBSvgSubsetReader::polygonItemFromPol
     graphicsItemFromSvg(polygonItem);
 
     QStringRef svgPoints = mXmlReader.attributes().value("points");
+    QStringRef ubPackedPoints = mXmlReader.attributes().value(mNamespaceUri, "packed-points");
 
     QPolygonF polygon;
 
-    if (!svgPoints.isNull())
+    if (!ubPackedPoints.isNull())
+    {
+        if (!unpackPoints(ubPackedPoints, polygon))
+            qWarning() << "cannot make sense of 'packed-points' value";
+    }
+    else if (!svgPoints.isNull())
     {
         QStringList ts = svgPoints.toString().split(QLatin1Char(' '), QString::SkipEmptyParts);
 
@@ -1925,15 +2335,20 @@ QList<UBGraphicsPolygonItem*> UBSvgSubsetAdaptor::UBSvgSubsetReader::polygonItem
     colorOnLightBackground.setAlphaF(opacity);
 
     QStringRef svgPoints = mXmlReader.attributes().value("points");
+    QStringRef ubPackedPoints = mXmlReader.attributes().value(mNamespaceUri, "packed-points");
 
     QList<UBGraphicsPolygonItem*> polygonItems;
 
-    if (!svgPoints.isNull())
+    if (!svgPoints.isNull() || !ubPackedPoints.isNull())
     {
-        QStringList ts = svgPoints.toString().split(QLatin1Char(' '),
-                                                    QString::SkipEmptyParts);
+        QStringList ts;
+
+        QVector<QPointF> points;
 
-        QList<QPointF> points;
+        if (ubPackedPoints.isNull())
+            ts = svgPoints.toString().split(QLatin1Char(' '), QString::SkipEmptyParts);
+        else if (!unpackPoints(ubPackedPoints, points))
+            qWarning() << "cannot make sense of 'packed-points' value";
 
         foreach(const QString sPoint, ts)
         {
@@ -2009,7 +2424,14 @@ UBGraphicsPixmapItem* UBSvgSubsetAdaptor::UBSvgSubsetReader::pixmapItemFromSvg()
     if (!imageHref.isNull())
     {
         QString href = imageHref.toString();
-        QPixmap pix(mDocumentPath + "/" + UBFileSystemUtils::normalizeFilePath(href));
+        QString path = mDocumentPath + "/" + UBFileSystemUtils::normalizeFilePath(href);
+
+        QPixmap pix;
+        if (mDecodedImages.contains(path))
+            pix = QPixmap::fromImage(mDecodedImages.value(path));
+        else
+            pix.load(path);
+
         pixmapItem->setPixmap(pix);
     }
     else
@@ -69,13 +69,47 @@ class UBSvgSubsetAdaptor
 
     public:
 
+        /** @brief Page attributes stored on the root svg element, readable without parsing the page content. */
+        struct SceneMetadata
+        {
+            SceneMetadata()
+                : isValid(false)
+            {}
+
+            bool isValid;
+            QUuid uuid;
+            QString version;
+        };
+
+        /** @brief A page serialized on the GUI thread, whose stroke points are formatted later by serializeSnapshot(). */
+        struct SceneSnapshot
+        {
+            SceneSnapshot()
+                : compactPoints(false)
+            {}
+
+            QByteArray data;
+            QByteArray pointsMarker;
+            QList<QVector<QPointF> > points;
+            bool compactPoints;
+        };
+
         static UBGraphicsScene* loadScene(UBDocumentProxy* proxy, const int pageIndex);
         static QByteArray loadSceneAsText(UBDocumentProxy* proxy, const int pageIndex);
         static UBGraphicsScene* loadScene(UBDocumentProxy* proxy, const QByteArray& pArray);
+        static UBGraphicsScene* loadScene(UBDocumentProxy* proxy, const QByteArray& pCleanedArray, const QHash<QString, QImage>& pDecodedImages);
+
+        static QByteArray cleanSceneData(const QByteArray& pArray);
+        static QHash<QString, QImage> decodeSceneImages(const QString& documentPath, const QByteArray& pCleanedArray);
+        static QStringList sceneDependencies(const QByteArray& pCleanedArray);
 
         static void persistScene(UBDocumentProxy* proxy, UBGraphicsScene* pScene, const int pageIndex);
+        static QByteArray serializeScene(UBDocumentProxy* proxy, UBGraphicsScene* pScene, const int pageIndex);
+        static SceneSnapshot snapshotScene(UBDocumentProxy* proxy, UBGraphicsScene* pScene, const int pageIndex);
+        static QByteArray serializeSnapshot(const SceneSnapshot& snapshot);
         static void upgradeScene(UBDocumentProxy* proxy, const int pageIndex);
 
+        static SceneMetadata sceneMetadata(UBDocumentProxy* proxy, const int pageIndex);
         static QUuid sceneUuid(UBDocumentProxy* proxy, const int pageIndex);
         static void setSceneUuid(UBDocumentProxy* proxy, const int pageIndex, QUuid pUuid);
 
@@ -96,12 +130,14 @@ class UBSvgSubsetAdaptor
 
     private:
 
-        static QDomDocument loadSceneDocument(UBDocumentProxy* proxy, const int pPageIndex);
-
         static QString uniboardDocumentNamespaceUriFromVersion(int fileVersion);
 
         static const QString sFormerUniboardDocumentNamespaceUri;
 
+        static QString packPoints(const QVector<QPointF>& points);
+        static QByteArray pointsAttributeValue(QVector<QPointF> points, bool compact, QByteArray& buffer);
+        static bool unpackPoints(const QStringRef& packedPoints, QVector<QPointF>& points);
+
         static QString toSvgTransform(const QMatrix& matrix);
         static QMatrix fromSvgTransform(const QString& transform);
 
@@ -110,7 +146,8 @@ class UBSvgSubsetAdaptor
         {
             public:
 
-                UBSvgSubsetReader(UBDocumentProxy* proxy, const QByteArray& pXmlData);
+                UBSvgSubsetReader(UBDocumentProxy* proxy, const QByteArray& pXmlData,
+                                  const QHash<QString, QImage>& pDecodedImages = QHash<QString, QImage>());
 
                 virtual ~UBSvgSubsetReader(){}
 
@@ -174,6 +211,9 @@ class UBSvgSubsetAdaptor
                 UBGraphicsScene *mScene;
 
                 QHash<QString,UBGraphicsStrokesGroup*> mStrokesList;
+
+                // images decoded ahead of time, by absolute file path
+                QHash<QString, QImage> mDecodedImages;
         };
 
         class UBSvgSubsetWriter
@@ -183,46 +223,21 @@ class UBSvgSubsetAdaptor
                 UBSvgSubsetWriter(UBDocumentProxy* proxy, UBGraphicsScene* pScene, const int pageIndex);
 
                 bool persistScene(UBDocumentProxy *proxy, int pageIndex);
+                QByteArray serializeScene(UBDocumentProxy *proxy);
+                SceneSnapshot snapshotScene(UBDocumentProxy *proxy);
 
                 virtual ~UBSvgSubsetWriter(){}
 
             private:
 
-                void persistGroupToDom(QGraphicsItem *groupItem, QDomElement *curParent, QDomDocument *curDomDocument);
-                void persistStrokeToDom(QGraphicsItem *strokeItem, QDomElement *curParent, QDomDocument *curDomDocument);
+                void groupToSvg(QGraphicsItem *groupItem);
+                void writePointsAttribute(const QVector<QPointF>& points);
                 void polygonItemToSvgPolygon(UBGraphicsPolygonItem* polygonItem, bool groupHoldsInfo);
                 void polygonItemToSvgLine(UBGraphicsPolygonItem* polygonItem, bool groupHoldsInfo);
                 void strokeToSvgPolyline(UBGraphicsStroke* stroke, bool groupHoldsInfo);
                 void strokeToSvgPolygon(UBGraphicsStroke* stroke, bool groupHoldsInfo);
 
-                inline QString pointsToSvgPointsAttribute(QVector<QPointF> points)
-                {
-                    UBGeometryUtils::crashPointList(points);
-
-                    int pointsCount = points.size();
-                    QString svgPoints;
-
-                    int length = 0;
-                    QString sBuf;
-
-                    for(int j = 0; j < pointsCount; j++)
-                    {
-                        sBuf = "%1,%2 ";
-                        const QPointF & point = points.at(j);
-
-                        QString temp1 =  "%1", temp2 = "%2";
-
-                        temp1 = temp1.arg(point.x());
-                        temp2 = temp2.arg(point.y());
-
-                        QLocale loc(QLocale::C);
-                        sBuf = sBuf.arg(loc.toFloat(temp1)).arg(loc.toFloat(temp2));
-
-                        svgPoints.insert(length, sBuf);
-                        length += sBuf.length();
-                    }
-                    return svgPoints;
-                }
+                QString svgNumber(qreal value);
 
                 inline qreal trickAlpha(qreal alpha)
                 {
@@ -259,6 +274,12 @@ class UBSvgSubsetAdaptor
                 QXmlStreamWriter mXmlWriter;
                 QString mDocumentPath;
                 int mPageIndex;
+                bool mCompactPoints;
+                QByteArray mNumberBuffer;
+
+                // set while taking a snapshot: the points attributes are replaced by this marker
+                QString mPointsMarker;
+                QList<QVector<QPointF> > mDeferredPoints;
 
         };
 };
@@ -36,6 +36,7 @@
 #include "core/UBPersistenceManager.h"
 #include "core/UBApplication.h"
 #include "core/UBSettings.h"
+#include "core/UBThumbnailCache.h"
 
 #include "board/UBBoardController.h"
 #include "board/UBBoardPaletteManager.h"
@@ -45,47 +46,29 @@
 #include "domain/UBGraphicsScene.h"
 
 #include "UBSvgSubsetAdaptor.h"
+#include "UBThumbnailGenerator.h"
 
 #include "core/memcheck.h"
 
 void UBThumbnailAdaptor::generateMissingThumbnails(UBDocumentProxy* proxy)
 {
-    int existingPageCount = proxy->pageCount();
+    QList<int> missing = UBThumbnailGenerator::missingThumbnails(proxy);
 
-    for (int iPageNo = 0; iPageNo < existingPageCount; ++iPageNo)
+    if (!missing.isEmpty())
     {
-        QString thumbFileName = proxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.jpg", iPageNo);
-
-        QFile thumbFile(thumbFileName);
-
-        if (!thumbFile.exists())
-        {
-            bool displayMessage = (existingPageCount > 5);
-
-            int thumbCount = 0;
-
-            UBGraphicsScene* scene = UBSvgSubsetAdaptor::loadScene(proxy, iPageNo);
-
-            if (scene)
-            {
-                thumbCount++;
-
-                if (displayMessage && thumbCount == 1)
-                    UBApplication::showMessage(tr("Generating preview thumbnails ..."));
-
-                persistScene(proxy, scene, iPageNo);
-            }
-
-            if (displayMessage && thumbCount > 0)
-                UBApplication::showMessage(tr("%1 thumbnails generated ...").arg(thumbCount));
-
-        }
+        UBThumbnailGenerator generator;
+        generator.generate(proxy, missing);
     }
 }
 
 const QPixmap* UBThumbnailAdaptor::get(UBDocumentProxy* proxy, int pageIndex)
 {
-    QString fileName = proxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.jpg", pageIndex);
+    QString fileName = UBPersistenceManager::persistenceManager()->thumbnailFileName(proxy, pageIndex);
+
+    // the thumbnail may still be waiting to be written by the persistence worker
+    QImage pendingThumbnail = UBPersistenceManager::persistenceManager()->pendingThumbnail(fileName);
+    if (!pendingThumbnail.isNull())
+        return new QPixmap(QPixmap::fromImage(pendingThumbnail));
 
     QFile file(fileName);
     if (!file.exists())
@@ -106,68 +89,99 @@ const QPixmap* UBThumbnailAdaptor::get(UBDocumentProxy* proxy, int pageIndex)
     return pix;
 }
 
-void UBThumbnailAdaptor::load(UBDocumentProxy* proxy, QList<const QPixmap*>& list)
+void UBThumbnailAdaptor::persistScene(UBDocumentProxy* proxy, UBGraphicsScene* pScene, int pageIndex, bool overrideModified)
 {
-    generateMissingThumbnails(proxy);
+    QString fileName = UBPersistenceManager::persistenceManager()->thumbnailFileName(proxy, pageIndex);
 
-    foreach(const QPixmap* pm, list){
-        delete pm;
-        pm = NULL;
+    QFile thumbFile(fileName);
+
+    if (pScene->isModified() || overrideModified || !thumbFile.exists())
+    {
+        renderThumbnail(pScene).save(fileName, "JPG");
+        UBThumbnailCache::thumbnailCache()->remove(fileName);
     }
-    list.clear();
-    for(int i=0; i<proxy->pageCount(); i++)
-        list.append(get(proxy, i));
 }
 
-void UBThumbnailAdaptor::persistScene(UBDocumentProxy* proxy, UBGraphicsScene* pScene, int pageIndex, bool overrideModified)
+/**
+ * @brief Render the thumbnail of a scene into an image, without writing it to disk
+ *
+ * The scene must be rendered on the GUI thread, but the returned image can be encoded and saved anywhere.
+ */
+QImage UBThumbnailAdaptor::renderThumbnail(UBGraphicsScene* pScene)
 {
-    QString fileName = proxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.jpg", pageIndex);
+    return rasterizeThumbnail(recordThumbnail(pScene));
+}
 
-    QFile thumbFile(fileName);
+/**
+ * @brief Record the painting of the thumbnail of a scene, to be rasterized later by rasterizeThumbnail()
+ *
+ * Recording needs the scene and must be done on the GUI thread. The picture doesn't refer to the scene anymore, it
+ * can be rasterized on another thread, as long as a single thread plays it at a time.
+ */
+QPicture UBThumbnailAdaptor::recordThumbnail(UBGraphicsScene* pScene)
+{
+    qreal nominalWidth = pScene->nominalSize().width();
+    qreal nominalHeight = pScene->nominalSize().height();
+    qreal ratio = nominalWidth / nominalHeight;
+    QRectF sceneRect = pScene->normalizedSceneRect(ratio);
 
-    if (pScene->isModified() || overrideModified || !thumbFile.exists())
+    qreal width = UBSettings::maxThumbnailWidth;
+    qreal height = width / ratio;
+
+    QRectF imageRect(0, 0, width, height);
+
+    QPicture picture;
+    QPainter painter(&picture);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+
+    if (pScene->isDarkBackground())
     {
-        qreal nominalWidth = pScene->nominalSize().width();
-        qreal nominalHeight = pScene->nominalSize().height();
-        qreal ratio = nominalWidth / nominalHeight;
-        QRectF sceneRect = pScene->normalizedSceneRect(ratio);
+        painter.fillRect(imageRect, Qt::black);
+    }
+    else
+    {
+        painter.fillRect(imageRect, Qt::white);
+    }
+
+    pScene->setRenderingContext(UBGraphicsScene::NonScreen);
+    pScene->setRenderingQuality(UBItem::RenderingQualityHigh);
 
-        qreal width = UBSettings::maxThumbnailWidth;
-        qreal height = width / ratio;
+    pScene->render(&painter, imageRect, sceneRect, Qt::KeepAspectRatio);
 
-        QImage thumb(width, height, QImage::Format_ARGB32);
+    pScene->setRenderingContext(UBGraphicsScene::Screen);
+    pScene->setRenderingQuality(UBItem::RenderingQualityNormal);
 
-        QRectF imageRect(0, 0, width, height);
+    painter.end();
 
-        QPainter painter(&thumb);
-        painter.setRenderHint(QPainter::Antialiasing, true);
-        painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+    picture.setBoundingRect(QRect(0, 0, width, height));
 
-        if (pScene->isDarkBackground())
-        {
-            painter.fillRect(imageRect, Qt::black);
-        }
-        else
-        {
-            painter.fillRect(imageRect, Qt::white);
-        }
+    return picture;
+}
 
-        pScene->setRenderingContext(UBGraphicsScene::NonScreen);
-        pScene->setRenderingQuality(UBItem::RenderingQualityHigh);
+/**
+ * @brief Rasterize a thumbnail recorded by recordThumbnail(), on any thread
+ */
+QImage UBThumbnailAdaptor::rasterizeThumbnail(const QPicture& picture)
+{
+    QSize size = picture.boundingRect().size();
 
-        pScene->render(&painter, imageRect, sceneRect, Qt::KeepAspectRatio);
+    QImage thumb(size, QImage::Format_ARGB32);
+    thumb.fill(Qt::white);
 
-        pScene->setRenderingContext(UBGraphicsScene::Screen);
-        pScene->setRenderingQuality(UBItem::RenderingQualityNormal);
+    QPainter painter(&thumb);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform, true);
+    painter.drawPicture(0, 0, picture);
+    painter.end();
 
-        thumb.scaled(width, height, Qt::KeepAspectRatio, Qt::SmoothTransformation).save(fileName, "JPG");
-    }
+    return thumb;
 }
 
 
 QUrl UBThumbnailAdaptor::thumbnailUrl(UBDocumentProxy* proxy, int pageIndex)
 {
-    QString fileName = proxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.jpg", pageIndex);
+    QString fileName = UBPersistenceManager::persistenceManager()->thumbnailFileName(proxy, pageIndex);
 
     return QUrl::fromLocalFile(fileName);
 }
@@ -31,6 +31,8 @@
 #define UBTHUMBNAILADAPTOR_H
 
 #include <QtCore>
+#include <QImage>
+#include <QPicture>
 
 class UBDocument;
 class UBDocumentProxy;
@@ -44,13 +46,15 @@ public:
     static QUrl thumbnailUrl(UBDocumentProxy* proxy, int pageIndex);
 
     static void persistScene(UBDocumentProxy* proxy, UBGraphicsScene* pScene, int pageIndex, bool overrideModified = false);
+    static QImage renderThumbnail(UBGraphicsScene* pScene);
+    static QPicture recordThumbnail(UBGraphicsScene* pScene);
+    static QImage rasterizeThumbnail(const QPicture& picture);
 
     static const QPixmap* get(UBDocumentProxy* proxy, int index);
-    static void load(UBDocumentProxy* proxy, QList<const QPixmap*>& list);
 
-private:
     static void generateMissingThumbnails(UBDocumentProxy* proxy);
 
+private:
     UBThumbnailAdaptor() {}
 };
 
@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2015-2018 Département de l'Instruction Publique (DIP-SEM)
+ *
+ * Copyright (C) 2013 Open Education Foundation
+ *
+ * Copyright (C) 2010-2013 Groupement d'Intérêt Public pour
+ * l'Education Numérique en Afrique (GIP ENA)
+ *
+ * This file is part of OpenBoard.
+ *
+ * OpenBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License,
+ * with a specific linking exception for the OpenSSL project's
+ * "OpenSSL" library (or with modified versions of it that use the
+ * same license as the "OpenSSL" library).
+ *
+ * OpenBoard is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenBoard. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "UBThumbnailGenerator.h"
+
+#include "core/UBApplication.h"
+#include "core/UBPersistenceManager.h"
+#include "core/UBSettings.h"
+#include "core/UBThumbnailCache.h"
+
+#include "document/UBDocumentProxy.h"
+
+#include "domain/UBGraphicsScene.h"
+
+#include "UBMetadataDcSubsetAdaptor.h"
+#include "UBPageOrderAdaptor.h"
+#include "UBSvgSubsetAdaptor.h"
+#include "UBThumbnailAdaptor.h"
+
+#include "core/memcheck.h"
+
+UBThumbnailGenerator::UBThumbnailGenerator()
+{
+    // NOOP
+}
+
+UBThumbnailGenerator::~UBThumbnailGenerator()
+{
+    mThreadPool.waitForDone();
+}
+
+int UBThumbnailGenerator::generate(UBDocumentProxy* proxy, const QList<int>& pageIndexes)
+{
+    if (pageIndexes.isEmpty())
+        return 0;
+
+    // pages still queued for writing must be on disk before being read again
+    UBPersistenceManager::persistenceManager()->flushPendingSaves();
+
+    mWrittenCount.store(0);
+
+    QString documentPath = proxy->persistencePath();
+    QStringList thumbnailFiles;
+
+    // decoded pages wait in memory for the GUI thread, so only a few of them are read in advance
+    int readAhead = 2 * mThreadPool.maxThreadCount();
+    int nextRead = 0;
+
+    for (int i = 0; i < pageIndexes.size(); i++)
+    {
+        while (nextRead < pageIndexes.size() && nextRead < i + readAhead)
+        {
+            int pageIndex = pageIndexes.at(nextRead++);
+            QString sceneFile = UBPersistenceManager::persistenceManager()->sceneFileName(proxy, pageIndex);
+            mThreadPool.start(new ReadWorker(this, documentPath, sceneFile, pageIndex));
+        }
+
+        int pageIndex = pageIndexes.at(i);
+        DecodedPage page = takeDecodedPage(pageIndex);
+
+        if (!page.sceneData.isEmpty())
+        {
+            UBGraphicsScene* scene = UBSvgSubsetAdaptor::loadScene(proxy, page.sceneData, page.images);
+
+            if (scene)
+            {
+                QString thumbnailFile = UBPersistenceManager::persistenceManager()->thumbnailFileName(proxy, pageIndex);
+                thumbnailFiles << thumbnailFile;
+
+                mThreadPool.start(new SaveWorker(this, UBThumbnailAdaptor::renderThumbnail(scene), thumbnailFile));
+
+                delete scene;
+            }
+        }
+
+        if (pageIndexes.size() > 5)
+            UBApplication::showMessage(tr("Generating preview thumbnails (%1/%2)").arg(i + 1).arg(pageIndexes.size()), true);
+    }
+
+    mThreadPool.waitForDone();
+
+    foreach(const QString& thumbnailFile, thumbnailFiles)
+        UBThumbnailCache::thumbnailCache()->remove(thumbnailFile);
+
+    if (pageIndexes.size() > 5)
+        UBApplication::showMessage(tr("%1 thumbnails generated ...").arg(mWrittenCount.load()));
+
+    return mWrittenCount.load();
+}
+
+QList<int> UBThumbnailGenerator::missingThumbnails(UBDocumentProxy* proxy)
+{
+    // pages still queued for writing would otherwise be reported as missing
+    UBPersistenceManager::persistenceManager()->flushPendingSaves();
+
+    QList<int> missing;
+
+    for (int i = 0; i < proxy->pageCount(); i++)
+    {
+        if (!QFile::exists(UBPersistenceManager::persistenceManager()->thumbnailFileName(proxy, i)))
+            missing << i;
+    }
+
+    return missing;
+}
+
+int UBThumbnailGenerator::generateLibraryThumbnails()
+{
+    QTextStream out(stdout);
+
+    QDir repository(UBSettings::userDocumentDirectory());
+    UBThumbnailGenerator generator;
+    int generatedCount = 0;
+
+    foreach(QFileInfo documentDir, repository.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        QString documentPath = documentDir.absoluteFilePath();
+
+        if (UBMetadataDcSubsetAdaptor::load(documentPath).isEmpty())
+            continue;
+
+        UBDocumentProxy proxy(documentPath);
+        proxy.setPageCount(UBPageOrderAdaptor::load(documentPath).size());
+
+        QList<int> missing = missingThumbnails(&proxy);
+
+        if (missing.isEmpty())
+            continue;
+
+        int count = generator.generate(&proxy, missing);
+        generatedCount += count;
+
+        out << documentPath << ": " << count << "/" << missing.size() << " thumbnails generated" << endl;
+    }
+
+    out << generatedCount << " thumbnails generated" << endl;
+
+    return generatedCount;
+}
+
+void UBThumbnailGenerator::pageDecoded(int pageIndex, const DecodedPage& page)
+{
+    QMutexLocker locker(&mMutex);
+
+    mDecodedPages.insert(pageIndex, page);
+    mPageDecoded.wakeAll();
+}
+
+UBThumbnailGenerator::DecodedPage UBThumbnailGenerator::takeDecodedPage(int pageIndex)
+{
+    QMutexLocker locker(&mMutex);
+
+    while (!mDecodedPages.contains(pageIndex))
+        mPageDecoded.wait(&mMutex);
+
+    return mDecodedPages.take(pageIndex);
+}
+
+void UBThumbnailGenerator::ReadWorker::run()
+{
+    DecodedPage page;
+
+    QFile file(mSceneFileName);
+
+    if (file.open(QIODevice::ReadOnly))
+    {
+        page.sceneData = UBSvgSubsetAdaptor::cleanSceneData(file.readAll());
+        file.close();
+
+        page.images = UBSvgSubsetAdaptor::decodeSceneImages(mDocumentPath, page.sceneData);
+    }
+    else
+    {
+        qWarning() << "Cannot open file " << mSceneFileName << " for reading ...";
+    }
+
+    // always answer, the GUI thread is waiting for this page
+    mGenerator->pageDecoded(mPageIndex, page);
+}
+
+void UBThumbnailGenerator::SaveWorker::run()
+{
+    if (mThumbnail.save(mThumbnailFileName, "JPG"))
+        mGenerator->mWrittenCount.ref();
+    else
+        qWarning() << "Cannot write thumbnail" << mThumbnailFileName;
+}
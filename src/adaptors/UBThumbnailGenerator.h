@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2015-2018 Département de l'Instruction Publique (DIP-SEM)
+ *
+ * Copyright (C) 2013 Open Education Foundation
+ *
+ * Copyright (C) 2010-2013 Groupement d'Intérêt Public pour
+ * l'Education Numérique en Afrique (GIP ENA)
+ *
+ * This file is part of OpenBoard.
+ *
+ * OpenBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License,
+ * with a specific linking exception for the OpenSSL project's
+ * "OpenSSL" library (or with modified versions of it that use the
+ * same license as the "OpenSSL" library).
+ *
+ * OpenBoard is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenBoard. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef UBTHUMBNAILGENERATOR_H
+#define UBTHUMBNAILGENERATOR_H
+
+#include <QtCore>
+#include <QImage>
+#include <QThreadPool>
+#include <QRunnable>
+
+class UBDocumentProxy;
+
+/**
+ * @brief Regenerates the thumbnails of many pages at once
+ *
+ * Reading the pages and decoding their images, as well as encoding and writing the thumbnails, run on a
+ * thread pool. Only building the scenes and rendering them stays on the GUI thread, as scene items
+ * (widgets, media, undo stack connections) cannot live on any other thread.
+ */
+class UBThumbnailGenerator
+{
+    Q_DECLARE_TR_FUNCTIONS(UBThumbnailGenerator)
+
+    public:
+        UBThumbnailGenerator();
+        virtual ~UBThumbnailGenerator();
+
+        // returns the number of thumbnails written
+        int generate(UBDocumentProxy* proxy, const QList<int>& pageIndexes);
+
+        static QList<int> missingThumbnails(UBDocumentProxy* proxy);
+
+        // generates the missing thumbnails of every document of the library, for the command line
+        static int generateLibraryThumbnails();
+
+    private:
+        struct DecodedPage
+        {
+            QByteArray sceneData;
+            QHash<QString, QImage> images;
+        };
+
+        class ReadWorker : public QRunnable
+        {
+            public:
+                ReadWorker(UBThumbnailGenerator* generator, const QString& documentPath, const QString& sceneFileName, int pageIndex)
+                    : mGenerator(generator)
+                    , mDocumentPath(documentPath)
+                    , mSceneFileName(sceneFileName)
+                    , mPageIndex(pageIndex)
+                {
+                    // NOOP
+                }
+
+                void run();
+
+            private:
+                UBThumbnailGenerator* mGenerator;
+                QString mDocumentPath;
+                QString mSceneFileName;
+                int mPageIndex;
+        };
+
+        class SaveWorker : public QRunnable
+        {
+            public:
+                SaveWorker(UBThumbnailGenerator* generator, const QImage& thumbnail, const QString& thumbnailFileName)
+                    : mGenerator(generator)
+                    , mThumbnail(thumbnail)
+                    , mThumbnailFileName(thumbnailFileName)
+                {
+                    // NOOP
+                }
+
+                void run();
+
+            private:
+                UBThumbnailGenerator* mGenerator;
+                QImage mThumbnail;
+                QString mThumbnailFileName;
+        };
+
+        void pageDecoded(int pageIndex, const DecodedPage& page);
+        DecodedPage takeDecodedPage(int pageIndex);
+
+        QThreadPool mThreadPool;
+        QMutex mMutex;
+        QWaitCondition mPageDecoded;
+        QHash<int, DecodedPage> mDecodedPages;
+        QAtomicInt mWrittenCount;
+};
+
+#endif // UBTHUMBNAILGENERATOR_H
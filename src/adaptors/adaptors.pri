@@ -5,9 +5,11 @@ HEADERS      += src/adaptors/UBExportAdaptor.h\
                 src/adaptors/UBExportDocument.h \
                 src/adaptors/UBSvgSubsetAdaptor.h \
                 src/adaptors/UBMetadataDcSubsetAdaptor.h \
+                src/adaptors/UBPageOrderAdaptor.h \
                 src/adaptors/UBImportAdaptor.h \
                 src/adaptors/UBImportDocument.h \
                 src/adaptors/UBThumbnailAdaptor.h \
+                src/adaptors/UBThumbnailGenerator.h \
                 src/adaptors/UBImportPDF.h \
                 src/adaptors/UBImportImage.h \
                 src/adaptors/UBExportWeb.h \
@@ -24,9 +26,11 @@ SOURCES      += src/adaptors/UBExportAdaptor.cpp\
                 src/adaptors/UBExportDocument.cpp \
                 src/adaptors/UBSvgSubsetAdaptor.cpp \
                 src/adaptors/UBMetadataDcSubsetAdaptor.cpp \
+                src/adaptors/UBPageOrderAdaptor.cpp \
                 src/adaptors/UBImportAdaptor.cpp \
                 src/adaptors/UBImportDocument.cpp \
                 src/adaptors/UBThumbnailAdaptor.cpp \
+                src/adaptors/UBThumbnailGenerator.cpp \
                 src/adaptors/UBImportPDF.cpp \
                 src/adaptors/UBImportImage.cpp \
                 src/adaptors/UBExportWeb.cpp \
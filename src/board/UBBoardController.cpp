@@ -125,7 +125,7 @@ UBBoardController::UBBoardController(UBMainWindow* mainWindow)
 }
 
 
-void UBBoardController::init()
+void UBBoardController::init(bool withStartingDocument)
 {
     setupViews();
     setupToolbar();
@@ -148,11 +148,15 @@ void UBBoardController::init()
     connect(UBDownloadManager::downloadManager(), SIGNAL(downloadModalFinished()), this, SLOT(onDownloadModalFinished()));
     connect(UBDownloadManager::downloadManager(), SIGNAL(addDownloadedFileToBoard(bool,QUrl,QUrl,QString,QByteArray,QPointF,QSize,bool)), this, SLOT(downloadFinished(bool,QUrl,QUrl,QString,QByteArray,QPointF,QSize,bool)));
 
-    UBDocumentProxy* doc = UBPersistenceManager::persistenceManager()->createNewDocument();
+    // without a starting document the board shows nothing, which only suits modes that never show it
+    if (withStartingDocument)
+    {
+        UBDocumentProxy* doc = UBPersistenceManager::persistenceManager()->createNewDocument();
 
-    setActiveDocumentScene(doc);
+        setActiveDocumentScene(doc);
 
-    initBackgroundGridSize();
+        initBackgroundGridSize();
+    }
 
     undoRedoStateChange(true);
 
@@ -580,7 +584,6 @@ void UBBoardController::duplicateScene(int nIndex)
     QList<int> scIndexes;
     scIndexes << nIndex;
     duplicatePages(scIndexes);
-    insertThumbPage(nIndex);
     emit documentThumbnailsUpdated(this);
     emit addThumbnailRequired(this, nIndex + 1);
     selectedDocument()->setMetaData(UBSettings::documentUpdatedAt, UBStringUtils::toUtcIsoDateTime(QDateTime::currentDateTime()));
@@ -1549,6 +1552,9 @@ void UBBoardController::setActiveDocumentScene(UBDocumentProxy* pDocumentProxy,
 
     if (targetScene)
     {
+        // the board scene stays pinned in the cache, the target one must already survive persisting the current one
+        UBPersistenceManager::persistenceManager()->pinScene(targetScene);
+
         if (mActiveScene && !onImport)
         {
             persistCurrentScene();
@@ -1559,6 +1565,9 @@ void UBBoardController::setActiveDocumentScene(UBDocumentProxy* pDocumentProxy,
             UBApplication::undoStack->clear();
         }
 
+        if (mActiveScene && sceneChange)
+            UBPersistenceManager::persistenceManager()->unpinScene(mActiveScene);
+
         mActiveScene = targetScene;
         mActiveSceneIndex = index;
 
@@ -1595,6 +1604,9 @@ void UBBoardController::setActiveDocumentScene(UBDocumentProxy* pDocumentProxy,
     if (sceneChange)
     {
         emit activeSceneChanged();
+
+        // get the pages the user is likely to turn to next ready in the background
+        UBPersistenceManager::persistenceManager()->prefetchNeighbourScenes(pDocumentProxy, mActiveSceneIndex);
     }
 }
 
@@ -1888,6 +1900,17 @@ void UBBoardController::appMainModeChanged(UBApplicationController::MainMode md)
     }
 }
 
+void UBBoardController::stopAutosave()
+{
+    if (mAutosaveTimer)
+        mAutosaveTimer->stop();
+}
+
+void UBBoardController::restartAutosave()
+{
+    appMainModeChanged(UBApplication::applicationController->displayMode());
+}
+
 void UBBoardController::closing()
 {
     mIsClosing = true;
@@ -74,7 +74,7 @@ class UBBoardController : public UBDocumentContainer
         UBBoardController(UBMainWindow *mainWindow);
         virtual ~UBBoardController();
 
-        void init();
+        void init(bool withStartingDocument = true);
         void setupLayout();
 
         UBGraphicsScene* activeScene() const;
@@ -254,6 +254,9 @@ class UBBoardController : public UBDocumentContainer
 
         void saveData(SaveFlags fls = sf_none);
 
+        void stopAutosave();
+        void restartAutosave();
+
         //void regenerateThumbnails();
 
     signals:
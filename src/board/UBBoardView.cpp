@@ -30,6 +30,7 @@
 #include "UBBoardView.h"
 
 #include <QtGui>
+#include <QElapsedTimer>
 #include <QtXml>
 #include <QListView>
 
@@ -73,6 +74,7 @@
 #include "domain/UBGraphicsGroupContainerItem.h"
 #include "domain/UBGraphicsStrokesGroup.h"
 #include "domain/UBGraphicsItemDelegate.h"
+#include "domain/UBPageBackgroundPainter.h"
 
 #include "document/UBDocumentProxy.h"
 
@@ -85,6 +87,8 @@
 
 #include "core/memcheck.h"
 
+const int UBBoardView::sFrameTimeSamples = 120;
+
 UBBoardView::UBBoardView (UBBoardController* pController, QWidget* pParent, bool isControl, bool isDesktop)
     : QGraphicsView (pParent)
     , mController (pController)
@@ -152,6 +156,12 @@ void UBBoardView::init ()
     connect (UBSettings::settings ()->boardUseHighResTabletEvent, SIGNAL (changed (QVariant)),
              this, SLOT (settingChanged (QVariant)));
 
+    connect (UBSettings::settings ()->boardRenderCacheMode, SIGNAL (changed (QVariant)),
+             this, SLOT (settingChanged (QVariant)));
+
+    connect (UBSettings::settings ()->boardShowFrameTimes, SIGNAL (changed (QVariant)),
+             this, SLOT (settingChanged (QVariant)));
+
     setOptimizationFlags (QGraphicsView::IndirectPainting | QGraphicsView::DontSavePainterState); // enable UBBoardView::drawItems filter
     setViewportUpdateMode(QGraphicsView::SmartViewportUpdate);
     setWindowFlags (Qt::FramelessWindowHint);
@@ -166,6 +176,12 @@ void UBBoardView::init ()
     mPendingStylusReleaseEvent = false;
 
     setCacheMode (QGraphicsView::CacheBackground);
+    mRenderCacheMode = RenderCacheBackground;
+    mStaticLayerActive = false;
+    mShowFrameTimes = false;
+
+    mFrameTimeOverlayTimer.setInterval (500);
+    connect (&mFrameTimeOverlayTimer, SIGNAL (timeout ()), this, SLOT (updateFrameTimeOverlay ()));
 
     mUsingTabletEraser = false;
     mIsCreatingTextZone = false;
@@ -1515,7 +1531,7 @@ void UBBoardView::leaveEvent (QEvent * event)
 
 void UBBoardView::drawItems (QPainter *painter, int numItems, QGraphicsItem* items[], const QStyleOptionGraphicsItem options[])
 {
-    if (!mFilterZIndex)
+    if (!mFilterZIndex && !mStaticLayerActive)
         QGraphicsView::drawItems (painter, numItems, items, options);
     else
     {
@@ -1526,7 +1542,11 @@ void UBBoardView::drawItems (QPainter *painter, int numItems, QGraphicsItem* ite
 
         for (int i = 0; i < numItems; i++)
         {
-            if (shouldDisplayItem (items[i]))
+            // items of the static layer are already part of the cached background
+            if (mStaticLayerActive && mStaticLayerItems.contains (items[i]->topLevelItem ()))
+                continue;
+
+            if (!mFilterZIndex || shouldDisplayItem (items[i]))
             {
                 itemsFiltered[count] = items[i];
                 optionsFiltered[count] = options[i];
@@ -1589,64 +1609,16 @@ void UBBoardView::drawBackground (QPainter *painter, const QRectF &rect)
         return;
     }
 
-    bool darkBackground = scene () && scene ()->isDarkBackground ();
-
-    if (darkBackground)
+    if (scene ())
     {
-        painter->fillRect (rect, QBrush (QColor (Qt::black)));
+        UBPageBackgroundPainter::backgroundPainter ()->paint (painter, rect, scene ()->pageBackground (), scene ()->isDarkBackground (),
+                                                             scene ()->backgroundGridSize (), transform ().m11 ());
     }
     else
     {
         painter->fillRect (rect, QBrush (QColor (Qt::white)));
     }
 
-    if (transform ().m11 () > 0.5)
-    {
-        QColor bgCrossColor;
-
-        if (darkBackground)
-            bgCrossColor = QColor(UBSettings::settings()->boardCrossColorDarkBackground->get().toString());
-        else
-            bgCrossColor = QColor(UBSettings::settings()->boardCrossColorLightBackground->get().toString());
-
-        if (transform ().m11 () < 0.7)
-        {
-            int alpha = 255 * transform ().m11 () / 2;
-            bgCrossColor.setAlpha (alpha); // fade the crossing on small zooms
-        }
-
-        qreal gridSize = scene()->backgroundGridSize();
-
-        painter->setPen (bgCrossColor);
-
-        if (scene () && scene ()->pageBackground() == UBPageBackground::crossed)
-        {
-            qreal firstY = ((int) (rect.y () / gridSize)) * gridSize;
-
-            for (qreal yPos = firstY; yPos < rect.y () + rect.height (); yPos += gridSize)
-            {
-                painter->drawLine (rect.x (), yPos, rect.x () + rect.width (), yPos);
-            }
-
-            qreal firstX = ((int) (rect.x () / gridSize)) * gridSize;
-
-            for (qreal xPos = firstX; xPos < rect.x () + rect.width (); xPos += gridSize)
-            {
-                painter->drawLine (xPos, rect.y (), xPos, rect.y () + rect.height ());
-            }
-        }
-
-        if (scene() && scene()->pageBackground() == UBPageBackground::ruled)
-        {
-            qreal firstY = ((int) (rect.y () / gridSize)) * gridSize;
-
-            for (qreal yPos = firstY; yPos < rect.y () + rect.height (); yPos += gridSize)
-            {
-                painter->drawLine (rect.x (), yPos, rect.x () + rect.width (), yPos);
-            }
-        }
-    }
-
     if (!mFilterZIndex && scene ())
     {
         QSize pageNominalSize = scene ()->nominalSize ();
@@ -1662,7 +1634,7 @@ void UBBoardView::drawBackground (QPainter *painter, const QRectF &rect)
 
             QColor docSizeColor;
 
-            if (darkBackground)
+            if (scene ()->isDarkBackground ())
                 docSizeColor = UBSettings::documentSizeMarkColorDarkBackground;
             else
                 docSizeColor = UBSettings::documentSizeMarkColorLightBackground;
@@ -1673,6 +1645,154 @@ void UBBoardView::drawBackground (QPainter *painter, const QRectF &rect)
             painter->drawRect (pageRect);
         }
     }
+
+    if (mStaticLayerActive && scene ())
+    {
+        QVector<QGraphicsItem*> staticItems;
+
+        foreach (QGraphicsItem* item, scene ()->items (rect, Qt::IntersectsItemBoundingRect, Qt::AscendingOrder, viewportTransform ()))
+        {
+            if (mStaticLayerItems.contains (item->topLevelItem ()) && (!mFilterZIndex || shouldDisplayItem (item)))
+                staticItems << item;
+        }
+
+        QVector<QStyleOptionGraphicsItem> staticOptions (staticItems.size ());
+
+        QGraphicsView::drawItems (painter, staticItems.size (), staticItems.data (), staticOptions.data ());
+    }
+}
+
+void UBBoardView::paintEvent (QPaintEvent *event)
+{
+    if (!mShowFrameTimes)
+    {
+        QGraphicsView::paintEvent (event);
+        return;
+    }
+
+    QElapsedTimer frameTimer;
+    frameTimer.start ();
+
+    QGraphicsView::paintEvent (event);
+
+    recordFrameTime (event->region (), frameTimer.nsecsElapsed ());
+
+    QPainter painter (viewport ());
+    drawFrameTimeOverlay (&painter);
+}
+
+void UBBoardView::beginStaticLayer ()
+{
+    if (mStaticLayerActive || mRenderCacheMode != RenderCacheStaticLayer || bIsDesktop || !scene ())
+        return;
+
+    QSet<QGraphicsItem*> staticItems;
+
+    foreach (QGraphicsItem* item, scene ()->items ())
+    {
+        QGraphicsItem* topLevelItem = item->topLevelItem ();
+
+        if (!isStaticLayerItem (topLevelItem))
+            continue;
+
+        // media and widgets repaint on their own, they would freeze in the cached layer
+        if (isLiveItem (item))
+            return;
+
+        if (item == topLevelItem)
+            staticItems.insert (item);
+    }
+
+    mStaticLayerItems = staticItems;
+    mStaticLayerActive = true;
+
+    resetCachedContent ();
+}
+
+void UBBoardView::endStaticLayer ()
+{
+    if (!mStaticLayerActive)
+        return;
+
+    mStaticLayerActive = false;
+    mStaticLayerItems.clear ();
+
+    resetCachedContent ();
+}
+
+bool UBBoardView::isStaticLayerItem (QGraphicsItem *item)
+{
+    // tools, cursors and controls follow the pointer and stay in the live layer
+    bool ok;
+    int itemLayerType = item->data (UBGraphicsItemData::ItemLayerType).toInt (&ok);
+
+    return ok && itemLayerType < UBItemLayerType::Tool && item->isVisible ();
+}
+
+bool UBBoardView::isLiveItem (QGraphicsItem *item)
+{
+    int itemType = item->type ();
+
+    return item->isVisible ()
+            && (item->isWidget ()
+                || itemType == UBGraphicsItemType::MediaItemType
+                || itemType == UBGraphicsItemType::VideoItemType
+                || itemType == UBGraphicsItemType::AudioItemType);
+}
+
+void UBBoardView::recordFrameTime (const QRegion& region, qint64 frameTimeNs)
+{
+    // repaints of the overlay alone are not frames worth measuring
+    if (frameTimeOverlayRect ().contains (region.boundingRect ()))
+        return;
+
+    mFrameTimes << frameTimeNs;
+
+    while (mFrameTimes.size () > sFrameTimeSamples)
+        mFrameTimes.removeFirst ();
+}
+
+QRect UBBoardView::frameTimeOverlayRect () const
+{
+    return QRect (8, 8, 360, 24);
+}
+
+void UBBoardView::drawFrameTimeOverlay (QPainter *painter)
+{
+    qint64 totalNs = 0;
+    qint64 maxNs = 0;
+
+    foreach (qint64 frameTimeNs, mFrameTimes)
+    {
+        totalNs += frameTimeNs;
+        maxNs = qMax (maxNs, frameTimeNs);
+    }
+
+    QString cacheModeName;
+
+    if (mStaticLayerActive)
+        cacheModeName = "static layer";
+    else if (cacheMode () & QGraphicsView::CacheBackground)
+        cacheModeName = "background cache";
+    else
+        cacheModeName = "no cache";
+
+    QString text = "no frame";
+
+    if (!mFrameTimes.isEmpty ())
+    {
+        text = QString ("%1 ms  avg %2 ms  max %3 ms  (%4)")
+                .arg (mFrameTimes.last () / 1000000.0, 0, 'f', 1)
+                .arg (totalNs / mFrameTimes.size () / 1000000.0, 0, 'f', 1)
+                .arg (maxNs / 1000000.0, 0, 'f', 1)
+                .arg (cacheModeName);
+    }
+
+    QRect overlayRect = frameTimeOverlayRect ();
+
+    painter->fillRect (overlayRect, QColor (0, 0, 0, 160));
+    painter->setPen (Qt::white);
+    painter->drawText (overlayRect.adjusted (6, 0, -6, 0), Qt::AlignVCenter | Qt::AlignLeft, text);
 }
 
 void UBBoardView::settingChanged (QVariant newValue)
@@ -1682,6 +1802,44 @@ void UBBoardView::settingChanged (QVariant newValue)
     mPenPressureSensitive = UBSettings::settings ()->boardPenPressureSensitive->get ().toBool ();
     mMarkerPressureSensitive = UBSettings::settings ()->boardMarkerPressureSensitive->get ().toBool ();
     mUseHighResTabletEvent = UBSettings::settings ()->boardUseHighResTabletEvent->get ().toBool ();
+
+    QString renderCacheModeName = UBSettings::settings ()->boardRenderCacheMode->get ().toString ();
+    RenderCacheMode renderCacheMode = RenderCacheBackground;
+
+    if (renderCacheModeName == "None")
+        renderCacheMode = RenderCacheNone;
+    else if (renderCacheModeName == "StaticLayer")
+        renderCacheMode = RenderCacheStaticLayer;
+
+    if (renderCacheMode != mRenderCacheMode)
+    {
+        endStaticLayer ();
+        mRenderCacheMode = renderCacheMode;
+
+        // the desktop annotation view manages its own (transparent) background
+        if (!bIsDesktop)
+            setCacheMode (mRenderCacheMode == RenderCacheNone ? QGraphicsView::CacheNone : QGraphicsView::CacheBackground);
+    }
+
+    bool showFrameTimes = UBSettings::settings ()->boardShowFrameTimes->get ().toBool ();
+
+    if (showFrameTimes != mShowFrameTimes)
+    {
+        mShowFrameTimes = showFrameTimes;
+        mFrameTimes.clear ();
+
+        if (mShowFrameTimes)
+            mFrameTimeOverlayTimer.start ();
+        else
+            mFrameTimeOverlayTimer.stop ();
+
+        viewport ()->update (frameTimeOverlayRect ());
+    }
+}
+
+void UBBoardView::updateFrameTimeOverlay ()
+{
+    viewport ()->update (frameTimeOverlayRect ());
 }
 
 void UBBoardView::virtualKeyboardActivated(bool b)
@@ -64,6 +64,9 @@ public:
 
     void setMultiselection(bool enable);
     bool isMultipleSelectionEnabled() { return mMultipleSelectionIsEnabled; }
+
+    void beginStaticLayer();
+    void endStaticLayer();
     // work around for handling tablet events on MAC OS with Qt 4.8.0 and above
 #if defined(Q_OS_OSX)
     bool directTabletEvent(QEvent *event);
@@ -114,6 +117,8 @@ protected:
 
     virtual void drawBackground(QPainter *painter, const QRectF &rect);
 
+    virtual void paintEvent(QPaintEvent *event);
+
 private:
 
     void init();
@@ -127,6 +132,12 @@ private:
 
     QList<QUrl> processMimeData(const QMimeData* pMimeData);
 
+    bool isStaticLayerItem(QGraphicsItem *item);
+    bool isLiveItem(QGraphicsItem *item);
+    void recordFrameTime(const QRegion& region, qint64 frameTimeNs);
+    QRect frameTimeOverlayRect() const;
+    void drawFrameTimeOverlay(QPainter *painter);
+
     UBBoardController* mController;
 
     int mStartLayer, mEndLayer;
@@ -174,11 +185,31 @@ private:
     bool bIsDesktop;
     bool mRubberBandInPlayMode;
 
+    enum RenderCacheMode
+    {
+        RenderCacheNone = 0, // every exposed region is rendered from scratch
+        RenderCacheBackground, // page background cached by QGraphicsView
+        RenderCacheStaticLayer // background and existing items cached while a stroke is drawn
+    };
+
+    RenderCacheMode mRenderCacheMode;
+
+    // static layer: items present when the stroke started, composited from the background cache
+    bool mStaticLayerActive;
+    QSet<QGraphicsItem*> mStaticLayerItems;
+
+    bool mShowFrameTimes;
+    QList<qint64> mFrameTimes;
+    QTimer mFrameTimeOverlayTimer;
+
+    static const int sFrameTimeSamples;
+
     static bool hasSelectedParents(QGraphicsItem * item);
 
 private slots:
 
     void settingChanged(QVariant newValue);
+    void updateFrameTimeOverlay();
 
 public slots:
 
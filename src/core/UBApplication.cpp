@@ -42,6 +42,7 @@
 #include "UBSettings.h"
 #include "UBSetting.h"
 #include "UBPersistenceManager.h"
+#include "UBThumbnailCache.h"
 #include "UBDocumentManager.h"
 #include "UBPreferencesController.h"
 #include "UBIdleTimer.h"
@@ -60,6 +61,8 @@
 #include "gui/UBResources.h"
 #include "gui/UBThumbnailWidget.h"
 
+#include "adaptors/UBThumbnailGenerator.h"
+
 #include "ui_mainWindow.h"
 
 #include "frameworks/UBCryptoUtils.h"
@@ -93,6 +96,7 @@ UBApplication::UBApplication(const QString &id, int &argc, char **argv) : QtSing
   , mPreferencesController(NULL)
   , mApplicationTranslator(NULL)
   , mQtGuiTranslator(NULL)
+  , mClosingBlocked(false)
 {
 
     staticMemoryCleaner = new QObject(0); // deleted in UBApplication destructor
@@ -158,6 +162,8 @@ UBApplication::~UBApplication()
 
     UBPersistenceManager::destroy();
 
+    UBThumbnailCache::destroy();
+
     UBDownloadManager::destroy();
 
     UBDrawingController::destroy();
@@ -257,6 +263,38 @@ void UBApplication::setupTranslators(QStringList args)
 }
 
 int UBApplication::exec(const QString& pFileToImport)
+{
+    setupControllers();
+
+    if (pFileToImport.length() > 0)
+        UBApplication::applicationController->importFile(pFileToImport);
+
+    if (UBSettings::settings()->appStartMode->get().toInt())
+        applicationController->showDesktop();
+    else
+        applicationController->showBoard();
+
+    emit UBDrawingController::drawingController()->colorPaletteChanged();
+
+    onScreenCountChanged(1);
+    connect(desktop(), SIGNAL(screenCountChanged(int)), this, SLOT(onScreenCountChanged(int)));
+    return QApplication::exec();
+}
+
+/**
+ * @brief Generate the missing thumbnails of the whole library, without showing the user interface
+ *
+ * Loading and rendering the pages relies on the controllers, so they are created but never shown. The board
+ * doesn't get a starting document and isn't closed: only the missing thumbnails are written to the library.
+ */
+int UBApplication::generateThumbnails()
+{
+    setupControllers(false);
+
+    return UBThumbnailGenerator::generateLibraryThumbnails();
+}
+
+void UBApplication::setupControllers(bool withStartingDocument)
 {
     QPixmapCache::setCacheLimit(1024 * 100);
 
@@ -296,7 +334,7 @@ int UBApplication::exec(const QString& pFileToImport)
     connect(mainWindow, SIGNAL(closeEvent_Signal(QCloseEvent*)), this, SLOT(closeEvent(QCloseEvent*)));
 
     boardController = new UBBoardController(mainWindow);
-    boardController->init();
+    boardController->init(withStartingDocument);
 
     webController = new UBWebController(mainWindow);
     documentController = new UBDocumentController(mainWindow);
@@ -347,20 +385,6 @@ int UBApplication::exec(const QString& pFileToImport)
 
     applicationController->initScreenLayout(bUseMultiScreen);
     boardController->setupLayout();
-
-    if (pFileToImport.length() > 0)
-        UBApplication::applicationController->importFile(pFileToImport);
-
-    if (UBSettings::settings()->appStartMode->get().toInt())
-        applicationController->showDesktop();
-    else
-        applicationController->showBoard();
-
-    emit UBDrawingController::drawingController()->colorPaletteChanged();
-
-    onScreenCountChanged(1);
-    connect(desktop(), SIGNAL(screenCountChanged(int)), this, SLOT(onScreenCountChanged(int)));
-    return QApplication::exec();
 }
 
 void UBApplication::onScreenCountChanged(int newCount)
@@ -451,6 +475,12 @@ void UBApplication::closeEvent(QCloseEvent *event)
 
 void UBApplication::closing()
 {
+    // a task running from a nested event loop, e.g. an export, still uses the controllers and documents
+    if (mClosingBlocked)
+    {
+        showMessage(tr("OpenBoard will be closable once the current task is finished"));
+        return;
+    }
 
     if (boardController)
         boardController->closing();
@@ -65,6 +65,8 @@ class UBApplication : public QtSingleApplication
 
         int exec(const QString& pFileToImport);
 
+        int generateThumbnails();
+
         void cleanup();
 
         static QPointer<QUndoStack> undoStack;
@@ -99,6 +101,8 @@ class UBApplication : public QtSingleApplication
 
         bool isVerbose() { return mIsVerbose;}
         void setVerbose(bool verbose){mIsVerbose = verbose;}
+        bool isClosingBlocked() { return mClosingBlocked;}
+        void setClosingBlocked(bool blocked){mClosingBlocked = blocked;}
         static QString urlFromHtml(QString html);
         static bool isFromWeb(QString url);
 
@@ -135,10 +139,12 @@ class UBApplication : public QtSingleApplication
         void onScreenCountChanged(int newCount);
 
     private:
+        void setupControllers(bool withStartingDocument = true);
         void updateProtoActionsState();
         void setupTranslators(QStringList args);
         QList<QMenu*> mProtoMenus;
         bool mIsVerbose;
+        bool mClosingBlocked;
         QString checkLanguageAvailabilityForSankore(QString& language);
     protected:
 /*
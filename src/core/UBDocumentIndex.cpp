@@ -0,0 +1,177 @@
+/*
+ * Copyright (C) 2015-2018 Département de l'Instruction Publique (DIP-SEM)
+ *
+ * Copyright (C) 2013 Open Education Foundation
+ *
+ * Copyright (C) 2010-2013 Groupement d'Intérêt Public pour
+ * l'Education Numérique en Afrique (GIP ENA)
+ *
+ * This file is part of OpenBoard.
+ *
+ * OpenBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License,
+ * with a specific linking exception for the OpenSSL project's
+ * "OpenSSL" library (or with modified versions of it that use the
+ * same license as the "OpenSSL" library).
+ *
+ * OpenBoard is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenBoard. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "UBDocumentIndex.h"
+
+#include "adaptors/UBMetadataDcSubsetAdaptor.h"
+
+#include "core/memcheck.h"
+
+const quint32 UBDocumentIndex::sMagic = 0x55424449; // "UBDI"
+const quint32 UBDocumentIndex::sVersion = 1;
+
+UBDocumentIndex::UBDocumentIndex(const QString& indexFileName)
+    : mIndexFileName(indexFileName)
+    , mModified(false)
+{
+    // NOOP
+}
+
+UBDocumentIndex::~UBDocumentIndex()
+{
+    // NOOP
+}
+
+void UBDocumentIndex::load()
+{
+    mEntries.clear();
+    mVisitedPaths.clear();
+    mModified = false;
+
+    QFile file(mIndexFileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, version;
+    in >> magic >> version;
+
+    if (magic != sMagic || version != sVersion)
+    {
+        qDebug() << "ignoring document index" << mIndexFileName << "(unknown format)";
+        return;
+    }
+
+    qint32 entryCount;
+    in >> entryCount;
+
+    for (int i = 0; i < entryCount && in.status() == QDataStream::Ok; i++)
+    {
+        QString path;
+        Entry entry;
+        qint32 pageCount;
+
+        in >> path >> entry.folderModified >> entry.metadataModified >> pageCount >> entry.metadatas;
+        entry.pageCount = pageCount;
+
+        if (in.status() == QDataStream::Ok)
+            mEntries.insert(path, entry);
+    }
+
+    if (in.status() != QDataStream::Ok)
+    {
+        qWarning() << "document index" << mIndexFileName << "is corrupted, rebuilding it";
+        mEntries.clear();
+    }
+}
+
+/**
+ * @brief Write the index to disk, dropping the entries of the folders that were not seen since it was loaded
+ */
+void UBDocumentIndex::save()
+{
+    if (!mModified && mVisitedPaths.size() == mEntries.size())
+        return;
+
+    QSaveFile file(mIndexFileName);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        qWarning() << "cannot write document index" << mIndexFileName;
+        return;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+
+    out << sMagic << sVersion;
+    out << qint32(mVisitedPaths.size());
+
+    foreach (QString path, mVisitedPaths)
+    {
+        const Entry& entry = mEntries[path];
+        out << path << entry.folderModified << entry.metadataModified << qint32(entry.pageCount) << entry.metadatas;
+    }
+
+    if (file.commit())
+    {
+        QHash<QString, Entry> visitedEntries;
+        foreach (QString path, mVisitedPaths)
+            visitedEntries.insert(path, mEntries.value(path));
+        mEntries = visitedEntries;
+        mModified = false;
+    }
+}
+
+/**
+ * @brief Fill metadatas and pageCount from the index if the document folder didn't change since it was indexed
+ *
+ * An empty metadata map means that the folder holds no document.
+ */
+bool UBDocumentIndex::lookup(const QFileInfo& documentFolder, QMap<QString, QVariant>& metadatas, int& pageCount)
+{
+    QString path = documentFolder.absoluteFilePath();
+
+    QHash<QString, Entry>::const_iterator it = mEntries.constFind(path);
+    if (it == mEntries.constEnd())
+        return false;
+
+    // adding, removing or renaming a page changes the folder, while the metadata file is rewritten in place
+    if (it->folderModified != documentFolder.lastModified()
+            || it->metadataModified != metadataModified(documentFolder))
+        return false;
+
+    metadatas = it->metadatas;
+    pageCount = it->pageCount;
+    mVisitedPaths.insert(path);
+
+    return true;
+}
+
+void UBDocumentIndex::update(const QFileInfo& documentFolder, const QMap<QString, QVariant>& metadatas, int pageCount)
+{
+    QString path = documentFolder.absoluteFilePath();
+
+    // the folder may have been modified while probing it (e.g. a missing page has been created)
+    QFileInfo folder(path);
+
+    Entry entry;
+    entry.folderModified = folder.lastModified();
+    entry.metadataModified = metadataModified(folder);
+    entry.pageCount = pageCount;
+    entry.metadatas = metadatas;
+
+    mEntries.insert(path, entry);
+    mVisitedPaths.insert(path);
+    mModified = true;
+}
+
+QDateTime UBDocumentIndex::metadataModified(const QFileInfo& documentFolder)
+{
+    return QFileInfo(documentFolder.absoluteFilePath() + "/" + UBMetadataDcSubsetAdaptor::metadataFilename).lastModified();
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2015-2018 Département de l'Instruction Publique (DIP-SEM)
+ *
+ * Copyright (C) 2013 Open Education Foundation
+ *
+ * Copyright (C) 2010-2013 Groupement d'Intérêt Public pour
+ * l'Education Numérique en Afrique (GIP ENA)
+ *
+ * This file is part of OpenBoard.
+ *
+ * OpenBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License,
+ * with a specific linking exception for the OpenSSL project's
+ * "OpenSSL" library (or with modified versions of it that use the
+ * same license as the "OpenSSL" library).
+ *
+ * OpenBoard is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenBoard. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef UBDOCUMENTINDEX_H
+#define UBDOCUMENTINDEX_H
+
+#include <QtCore>
+
+/**
+ * @brief Persistent index of the documents found in the document repository
+ *
+ * For every document folder, the index keeps the document metadata and page count, along with the
+ * modification times of the folder and of its metadata file. As long as those didn't change, the
+ * document can be listed at startup without reading its metadata or probing its pages.
+ */
+class UBDocumentIndex
+{
+    public:
+
+        UBDocumentIndex(const QString& indexFileName);
+        virtual ~UBDocumentIndex();
+
+        void load();
+        void save();
+
+        bool lookup(const QFileInfo& documentFolder, QMap<QString, QVariant>& metadatas, int& pageCount);
+        void update(const QFileInfo& documentFolder, const QMap<QString, QVariant>& metadatas, int pageCount);
+
+    private:
+
+        struct Entry
+        {
+            QDateTime folderModified;
+            QDateTime metadataModified;
+            int pageCount;
+            QMap<QString, QVariant> metadatas;
+        };
+
+        static QDateTime metadataModified(const QFileInfo& documentFolder);
+
+        QString mIndexFileName;
+        QHash<QString, Entry> mEntries;
+        QSet<QString> mVisitedPaths;
+        bool mModified;
+
+        static const quint32 sMagic;
+        static const quint32 sVersion;
+};
+
+#endif // UBDOCUMENTINDEX_H
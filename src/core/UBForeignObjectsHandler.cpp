@@ -639,8 +639,9 @@ void UBForeighnObjectsHandler::cure(const QUrl &dir)
     d->cure(dir);
 }
 
-void UBForeighnObjectsHandler::copyPage(const QUrl &fromDir, int fromIndex, const QUrl &toDir, int toIndex)
+// page files are designated by their number, which is not the index of the page in its document
+void UBForeighnObjectsHandler::copyPage(const QUrl &fromDir, int fromPageFile, const QUrl &toDir, int toPageFile)
 {
-    d->copyPage(fromDir, fromIndex, toDir, toIndex);
+    d->copyPage(fromDir, fromPageFile, toDir, toPageFile);
 }
 
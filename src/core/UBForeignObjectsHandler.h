@@ -42,8 +42,8 @@ public:
     void cure(const QList<QUrl> &dirs);
     void cure(const QUrl &dir);
 
-    void copyPage(const QUrl &fromDir, int fromIndex,
-                  const QUrl &toDir, int toIndex);
+    void copyPage(const QUrl &fromDir, int fromPageFile,
+                  const QUrl &toDir, int toPageFile);
 
 private:
     UBForeighnObjectsHandlerPrivate *d;
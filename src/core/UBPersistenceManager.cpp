@@ -42,6 +42,8 @@
 #include "core/UBSettings.h"
 #include "core/UBSetting.h"
 #include "core/UBForeignObjectsHandler.h"
+#include "core/UBDocumentIndex.h"
+#include "core/UBThumbnailCache.h"
 
 #include "document/UBDocumentProxy.h"
 
@@ -49,6 +51,7 @@
 #include "adaptors/UBSvgSubsetAdaptor.h"
 #include "adaptors/UBThumbnailAdaptor.h"
 #include "adaptors/UBMetadataDcSubsetAdaptor.h"
+#include "adaptors/UBPageOrderAdaptor.h"
 
 #include "domain/UBGraphicsMediaItem.h"
 #include "domain/UBGraphicsWidgetItem.h"
@@ -73,6 +76,7 @@ const QString UBPersistenceManager::myDocumentsName = "MyDocuments";
 const QString UBPersistenceManager::modelsName = "Models";
 const QString UBPersistenceManager::untitledDocumentsName = "UntitledDocuments";
 const QString UBPersistenceManager::fFolders = "folders.xml";
+const QString UBPersistenceManager::fDocumentIndex = "documents.index";
 const QString UBPersistenceManager::tFolder = "folder";
 const QString UBPersistenceManager::aName = "name";
 
@@ -80,6 +84,7 @@ UBPersistenceManager * UBPersistenceManager::sSingleton = 0;
 
 UBPersistenceManager::UBPersistenceManager(QObject *pParent)
     : QObject(pParent)
+    , mPrefetchGeneration(0)
     , mHasPurgedDocuments(false)
 {
 
@@ -95,6 +100,23 @@ UBPersistenceManager::UBPersistenceManager(QObject *pParent)
     mDocumentRepositoryPath = UBSettings::userDocumentDirectory();
     mFoldersXmlStorageName =  mDocumentRepositoryPath + "/" + fFolders;
 
+    mDocumentIndex = new UBDocumentIndex(mDocumentRepositoryPath + "/" + fDocumentIndex);
+    mDocumentIndex->load();
+
+    mPersistenceWorker = new UBPersistenceWorker();
+    mPersistenceWorkerThread = new QThread();
+    mPersistenceWorker->moveToThread(mPersistenceWorkerThread);
+    connect(mPersistenceWorkerThread, SIGNAL(started()), mPersistenceWorker, SLOT(process()));
+    // direct connection: the GUI thread may be blocked waiting for the thread to finish
+    connect(mPersistenceWorker, SIGNAL(finished()), mPersistenceWorkerThread, SLOT(quit()), Qt::DirectConnection);
+    qRegisterMetaType<UBDecodedImages>("UBDecodedImages");
+    qRegisterMetaType<UBDocumentProxy*>("UBDocumentProxy*");
+    connect(mPersistenceWorker, SIGNAL(sceneLoaded(QByteArray, UBDecodedImages, UBDocumentProxy*, int, int)),
+            this, SLOT(scenePrefetched(QByteArray, UBDecodedImages, UBDocumentProxy*, int, int)), Qt::QueuedConnection);
+    connect(mPersistenceWorker, SIGNAL(thumbnailPersisted(QString, QImage)),
+            this, SLOT(thumbnailPersisted(QString, QImage)), Qt::QueuedConnection);
+    mPersistenceWorkerThread->start();
+
     mDocumentTreeStructureModel = new UBDocumentTreeModel(this);
     createDocumentProxiesStructure();
 
@@ -121,6 +143,14 @@ void UBPersistenceManager::destroy()
 
 UBPersistenceManager::~UBPersistenceManager()
 {
+    // the worker processes everything still queued before stopping
+    mPersistenceWorker->applicationWillClose();
+    mPersistenceWorkerThread->wait();
+
+    delete mPersistenceWorker;
+    delete mPersistenceWorkerThread;
+
+    delete mDocumentIndex;
 }
 
 void UBPersistenceManager::createDocumentProxiesStructure(bool interactive)
@@ -133,6 +163,8 @@ void UBPersistenceManager::createDocumentProxiesStructure(bool interactive)
     QFileInfoList contentList = rootDir.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Time | QDir::Reversed);
     createDocumentProxiesStructure(contentList, interactive);
 
+    mDocumentIndex->save();
+
     if (QFileInfo(mFoldersXmlStorageName).exists()) {
         QDomDocument xmlDom;
         QFile inFile(mFoldersXmlStorageName);
@@ -160,20 +192,38 @@ void UBPersistenceManager::createDocumentProxiesStructure(bool interactive)
 
 void UBPersistenceManager::createDocumentProxiesStructure(const QFileInfoList &contentInfo, bool interactive)
 {
+    // imported documents are always read from disk, the index only covers the repository scan
+    bool useIndex = !interactive;
+
     foreach(QFileInfo path, contentInfo)
     {
         QString fullPath = path.absoluteFilePath();
 
-        QDir dir(fullPath);
+        QMap<QString, QVariant> metadatas;
+        int pageCount = -1;
+
+        bool indexed = useIndex && mDocumentIndex->lookup(path, metadatas, pageCount);
 
-        if (dir.entryList(QDir::Files | QDir::NoDotAndDotDot).size() > 0)
+        if (!indexed)
+        {
+            QDir dir(fullPath);
+
+            if (dir.entryList(QDir::Files | QDir::NoDotAndDotDot).size() > 0)
+                metadatas = UBMetadataDcSubsetAdaptor::load(fullPath);
+
+            if (metadatas.isEmpty() && useIndex)
+                mDocumentIndex->update(path, metadatas, 0);
+        }
+
+        if (!metadatas.isEmpty())
         {
-            QMap<QString, QVariant> metadatas = UBMetadataDcSubsetAdaptor::load(fullPath);
             QString docGroupName = metadatas.value(UBSettings::documentGroupName, QString()).toString();
             QString docName = metadatas.value(UBSettings::documentName, QString()).toString();
 
             if (docName.isEmpty()) {
                 qDebug() << "Group name and document name are empty in UBPersistenceManager::createDocumentProxiesStructure()";
+                if (!indexed && useIndex)
+                    mDocumentIndex->update(path, metadatas, 0);
                 continue;
             }
 
@@ -187,7 +237,13 @@ void UBPersistenceManager::createDocumentProxiesStructure(const QFileInfoList &c
                 docProxy->setMetaData(key, metadatas.value(key));
             }
 
-            docProxy->setPageCount(sceneCount(docProxy));
+            if (!indexed) {
+                pageCount = sceneCount(docProxy);
+                if (useIndex)
+                    mDocumentIndex->update(path, metadatas, pageCount);
+            }
+
+            docProxy->setPageCount(pageCount);
             bool addDoc = false;
             if (!interactive) {
                 addDoc = true;
@@ -280,6 +336,8 @@ QString UBPersistenceManager::adjustDocumentVirtualPath(const QString &str)
 
 void UBPersistenceManager::closing()
 {
+    flushPendingSaves();
+
     QDir rootDir(mDocumentRepositoryPath);
     rootDir.mkpath(rootDir.path());
 
@@ -507,6 +565,10 @@ UBDocumentProxy* UBPersistenceManager::createDocumentFromDir(const QString& pDoc
     }
 
     doc->setUuid(QUuid::createUuid());
+
+    // the title page may have been written without being inserted, so the pages are read again
+    flushPendingSaves();
+    mPageFiles.remove(doc->persistencePath());
     doc->setPageCount(sceneCount(doc));
 
     for(int i = 0; i < doc->pageCount(); i++)
@@ -539,12 +601,16 @@ void UBPersistenceManager::deleteDocument(UBDocumentProxy* pDocumentProxy)
 {
     checkIfDocumentRepositoryExists();
 
+    flushPendingSaves();
+    cancelPrefetch();
+
     emit documentWillBeDeleted(pDocumentProxy);
 
     if (QFileInfo(pDocumentProxy->persistencePath()).exists())
         UBFileSystemUtils::deleteDir(pDocumentProxy->persistencePath());
 
     mSceneCache.removeAllScenes(pDocumentProxy);
+    mPageFiles.remove(pDocumentProxy->persistencePath());
 
     pDocumentProxy->deleteLater();
 }
@@ -553,6 +619,8 @@ UBDocumentProxy* UBPersistenceManager::duplicateDocument(UBDocumentProxy* pDocum
 {
     checkIfDocumentRepositoryExists();
 
+    flushPendingSaves();
+
     UBDocumentProxy *copy = new UBDocumentProxy(); // deleted in UBPersistenceManager::destructor
 
     generatePathIfNeeded(copy);
@@ -592,7 +660,9 @@ void UBPersistenceManager::deleteDocumentScenes(UBDocumentProxy* proxy, const QL
 {
     checkIfDocumentRepositoryExists();
 
-    int pageCount = UBPersistenceManager::persistenceManager()->sceneCount(proxy);
+    cancelPrefetch();
+
+    int pageCount = sceneCount(proxy);
 
     QList<int> compactedIndexes;
 
@@ -616,70 +686,153 @@ void UBPersistenceManager::deleteDocumentScenes(UBDocumentProxy* proxy, const QL
         emit documentSceneWillBeDeleted(proxy, index);
     }
 
+    // the trash gets the latest state of the pages, including the changes not saved yet
+    foreach(int index, compactedIndexes)
+    {
+        UBGraphicsScene* scene = mSceneCache.value(UBSceneCacheID(proxy, index));
+        if (scene && scene->isModified())
+            persistDocumentScene(proxy, scene, index);
+    }
+
+    flushPendingSaves();
+
     QString sourceName = proxy->metaData(UBSettings::documentName).toString();
     UBDocumentProxy *trashDocProxy = createDocument(UBSettings::trashedDocumentGroupNamePrefix/* + sourceGroupName*/, sourceName, false);
 
+    qSort(compactedIndexes);
+
+    moveDocumentScenes(proxy, compactedIndexes, trashDocProxy);
+
+    UBMetadataDcSubsetAdaptor::persist(trashDocProxy);
+
+    // from the last page to the first, so that the indexes of the pages left to delete don't change
+    qSort(compactedIndexes.begin(), compactedIndexes.end(), qGreater<int>());
+
     foreach(int index, compactedIndexes)
     {
-        UBGraphicsScene *scene = loadDocumentScene(proxy, index);
-        if (scene)
-        {
-            //scene is about to move into new document
-            foreach (QUrl relativeFile, scene->relativeDependencies())
-            {
-                QString source = scene->document()->persistencePath() + "/" + relativeFile.toString();
-                QString target = trashDocProxy->persistencePath() + "/" + relativeFile.toString();
+        removePageFile(proxy, index);
 
-                QFileInfo fi(target);
-                QDir d = fi.dir();
+        mSceneCache.removeScene(proxy, index);
 
-                d.mkpath(d.absolutePath());
-                QFile::copy(source, target);
-            }
+        for (int i = index + 1; i < pageCount; i++)
+            mSceneCache.moveScene(proxy, i, i - 1);
 
-            insertDocumentSceneAt(trashDocProxy, scene, trashDocProxy->pageCount());
-        }
-    }
+        pageCount--;
 
-    for (int i = 1; i < pageCount; i++)
-    {
-        renamePage(trashDocProxy, i , i - 1);
+        proxy->decPageCount();
     }
+}
 
-    foreach(int index, compactedIndexes)
+
+/**
+ * @brief Move the files of pages to the end of another document, along with the files they depend on
+ *
+ * No scene is created. The pages are not removed from the page order of the source document, only their
+ * files are moved. A dependency which is still used by a page left in the source document is hard linked
+ * into the target document (or copied if the file system can't), the others are moved. Pending saves must
+ * have been flushed.
+ */
+void UBPersistenceManager::moveDocumentScenes(UBDocumentProxy* from, const QList<int>& indexes, UBDocumentProxy* to)
+{
+    QString fromPath = from->persistencePath();
+    QString toPath = to->persistencePath();
+
+    QStringList dependencies;
+
+    foreach(int index, indexes)
     {
-        QString svgFileName = proxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.svg", index);
+        QString sceneFile = sceneFileName(from, index);
+        QString thumbnailFile = thumbnailFileName(from, index);
 
-        QFile::remove(svgFileName);
+        QFile file(sceneFile);
+        if (file.open(QIODevice::ReadOnly))
+        {
+            foreach(QString dependency, UBSvgSubsetAdaptor::sceneDependencies(UBSvgSubsetAdaptor::cleanSceneData(file.readAll())))
+            {
+                if (!dependencies.contains(dependency))
+                    dependencies << dependency;
+            }
 
-        QString thumbFileName = proxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.jpg", index);
+            file.close();
+        }
 
-        QFile::remove(thumbFileName);
+        int toFile = insertPageFile(to, sceneCount(to));
 
-        mSceneCache.removeScene(proxy, index);
+        UBFileSystemUtils::moveFile(sceneFile, UBPageOrderAdaptor::sceneFileName(toPath, toFile));
+        UBFileSystemUtils::moveFile(thumbnailFile, UBPageOrderAdaptor::thumbnailFileName(toPath, toFile));
+        UBThumbnailCache::thumbnailCache()->remove(thumbnailFile);
+        UBThumbnailCache::thumbnailCache()->remove(UBPageOrderAdaptor::thumbnailFileName(toPath, toFile));
 
-        proxy->decPageCount();
+        to->incPageCount();
+    }
+
+    if (dependencies.isEmpty())
+        return;
+
+    QSet<QString> shared = sharedDependencies(from, indexes, dependencies);
+
+    foreach(QString dependency, dependencies)
+    {
+        QString source = fromPath + "/" + dependency;
+        QString target = toPath + "/" + dependency;
 
+        if (!QFileInfo(source).exists())
+            continue;
+
+        if (shared.contains(dependency))
+            UBFileSystemUtils::linkOrCopy(source, target);
+        else
+            UBFileSystemUtils::moveFile(source, target);
     }
+}
 
-    qSort(compactedIndexes);
 
-    int offset = 1;
+/**
+ * @brief Return the dependencies which are referenced by a page of the document other than the excluded ones
+ *
+ * Dependencies are named after the uuid of their item, so page files are searched for that uuid rather than
+ * parsed; a widget and its screenshot share the same one. Cached scenes are asked as well, as they may hold
+ * items which were not saved yet.
+ */
+QSet<QString> UBPersistenceManager::sharedDependencies(UBDocumentProxy* pDocumentProxy, const QList<int>& excludedIndexes, const QStringList& dependencies)
+{
+    QHash<QString, QByteArray> keys;
+    foreach(QString dependency, dependencies)
+        keys.insert(dependency, QFileInfo(dependency).completeBaseName().remove("{").remove("}").toUtf8());
 
-    for (int i = compactedIndexes.at(0) + 1; i < pageCount; i++)
+    QSet<QString> shared;
+
+    int count = sceneCount(pDocumentProxy);
+
+    for (int i = 0; i < count && shared.size() < dependencies.size(); i++)
     {
-        if(compactedIndexes.contains(i))
+        if (excludedIndexes.contains(i))
+            continue;
+
+        QByteArray sceneData;
+
+        QFile file(sceneFileName(pDocumentProxy, i));
+        if (file.open(QIODevice::ReadOnly))
         {
-            offset++;
+            sceneData = file.readAll();
+            file.close();
         }
-        else
-        {
-            renamePage(proxy, i , i - offset);
 
-            mSceneCache.moveScene(proxy, i, i - offset);
+        UBGraphicsScene* scene = mSceneCache.value(UBSceneCacheID(pDocumentProxy, i));
+        if (scene)
+        {
+            foreach(QUrl relativeFile, scene->relativeDependencies())
+                sceneData.append(relativeFile.toString().toUtf8());
+        }
 
+        foreach(QString dependency, dependencies)
+        {
+            if (!shared.contains(dependency) && sceneData.contains(keys.value(dependency)))
+                shared << dependency;
         }
     }
+
+    return shared;
 }
 
 
@@ -687,15 +840,9 @@ void UBPersistenceManager::duplicateDocumentScene(UBDocumentProxy* proxy, int in
 {
     checkIfDocumentRepositoryExists();
 
-    int pageCount = UBPersistenceManager::persistenceManager()->sceneCount(proxy);
-
-    for (int i = pageCount; i > index + 1; i--)
-    {
-        renamePage(proxy, i - 1 , i);
-
-        mSceneCache.moveScene(proxy, i - 1, i);
+    int pageCount = sceneCount(proxy);
 
-    }
+    mSceneCache.shiftUpScenes(proxy, index + 1, pageCount - 1);
 
     copyPage(proxy, index , index + 1);
 
@@ -784,40 +931,41 @@ void UBPersistenceManager::copyDocumentScene(UBDocumentProxy *from, int fromInde
 
     checkIfDocumentRepositoryExists();
 
-    for (int i = to->pageCount(); i > toIndex; i--) {
-        renamePage(to, i - 1, i);
-        mSceneCache.moveScene(to, i - 1, i);
-    }
+    flushPendingSaves();
+
+    mSceneCache.shiftUpScenes(to, toIndex, to->pageCount() - 1);
+
+    int fromFile = pageFile(from, fromIndex);
+    int toFile = insertPageFile(to, toIndex);
 
     UBForeighnObjectsHandler hl;
-    hl.copyPage(QUrl::fromLocalFile(from->persistencePath()), fromIndex,
-                QUrl::fromLocalFile(to->persistencePath()), toIndex);
+    hl.copyPage(QUrl::fromLocalFile(from->persistencePath()), fromFile,
+                QUrl::fromLocalFile(to->persistencePath()), toFile);
 
     to->incPageCount();
 
-    QString thumbTmp(from->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.jpg", fromIndex));
-    QString thumbTo(to->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.jpg", toIndex));
+    QString thumbTmp(UBPageOrderAdaptor::thumbnailFileName(from->persistencePath(), fromFile));
+    QString thumbTo(UBPageOrderAdaptor::thumbnailFileName(to->persistencePath(), toFile));
 
     QFile::remove(thumbTo);
     QFile::copy(thumbTmp, thumbTo);
+    UBThumbnailCache::thumbnailCache()->remove(thumbTo);
 
     Q_ASSERT(QFileInfo(thumbTmp).exists());
     Q_ASSERT(QFileInfo(thumbTo).exists());
-    const QPixmap *pix = new QPixmap(thumbTmp);
     UBDocumentController *ctrl = UBApplication::documentController;
-    ctrl->addPixmapAt(pix, toIndex);
+    emit ctrl->documentThumbnailsUpdated(ctrl);
     ctrl->TreeViewSelectionChanged(ctrl->firstSelectedTreeIndex(), QModelIndex());
 
 //    emit documentSceneCreated(to, toIndex + 1);
 }
 
 
-UBGraphicsScene* UBPersistenceManager::createDocumentSceneAt(UBDocumentProxy* proxy, int index, bool useUndoRedoStack)
+UBGraphicsScene* UBPersistenceManager::createDocumentSceneAt(UBDocumentProxy* proxy, int index, bool useUndoRedoStack, bool persist)
 {
     int count = sceneCount(proxy);
 
-    for(int i = count - 1; i >= index; i--)
-        renamePage(proxy, i , i + 1);
+    insertPageFile(proxy, index);
 
     mSceneCache.shiftUpScenes(proxy, index, count -1);
 
@@ -828,7 +976,8 @@ UBGraphicsScene* UBPersistenceManager::createDocumentSceneAt(UBDocumentProxy* pr
 
     newScene->setBackgroundGridSize(UBSettings::settings()->crossSize);
 
-    persistDocumentScene(proxy, newScene, index);
+    if (persist)
+        persistDocumentScene(proxy, newScene, index);
 
     proxy->incPageCount();
 
@@ -844,10 +993,7 @@ void UBPersistenceManager::insertDocumentSceneAt(UBDocumentProxy* proxy, UBGraph
 
     int count = sceneCount(proxy);
 
-    for(int i = count - 1; i >= index; i--)
-    {
-        renamePage(proxy, i , i + 1);
-    }
+    insertPageFile(proxy, index);
 
     mSceneCache.shiftUpScenes(proxy, index, count -1);
 
@@ -868,35 +1014,16 @@ void UBPersistenceManager::moveSceneToIndex(UBDocumentProxy* proxy, int source,
 {
     checkIfDocumentRepositoryExists();
 
-    if (source == target)
-        return;
-
-    QFile svgTmp(proxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.svg", source));
-    svgTmp.rename(proxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.tmp", target));
+    QList<int>& files = pageFiles(proxy);
 
-    QFile thumbTmp(proxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.jpg", source));
-    thumbTmp.rename(proxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.tmp", target));
-
-    if (source < target)
-    {
-        for (int i = source + 1; i <= target; i++)
-        {
-            renamePage(proxy, i , i - 1);
-        }
-    }
-    else
-    {
-        for (int i = source - 1; i >= target; i--)
-        {
-            renamePage(proxy, i , i + 1);
-        }
-    }
+    if (source == target || source < 0 || source >= files.size() || target < 0 || target >= files.size())
+        return;
 
-    QFile svg(proxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.tmp", target));
-    svg.rename(proxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.svg", target));
+    cancelPrefetch();
 
-    QFile thumb(proxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.tmp", target));
-    thumb.rename(proxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.jpg", target));
+    // the pages keep their files, so the saves still pending for them remain valid
+    files.move(source, target);
+    persistPageOrder(proxy);
 
     mSceneCache.moveScene(proxy, source, target);
 }
@@ -904,9 +1031,13 @@ void UBPersistenceManager::moveSceneToIndex(UBDocumentProxy* proxy, int source,
 
 UBGraphicsScene* UBPersistenceManager::loadDocumentScene(UBDocumentProxy* proxy, int sceneIndex)
 {
-    if (mSceneCache.contains(proxy, sceneIndex))
-        return mSceneCache.value(proxy, sceneIndex);
+    UBGraphicsScene* cachedScene = mSceneCache.value(proxy, sceneIndex);
+
+    if (cachedScene)
+        return cachedScene;
     else {
+        flushPendingSaves();
+
         UBGraphicsScene* scene = UBSvgSubsetAdaptor::loadScene(proxy, sceneIndex);
         if(!scene){
             createDocumentSceneAt(proxy,0);
@@ -925,7 +1056,7 @@ void UBPersistenceManager::reassignDocProxy(UBDocumentProxy *newDocument, UBDocu
     return mSceneCache.reassignDocProxy(newDocument, oldDocument);
 }
 
-void UBPersistenceManager::persistDocumentScene(UBDocumentProxy* pDocumentProxy, UBGraphicsScene* pScene, const int pSceneIndex)
+void UBPersistenceManager::persistDocumentScene(UBDocumentProxy* pDocumentProxy, UBGraphicsScene* pScene, const int pSceneIndex, const QImage& pThumbnail)
 {
     checkIfDocumentRepositoryExists();
 
@@ -934,16 +1065,58 @@ void UBPersistenceManager::persistDocumentScene(UBDocumentProxy* pDocumentProxy,
     generatePathIfNeeded(pDocumentProxy);
 
     QDir dir(pDocumentProxy->persistencePath());
-    dir.mkpath(pDocumentProxy->persistencePath());
+    if (!dir.exists())
+    {
+        dir.mkpath(pDocumentProxy->persistencePath());
+        // the page order of a new document could not be written before its directory existed
+        persistPageOrder(pDocumentProxy);
+    }
 
-    if (pDocumentProxy->isModified())
+    bool suspended = isPersistenceSuspended(pDocumentProxy);
+
+    // the metadata of a suspended document is written when it is resumed
+    if (pDocumentProxy->isModified() && !suspended)
         UBMetadataDcSubsetAdaptor::persist(pDocumentProxy);
 
     if (pScene->isModified())
     {
-        UBSvgSubsetAdaptor::persistScene(pDocumentProxy, pScene, pSceneIndex);
+        // Walking the items needs the scene, so the page is snapshot here: its structure is serialized and the
+        // painting of its thumbnail recorded. Formatting the stroke points, rasterizing and encoding the
+        // thumbnail, and writing the files are left to the persistence worker
+        QString sceneFile = sceneFileName(pDocumentProxy, pSceneIndex);
+        QString thumbnailFile = thumbnailFileName(pDocumentProxy, pSceneIndex);
+
+        UBSvgSubsetAdaptor::SceneSnapshot sceneSnapshot = UBSvgSubsetAdaptor::snapshotScene(pDocumentProxy, pScene, pSceneIndex);
 
-        UBThumbnailAdaptor::persistScene(pDocumentProxy, pScene, pSceneIndex);
+        // importers may provide thumbnails rendered in the background
+        QPicture thumbnailPicture;
+        if (pThumbnail.isNull())
+            thumbnailPicture = UBThumbnailAdaptor::recordThumbnail(pScene);
+
+        if (suspended)
+        {
+            // keep only the latest version of the page, it is written when the document is resumed
+            QList<DeferredSceneSave>& deferredSaves = mDeferredSceneSaves[pDocumentProxy];
+
+            for (int i = deferredSaves.size() - 1; i >= 0; i--)
+            {
+                if (deferredSaves.at(i).sceneFileName == sceneFile)
+                    deferredSaves.removeAt(i);
+            }
+
+            DeferredSceneSave deferredSave;
+            deferredSave.sceneFileName = sceneFile;
+            deferredSave.sceneSnapshot = sceneSnapshot;
+            deferredSave.thumbnailFileName = thumbnailFile;
+            deferredSave.thumbnail = pThumbnail;
+            deferredSave.thumbnailPicture = thumbnailPicture;
+            deferredSaves << deferredSave;
+        }
+        else
+        {
+            // the thumbnail is cached when the worker has written it, see thumbnailPersisted()
+            mPersistenceWorker->saveSceneSnapshot(sceneFile, sceneSnapshot, thumbnailFile, pThumbnail, thumbnailPicture);
+        }
 
         pScene->setModified(false);
     }
@@ -962,65 +1135,255 @@ UBDocumentProxy* UBPersistenceManager::persistDocumentMetadata(UBDocumentProxy*
 }
 
 
-void UBPersistenceManager::renamePage(UBDocumentProxy* pDocumentProxy, const int sourceIndex, const int targetIndex)
+void UBPersistenceManager::flushPendingSaves()
+{
+    mPersistenceWorker->waitForPendingSaves();
+}
+
+
+QImage UBPersistenceManager::pendingThumbnail(const QString& thumbnailFileName)
+{
+    return mPersistenceWorker->pendingThumbnail(thumbnailFileName);
+}
+
+
+/**
+ * @brief Stop writing to the folder of a document, so that it can be read consistently, e.g. while it is exported
+ *
+ * The pages already queued are written first. Pages saved afterwards are kept in memory, and missing thumbnails
+ * of the document are not generated, until resumePersistence() is called.
+ */
+void UBPersistenceManager::suspendPersistence(UBDocumentProxy* pDocumentProxy)
+{
+    mSuspendedDocuments.insert(pDocumentProxy);
+
+    flushPendingSaves();
+}
+
+
+void UBPersistenceManager::resumePersistence(UBDocumentProxy* pDocumentProxy)
+{
+    if (!mSuspendedDocuments.remove(pDocumentProxy))
+        return;
+
+    if (pDocumentProxy->isModified())
+        UBMetadataDcSubsetAdaptor::persist(pDocumentProxy);
+
+    foreach(const DeferredSceneSave& deferredSave, mDeferredSceneSaves.take(pDocumentProxy))
+    {
+        mPersistenceWorker->saveSceneSnapshot(deferredSave.sceneFileName, deferredSave.sceneSnapshot,
+                                              deferredSave.thumbnailFileName, deferredSave.thumbnail,
+                                              deferredSave.thumbnailPicture);
+    }
+
+    UBThumbnailCache::thumbnailCache()->resumeGeneration();
+}
+
+
+/**
+ * @brief Prepare the pages around the given one on the persistence worker, so that turning to them doesn't
+ * need to read and decode them
+ *
+ * Pending prefetches of other pages are cancelled.
+ */
+void UBPersistenceManager::prefetchNeighbourScenes(UBDocumentProxy* pDocumentProxy, int sceneIndex)
 {
-    QFile svg(pDocumentProxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.svg", sourceIndex));
-    svg.rename(pDocumentProxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.svg",  targetIndex));
+    cancelPrefetch();
+
+    QList<int> neighbours;
+    neighbours << sceneIndex + 1 << sceneIndex - 1;
 
-    QFile thumb(pDocumentProxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.jpg", sourceIndex));
-    thumb.rename(pDocumentProxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.jpg", targetIndex));
+    foreach(int index, neighbours)
+    {
+        if (index >= 0 && index < pDocumentProxy->pageCount() && !mSceneCache.contains(pDocumentProxy, index))
+            mPersistenceWorker->readScene(pDocumentProxy, index, mPrefetchGeneration);
+    }
+}
+
+
+/**
+ * @brief Forget about the prefetches in progress, e.g. because pages are about to change indexes
+ */
+void UBPersistenceManager::cancelPrefetch()
+{
+    mPrefetchGeneration++;
+    mPersistenceWorker->cancelReads();
+}
+
+
+/**
+ * @brief Show the thumbnail of a page saved by the persistence worker, replacing the previous one if it was cached
+ */
+void UBPersistenceManager::thumbnailPersisted(QString thumbnailFileName, QImage thumbnail)
+{
+    UBThumbnailCache::thumbnailCache()->insert(thumbnailFileName, thumbnail);
+}
+
+
+void UBPersistenceManager::scenePrefetched(QByteArray sceneData, UBDecodedImages images, UBDocumentProxy* pDocumentProxy, int sceneIndex, int generation)
+{
+    // the document may have been changed or even deleted since the prefetch was requested
+    if (generation != mPrefetchGeneration || sceneData.isEmpty())
+        return;
+
+    if (mSceneCache.contains(pDocumentProxy, sceneIndex))
+        return;
+
+    UBGraphicsScene* scene = UBSvgSubsetAdaptor::loadScene(pDocumentProxy, sceneData, images);
+
+    if (scene)
+        mSceneCache.insert(pDocumentProxy, sceneIndex, scene);
 }
 
 
 void UBPersistenceManager::copyPage(UBDocumentProxy* pDocumentProxy, const int sourceIndex, const int targetIndex)
 {
-    QFile svg(pDocumentProxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.svg",sourceIndex));
-    svg.copy(pDocumentProxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.svg", targetIndex));
+    flushPendingSaves();
+
+    QString path = pDocumentProxy->persistencePath();
+
+    int sourceFile = pageFile(pDocumentProxy, sourceIndex);
+    int targetFile = insertPageFile(pDocumentProxy, targetIndex);
+
+    QFile svg(UBPageOrderAdaptor::sceneFileName(path, sourceFile));
+    svg.copy(UBPageOrderAdaptor::sceneFileName(path, targetFile));
 
     UBSvgSubsetAdaptor::setSceneUuid(pDocumentProxy, targetIndex, QUuid::createUuid());
 
-    QFile thumb(pDocumentProxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.jpg", sourceIndex));
-    thumb.copy(pDocumentProxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.jpg", targetIndex));
+    QFile thumb(UBPageOrderAdaptor::thumbnailFileName(path, sourceFile));
+    thumb.copy(UBPageOrderAdaptor::thumbnailFileName(path, targetFile));
+    UBThumbnailCache::thumbnailCache()->remove(UBPageOrderAdaptor::thumbnailFileName(path, targetFile));
 }
 
 
-int UBPersistenceManager::sceneCount(const UBDocumentProxy* proxy)
+int UBPersistenceManager::sceneCount(UBDocumentProxy* proxy)
 {
-    const QString pPath = proxy->persistencePath();
+    return pageFiles(proxy).size();
+}
 
-    int pageIndex = 0;
-    bool moreToProcess = true;
-    bool addedMissingZeroPage = false;
 
-    while (moreToProcess)
+QString UBPersistenceManager::sceneFileName(UBDocumentProxy* pDocumentProxy, int sceneIndex)
+{
+    int file = pageFile(pDocumentProxy, sceneIndex);
+
+    return UBPageOrderAdaptor::sceneFileName(pDocumentProxy->persistencePath(), file);
+}
+
+
+QString UBPersistenceManager::thumbnailFileName(UBDocumentProxy* pDocumentProxy, int sceneIndex)
+{
+    int file = pageFile(pDocumentProxy, sceneIndex);
+
+    return UBPageOrderAdaptor::thumbnailFileName(pDocumentProxy->persistencePath(), file);
+}
+
+
+/**
+ * @brief Return the file numbers of the pages of a document in page order, reading them on first use
+ *
+ * Page files are never renumbered when pages are inserted or moved, only this list changes.
+ */
+QList<int>& UBPersistenceManager::pageFiles(UBDocumentProxy* pDocumentProxy)
+{
+    generatePathIfNeeded(pDocumentProxy);
+
+    QString path = pDocumentProxy->persistencePath();
+
+    if (!mPageFiles.contains(path))
     {
-        QString fileName = pPath + UBFileSystemUtils::digitFileFormat("/page%1.svg", pageIndex);
+        // pages still queued for writing must be found on disk
+        flushPendingSaves();
+        mPageFiles.insert(path, UBPageOrderAdaptor::load(path));
+    }
 
-        QFile file(fileName);
+    return mPageFiles[path];
+}
 
-        if (file.exists())
-        {
-            pageIndex++;
-        }
-        else
-        {
-            moreToProcess = false;
-        }
+
+int UBPersistenceManager::pageFile(UBDocumentProxy* pDocumentProxy, int sceneIndex)
+{
+    QList<int>& files = pageFiles(pDocumentProxy);
+
+    if (sceneIndex >= 0 && sceneIndex < files.size())
+        return files.at(sceneIndex);
+
+    // pages past the end, e.g. written before being inserted, get numbers no other page uses
+    int lastFile = -1;
+    foreach(int file, files)
+        lastFile = qMax(lastFile, file);
+
+    return lastFile + 1 + qMax(0, sceneIndex - files.size());
+}
+
+
+/**
+ * @brief Reserve the file of a new page at the given index and return its number
+ */
+int UBPersistenceManager::insertPageFile(UBDocumentProxy* pDocumentProxy, int sceneIndex)
+{
+    cancelPrefetch();
+
+    QList<int>& files = pageFiles(pDocumentProxy);
+
+    int newFile = pageFile(pDocumentProxy, files.size());
+    files.insert(qBound(0, sceneIndex, files.size()), newFile);
+
+    persistPageOrder(pDocumentProxy);
+
+    return newFile;
+}
+
+
+/**
+ * @brief Delete the files of a page, and give its number to the page with the highest one
+ *
+ * Keeping the file numbers contiguous lets versions that don't know about the page order find every page.
+ * Pending saves must have been flushed.
+ */
+void UBPersistenceManager::removePageFile(UBDocumentProxy* pDocumentProxy, int sceneIndex)
+{
+    cancelPrefetch();
+
+    QString path = pDocumentProxy->persistencePath();
+    QList<int>& files = pageFiles(pDocumentProxy);
+
+    if (sceneIndex < 0 || sceneIndex >= files.size())
+        return;
+
+    int removedFile = files.takeAt(sceneIndex);
+
+    QFile::remove(UBPageOrderAdaptor::sceneFileName(path, removedFile));
+    QFile::remove(UBPageOrderAdaptor::thumbnailFileName(path, removedFile));
+    UBThumbnailCache::thumbnailCache()->remove(UBPageOrderAdaptor::thumbnailFileName(path, removedFile));
+
+    int lastIndex = -1;
+    for (int i = 0; i < files.size(); i++)
+    {
+        if (lastIndex < 0 || files.at(i) > files.at(lastIndex))
+            lastIndex = i;
     }
 
-    if(pageIndex == 1 && addedMissingZeroPage){
-        // increment is done only to check if there are other pages than the missing zero page
-        // This situation means -> no pages on the document
-        return 0;
+    if (lastIndex >= 0 && files.at(lastIndex) > removedFile)
+    {
+        int lastFile = files.at(lastIndex);
+
+        if (QFile::rename(UBPageOrderAdaptor::sceneFileName(path, lastFile), UBPageOrderAdaptor::sceneFileName(path, removedFile)))
+        {
+            QFile::rename(UBPageOrderAdaptor::thumbnailFileName(path, lastFile), UBPageOrderAdaptor::thumbnailFileName(path, removedFile));
+            UBThumbnailCache::thumbnailCache()->remove(UBPageOrderAdaptor::thumbnailFileName(path, lastFile));
+            files[lastIndex] = removedFile;
+        }
     }
 
-    return pageIndex;
+    persistPageOrder(pDocumentProxy);
 }
 
-QStringList UBPersistenceManager::getSceneFileNames(const QString& folder)
+
+void UBPersistenceManager::persistPageOrder(UBDocumentProxy* pDocumentProxy)
 {
-    QDir dir(folder, "page???.svg", QDir::Name, QDir::Files);
-    return dir.entryList();
+    // a document which was never persisted gets its page order written along with its first page
+    if (QDir(pDocumentProxy->persistencePath()).exists())
+        UBPageOrderAdaptor::persist(pDocumentProxy->persistencePath(), pageFiles(pDocumentProxy));
 }
 
 QString UBPersistenceManager::generateUniqueDocumentPath(const QString& baseFolder)
@@ -1048,25 +1411,27 @@ void UBPersistenceManager::generatePathIfNeeded(UBDocumentProxy* pDocumentProxy)
 
 bool UBPersistenceManager::addDirectoryContentToDocument(const QString& documentRootFolder, UBDocumentProxy* pDocument)
 {
-    QStringList sourceScenes = getSceneFileNames(documentRootFolder);
-    if (sourceScenes.empty())
+    QList<int> sourcePageFiles = UBPageOrderAdaptor::load(documentRootFolder);
+    if (sourcePageFiles.empty())
         return false;
 
-    int targetPageCount = pDocument->pageCount();
-
-    for(int sourceIndex = 0 ; sourceIndex < sourceScenes.size(); sourceIndex++)
+    foreach(int sourceFile, sourcePageFiles)
     {
-        int targetIndex = targetPageCount + sourceIndex;
+        int targetIndex = sceneCount(pDocument);
+        int targetFile = pageFile(pDocument, targetIndex);
 
-        QFile svg(documentRootFolder + "/" + sourceScenes[sourceIndex]);
-        if (!svg.copy(pDocument->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.svg", targetIndex)))
+        QFile svg(UBPageOrderAdaptor::sceneFileName(documentRootFolder, sourceFile));
+        if (!svg.copy(UBPageOrderAdaptor::sceneFileName(pDocument->persistencePath(), targetFile)))
             return false;
 
+        insertPageFile(pDocument, targetIndex);
+
         UBSvgSubsetAdaptor::setSceneUuid(pDocument, targetIndex, QUuid::createUuid());
 
-        QFile thumb(documentRootFolder + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.jpg", sourceIndex));
+        QFile thumb(UBPageOrderAdaptor::thumbnailFileName(documentRootFolder, sourceFile));
         // We can ignore error in this case, thumbnail will be genarated
-        thumb.copy(pDocument->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.jpg", targetIndex));
+        thumb.copy(UBPageOrderAdaptor::thumbnailFileName(pDocument->persistencePath(), targetFile));
+        UBThumbnailCache::thumbnailCache()->remove(UBPageOrderAdaptor::thumbnailFileName(pDocument->persistencePath(), targetFile));
     }
 
     foreach(QString dir, mDocumentSubDirectories)
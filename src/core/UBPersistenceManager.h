@@ -30,8 +30,10 @@
 #define UBPERSISTENCEMANAGER_H_
 
 #include <QtCore>
+#include <QImage>
 
 #include "UBSceneCache.h"
+#include "UBPersistenceWorker.h"
 
 class QDomNode;
 class QDomElement;
@@ -40,6 +42,7 @@ class UBDocumentProxy;
 class UBGraphicsScene;
 class UBDocumentTreeNode;
 class UBDocumentTreeModel;
+class UBDocumentIndex;
 
 class UBPersistenceManager : public QObject
 {
@@ -64,6 +67,7 @@ class UBPersistenceManager : public QObject
         static const QString modelsName;
         static const QString untitledDocumentsName;
         static const QString fFolders;
+        static const QString fDocumentIndex;
         static const QString tFolder;
         static const QString aName;
 
@@ -104,9 +108,9 @@ class UBPersistenceManager : public QObject
         virtual void copyDocumentScene(UBDocumentProxy *from, int fromIndex, UBDocumentProxy *to, int toIndex);
 
         virtual void persistDocumentScene(UBDocumentProxy* pDocumentProxy,
-                UBGraphicsScene* pScene, const int pSceneIndex);
+                UBGraphicsScene* pScene, const int pSceneIndex, const QImage& pThumbnail = QImage());
 
-        virtual UBGraphicsScene* createDocumentSceneAt(UBDocumentProxy* pDocumentProxy, int index, bool useUndoRedoStack = true);
+        virtual UBGraphicsScene* createDocumentSceneAt(UBDocumentProxy* pDocumentProxy, int index, bool useUndoRedoStack = true, bool persist = true);
 
         virtual void insertDocumentSceneAt(UBDocumentProxy* pDocumentProxy, UBGraphicsScene* scene, int index, bool persist = true);
 
@@ -157,6 +161,24 @@ class UBPersistenceManager : public QObject
         void closing();
         bool isSceneInCached(UBDocumentProxy *proxy, int index) const;
 
+        void pinScene(UBGraphicsScene* scene) {mSceneCache.pinScene(scene);}
+        void unpinScene(UBGraphicsScene* scene) {mSceneCache.unpinScene(scene);}
+
+        UBSceneCache::Statistics sceneCacheStatistics() const {return mSceneCache.statistics();}
+
+        void flushPendingSaves();
+        QImage pendingThumbnail(const QString& thumbnailFileName);
+
+        void suspendPersistence(UBDocumentProxy* pDocumentProxy);
+        void resumePersistence(UBDocumentProxy* pDocumentProxy);
+        bool isPersistenceSuspended(UBDocumentProxy* pDocumentProxy) const {return mSuspendedDocuments.contains(pDocumentProxy);}
+
+        void prefetchNeighbourScenes(UBDocumentProxy* pDocumentProxy, int sceneIndex);
+        void cancelPrefetch();
+
+        QString sceneFileName(UBDocumentProxy* pDocumentProxy, int sceneIndex);
+        QString thumbnailFileName(UBDocumentProxy* pDocumentProxy, int sceneIndex);
+
     signals:
 
         void proxyListChanged();
@@ -169,29 +191,51 @@ class UBPersistenceManager : public QObject
         void documentSceneWillBeDeleted(UBDocumentProxy* pDocumentProxy, int pIndex);
 
 private:
-        int sceneCount(const UBDocumentProxy* pDocumentProxy);
-        static QStringList getSceneFileNames(const QString& folder);
-        void renamePage(UBDocumentProxy* pDocumentProxy,
-                        const int sourceIndex, const int targetIndex);
+        int sceneCount(UBDocumentProxy* pDocumentProxy);
+        QList<int>& pageFiles(UBDocumentProxy* pDocumentProxy);
+        int pageFile(UBDocumentProxy* pDocumentProxy, int sceneIndex);
+        int insertPageFile(UBDocumentProxy* pDocumentProxy, int sceneIndex);
+        void removePageFile(UBDocumentProxy* pDocumentProxy, int sceneIndex);
+        void persistPageOrder(UBDocumentProxy* pDocumentProxy);
+        void moveDocumentScenes(UBDocumentProxy* from, const QList<int>& indexes, UBDocumentProxy* to);
+        QSet<QString> sharedDependencies(UBDocumentProxy* pDocumentProxy, const QList<int>& excludedIndexes, const QStringList& dependencies);
         void copyPage(UBDocumentProxy* pDocumentProxy,
                       const int sourceIndex, const int targetIndex);
         void generatePathIfNeeded(UBDocumentProxy* pDocumentProxy);
         void checkIfDocumentRepositoryExists();
 
+        struct DeferredSceneSave
+        {
+            QString sceneFileName;
+            UBSvgSubsetAdaptor::SceneSnapshot sceneSnapshot;
+            QString thumbnailFileName;
+            QImage thumbnail;
+            QPicture thumbnailPicture;
+        };
+
         void saveFoldersTreeToXml(QXmlStreamWriter &writer, const QModelIndex &parentIndex);
         void loadFolderTreeFromXml(const QString &path, const QDomElement &element);
 
         QString xmlFolderStructureFilename;
 
         UBSceneCache mSceneCache;
+        UBPersistenceWorker* mPersistenceWorker;
+        QThread* mPersistenceWorkerThread;
+        int mPrefetchGeneration;
         QStringList mDocumentSubDirectories;
         QMutex mDeletedListMutex;
         bool mHasPurgedDocuments;
         QString mDocumentRepositoryPath;
         QString mFoldersXmlStorageName;
+        UBDocumentIndex* mDocumentIndex;
+        QHash<QString, QList<int> > mPageFiles;
+        QSet<UBDocumentProxy*> mSuspendedDocuments;
+        QHash<UBDocumentProxy*, QList<DeferredSceneSave> > mDeferredSceneSaves;
 
     private slots:
         void documentRepositoryChanged(const QString& path);
+        void scenePrefetched(QByteArray sceneData, UBDecodedImages images, UBDocumentProxy* pDocumentProxy, int sceneIndex, int generation);
+        void thumbnailPersisted(QString thumbnailFileName, QImage thumbnail);
 
 };
 
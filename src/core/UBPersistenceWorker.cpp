@@ -27,58 +27,229 @@
 
 
 #include "UBPersistenceWorker.h"
+#include "UBPersistenceManager.h"
 #include "adaptors/UBSvgSubsetAdaptor.h"
 #include "adaptors/UBThumbnailAdaptor.h"
 #include "adaptors/UBMetadataDcSubsetAdaptor.h"
 
+#include "frameworks/UBFileSystemUtils.h"
+
+#include <QSaveFile>
+
 UBPersistenceWorker::UBPersistenceWorker(QObject *parent) :
     QObject(parent)
   , mReceivedApplicationClosing(false)
+  , mProcessing(false)
+  , mCurrent()
 {
 }
 
-void UBPersistenceWorker::saveScene(UBDocumentProxy* proxy, UBGraphicsScene* scene, const int pageIndex)
+/**
+ * @brief Queue the prefetching of a page: its file is read and its bitmaps are decoded on the worker thread
+ *
+ * The result is delivered by the sceneLoaded signal, tagged with the given generation so that the receiver
+ * can ignore the pages it is not interested in anymore.
+ */
+void UBPersistenceWorker::readScene(UBDocumentProxy* proxy, const int pageIndex, int generation)
 {
-    PersistenceInformation entry = {WriteScene, proxy, scene, pageIndex};
+    PersistenceInformation entry = {ReadScene, proxy, pageIndex};
+    entry.sceneFileName = UBPersistenceManager::persistenceManager()->sceneFileName(proxy, pageIndex);
+    entry.documentPath = proxy->persistencePath();
+    entry.generation = generation;
 
-    saves.append(entry);
-    mSemaphore.release();
+    enqueue(entry);
 }
 
-void UBPersistenceWorker::readScene(UBDocumentProxy* proxy, const int pageIndex)
+/**
+ * @brief Drop the queued page reads that didn't start yet
+ */
+void UBPersistenceWorker::cancelReads()
 {
-    PersistenceInformation entry = {ReadScene, proxy, 0, pageIndex};
+    QMutexLocker locker(&mMutex);
 
-    saves.append(entry);
-    mSemaphore.release();
+    for (int i = saves.size() - 1; i >= 0; i--) {
+        if (saves.at(i).action == ReadScene)
+            saves.removeAt(i);
+    }
 }
 
 void UBPersistenceWorker::saveMetadata(UBDocumentProxy *proxy)
 {
-    PersistenceInformation entry = {WriteMetadata, proxy, NULL, 0};
+    PersistenceInformation entry = {WriteMetadata, proxy, 0};
+
+    enqueue(entry);
+}
+
+/**
+ * @brief Queue the writing of a page snapshot and its thumbnail
+ *
+ * The stroke points of the snapshot are formatted, and the thumbnail is rasterized from @a thumbnailPicture when
+ * @a thumbnail is null, on the worker thread.
+ *
+ * If a snapshot of the same page is still waiting in the queue, it is replaced by this one instead of
+ * queuing a second write: only the latest state of a page is worth writing.
+ */
+void UBPersistenceWorker::saveSceneSnapshot(const QString& sceneFileName, const UBSvgSubsetAdaptor::SceneSnapshot& sceneSnapshot,
+                                            const QString& thumbnailFileName, const QImage& thumbnail, const QPicture& thumbnailPicture)
+{
+    QMutexLocker locker(&mMutex);
+
+    for (int i = 0; i < saves.size(); i++) {
+        PersistenceInformation& pending = saves[i];
+        if (pending.action == WriteSceneSnapshot && pending.sceneFileName == sceneFileName) {
+            pending.sceneSnapshot = sceneSnapshot;
+            pending.thumbnailFileName = thumbnailFileName;
+            pending.thumbnail = thumbnail;
+            pending.thumbnailPicture = thumbnailPicture;
+            return;
+        }
+    }
+
+    PersistenceInformation entry = {WriteSceneSnapshot, NULL, 0, sceneFileName, sceneSnapshot, thumbnailFileName, thumbnail, thumbnailPicture};
     saves.append(entry);
     mSemaphore.release();
 }
 
+/**
+ * @brief Return the thumbnail queued (or being written) for the given file, or a null image if there is none
+ *
+ * A queued thumbnail that is not rasterized yet is rasterized by the caller, rather than waiting for its turn.
+ */
+QImage UBPersistenceWorker::pendingThumbnail(const QString& thumbnailFileName)
+{
+    QMutexLocker locker(&mMutex);
+
+    for (int i = saves.size() - 1; i >= 0; i--) {
+        PersistenceInformation& pending = saves[i];
+        if (pending.action == WriteSceneSnapshot && pending.thumbnailFileName == thumbnailFileName) {
+            // the worker can't take the entry while the lock is held, so the picture is not played concurrently
+            if (pending.thumbnail.isNull() && !pending.thumbnailPicture.isNull()) {
+                pending.thumbnail = UBThumbnailAdaptor::rasterizeThumbnail(pending.thumbnailPicture);
+                pending.thumbnailPicture = QPicture();
+            }
+            return pending.thumbnail;
+        }
+    }
+
+    if (!mProcessing || mCurrent.action != WriteSceneSnapshot || mCurrent.thumbnailFileName != thumbnailFileName)
+        return QImage();
+
+    // the worker is rasterizing it
+    while (mProcessing && mCurrent.thumbnailFileName == thumbnailFileName && !mCurrent.thumbnailPicture.isNull())
+        mThumbnailRendered.wait(&mMutex);
+
+    return mCurrent.thumbnailFileName == thumbnailFileName ? mCurrent.thumbnail : QImage();
+}
+
+/**
+ * @brief Block until every queued entry has been processed
+ */
+void UBPersistenceWorker::waitForPendingSaves()
+{
+    QMutexLocker locker(&mMutex);
+
+    while (mProcessing || !saves.isEmpty())
+        mSavesDone.wait(&mMutex);
+}
+
 void UBPersistenceWorker::applicationWillClose()
 {
     qDebug() << "applicaiton Will close signal received";
+
+    QMutexLocker locker(&mMutex);
+
     mReceivedApplicationClosing = true;
     mSemaphore.release();
 }
 
+void UBPersistenceWorker::enqueue(const PersistenceInformation& entry)
+{
+    QMutexLocker locker(&mMutex);
+
+    saves.append(entry);
+    mSemaphore.release();
+}
+
+void UBPersistenceWorker::writeSceneSnapshot(PersistenceInformation& info)
+{
+    if (info.thumbnail.isNull() && !info.thumbnailPicture.isNull()) {
+        QImage thumbnail = UBThumbnailAdaptor::rasterizeThumbnail(info.thumbnailPicture);
+
+        QMutexLocker locker(&mMutex);
+        info.thumbnail = thumbnail;
+        info.thumbnailPicture = QPicture();
+        mCurrent.thumbnail = thumbnail;
+        mCurrent.thumbnailPicture = QPicture();
+        mThumbnailRendered.wakeAll();
+    }
+
+    // QSaveFile writes to a temporary file and only replaces the page once the data is synced to disk,
+    // so a crash during a save never leaves a truncated page behind
+    QSaveFile sceneFile(info.sceneFileName);
+    if (sceneFile.open(QIODevice::WriteOnly)) {
+        sceneFile.write(UBSvgSubsetAdaptor::serializeSnapshot(info.sceneSnapshot));
+        if (!sceneFile.commit())
+            emit error(tr("cannot write %1").arg(info.sceneFileName));
+    }
+    else {
+        qCritical() << "cannot open " << info.sceneFileName << " for writing ...";
+        emit error(tr("cannot write %1").arg(info.sceneFileName));
+    }
+
+    if (!info.thumbnail.isNull()) {
+        QSaveFile thumbnailFile(info.thumbnailFileName);
+        if (thumbnailFile.open(QIODevice::WriteOnly) && info.thumbnail.save(&thumbnailFile, "JPG"))
+            thumbnailFile.commit();
+        else
+            qCritical() << "cannot write thumbnail " << info.thumbnailFileName;
+
+        emit thumbnailPersisted(info.thumbnailFileName, info.thumbnail);
+    }
+}
+
+void UBPersistenceWorker::prefetchScene(const PersistenceInformation& info)
+{
+    QFile file(info.sceneFileName);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Cannot open file " << info.sceneFileName << " for reading ...";
+        return;
+    }
+
+    QByteArray sceneData = UBSvgSubsetAdaptor::cleanSceneData(file.readAll());
+    file.close();
+
+    UBDecodedImages images = UBSvgSubsetAdaptor::decodeSceneImages(info.documentPath, sceneData);
+
+    emit sceneLoaded(sceneData, images, info.proxy, info.sceneIndex, info.generation);
+}
+
 void UBPersistenceWorker::process()
 {
     qDebug() << "process starts";
-    mSemaphore.acquire();
-    do{
-        PersistenceInformation info = saves.takeFirst();
-        if(info.action == WriteScene){
-            UBSvgSubsetAdaptor::persistScene(info.proxy, info.scene, info.sceneIndex);
-            emit scenePersisted(info.scene);
+
+    forever {
+        mSemaphore.acquire();
+
+        mMutex.lock();
+        if (saves.isEmpty()) {
+            // every entry comes with a token, but cancelReads() drops entries and leaves their tokens, so an
+            // empty queue doesn't mean that the application is closing. Once it is, the queue being empty
+            // means that everything queued before has been processed
+            bool closing = mReceivedApplicationClosing;
+            mMutex.unlock();
+
+            if (closing)
+                break;
+            continue;
         }
-        else if (info.action == ReadScene){
-            emit sceneLoaded(UBSvgSubsetAdaptor::loadSceneAsText(info.proxy,info.sceneIndex), info.proxy, info.sceneIndex);
+        PersistenceInformation info = saves.takeFirst();
+        mCurrent = info;
+        mProcessing = true;
+        mMutex.unlock();
+
+        if (info.action == ReadScene){
+            prefetchScene(info);
         }
         else if (info.action == WriteMetadata) {
             if (info.proxy->isModified()) {
@@ -86,8 +257,18 @@ void UBPersistenceWorker::process()
                 emit metadataPersisted(info.proxy);
             }
         }
-        mSemaphore.acquire();
-    }while(!mReceivedApplicationClosing);
+        else if (info.action == WriteSceneSnapshot) {
+            writeSceneSnapshot(info);
+        }
+
+        mMutex.lock();
+        mProcessing = false;
+        mCurrent = PersistenceInformation();
+        if (saves.isEmpty())
+            mSavesDone.wakeAll();
+        mMutex.unlock();
+    }
+
     qDebug() << "process will stop";
     emit finished();
 }
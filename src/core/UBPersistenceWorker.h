@@ -31,20 +31,40 @@
 
 #include <QObject>
 #include <QSemaphore>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QImage>
+#include <QPicture>
 #include "document/UBDocumentProxy.h"
-#include "domain/UBGraphicsScene.h"
+#include "adaptors/UBSvgSubsetAdaptor.h"
+
+typedef QHash<QString, QImage> UBDecodedImages;
+Q_DECLARE_METATYPE(UBDecodedImages)
 
 typedef enum{
-    WriteScene = 0,
-    ReadScene,
-    WriteMetadata
+    ReadScene = 0,
+    WriteMetadata,
+    WriteSceneSnapshot
 }ActionType;
 
 typedef struct{
     ActionType action;
     UBDocumentProxy* proxy;
-    UBGraphicsScene* scene;
     int sceneIndex;
+
+    // resolved when the entry is queued, the page order is only read on the GUI thread
+    QString sceneFileName;
+
+    // WriteSceneSnapshot only: everything needed to write the page without touching the scene. The thumbnail is
+    // rasterized from its recorded picture on the worker, unless it was given
+    UBSvgSubsetAdaptor::SceneSnapshot sceneSnapshot;
+    QString thumbnailFileName;
+    QImage thumbnail;
+    QPicture thumbnailPicture;
+
+    // ReadScene only
+    QString documentPath;
+    int generation;
 }PersistenceInformation;
 
 class UBPersistenceWorker : public QObject
@@ -53,15 +73,21 @@ class UBPersistenceWorker : public QObject
 public:
     explicit UBPersistenceWorker(QObject *parent = 0);
 
-    void saveScene(UBDocumentProxy* proxy, UBGraphicsScene* scene, const int pageIndex);
-    void readScene(UBDocumentProxy* proxy, const int pageIndex);
+    void readScene(UBDocumentProxy* proxy, const int pageIndex, int generation);
+    void cancelReads();
     void saveMetadata(UBDocumentProxy* proxy);
 
+    void saveSceneSnapshot(const QString& sceneFileName, const UBSvgSubsetAdaptor::SceneSnapshot& sceneSnapshot,
+                           const QString& thumbnailFileName, const QImage& thumbnail, const QPicture& thumbnailPicture);
+
+    QImage pendingThumbnail(const QString& thumbnailFileName);
+    void waitForPendingSaves();
+
 signals:
    void finished();
    void error(QString string);
-   void sceneLoaded(QByteArray text,UBDocumentProxy* proxy, const int pageIndex);
-   void scenePersisted(UBGraphicsScene* scene);
+   void sceneLoaded(QByteArray text, UBDecodedImages images, UBDocumentProxy* proxy, const int pageIndex, int generation);
+   void thumbnailPersisted(QString thumbnailFileName, QImage thumbnail);
    void metadataPersisted(UBDocumentProxy* proxy);
 
 public slots:
@@ -69,8 +95,17 @@ public slots:
    void applicationWillClose();
 
 protected:
+   void enqueue(const PersistenceInformation& entry);
+   void writeSceneSnapshot(PersistenceInformation& info);
+   void prefetchScene(const PersistenceInformation& info);
+
    bool mReceivedApplicationClosing;
    QSemaphore mSemaphore;
+   QMutex mMutex;
+   QWaitCondition mSavesDone;
+   QWaitCondition mThumbnailRendered;
+   bool mProcessing;
+   PersistenceInformation mCurrent;
    QList<PersistenceInformation> saves;
 };
 
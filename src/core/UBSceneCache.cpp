@@ -30,6 +30,9 @@
 #include "UBSceneCache.h"
 
 #include "domain/UBGraphicsScene.h"
+#include "domain/UBGraphicsPixmapItem.h"
+#include "domain/UBGraphicsPolygonItem.h"
+#include "domain/UBGraphicsPDFItem.h"
 
 #include "core/UBPersistenceManager.h"
 #include "core/UBApplication.h"
@@ -41,7 +44,10 @@
 #include "core/memcheck.h"
 
 UBSceneCache::UBSceneCache()
-    : mCachedSceneCount(0)
+    : mEstimatedBytes(0)
+    , mHits(0)
+    , mMisses(0)
+    , mEvictions(0)
 {
     // NOOP
 }
@@ -69,28 +75,27 @@ void UBSceneCache::insert (UBDocumentProxy* proxy, int pageIndex, UBGraphicsScen
 
     foreach(UBSceneCacheID key, existingKeys)
     {
-        mCachedSceneCount -= QHash<UBSceneCacheID, UBGraphicsScene*>::remove(key);
+        QHash<UBSceneCacheID, UBGraphicsScene*>::remove(key);
+        forget(key);
     }
 
     UBSceneCacheID key(proxy, pageIndex);
 
-    if (QHash<UBSceneCacheID, UBGraphicsScene*>::contains(key))
-    {
-        QHash<UBSceneCacheID, UBGraphicsScene*>::insert(key, scene);
-        mCachedKeyFIFO.enqueue(key);
-    }
-    else
-    {
-        QHash<UBSceneCacheID, UBGraphicsScene*>::insert(key, scene);
-        mCachedKeyFIFO.enqueue(key);
+    forget(key);
+    QHash<UBSceneCacheID, UBGraphicsScene*>::insert(key, scene);
+    touch(key);
 
-        mCachedSceneCount++;
-    }
+    // scenes are inserted again each time they are persisted, which keeps their cost up to date
+    qint64 cost = estimatedCost(scene);
+    mCosts.insert(key, cost);
+    mEstimatedBytes += cost;
 
     if (mViewStates.contains(key))
     {
         scene->setViewState(mViewStates.value(key));
     }
+
+    evictIfNeeded(key);
 }
 
 
@@ -109,13 +114,15 @@ UBGraphicsScene* UBSceneCache::value(UBDocumentProxy* proxy, int pageIndex)
     {
         UBGraphicsScene* scene = QHash<UBSceneCacheID, UBGraphicsScene*>::value(key);
 
-        mCachedKeyFIFO.removeAll(key);
-        mCachedKeyFIFO.enqueue(key);
+        touch(key);
+        mHits++;
 
         return scene;
     }
     else
     {
+        mMisses++;
+
         return 0;
     }
 }
@@ -123,18 +130,17 @@ UBGraphicsScene* UBSceneCache::value(UBDocumentProxy* proxy, int pageIndex)
 
 void UBSceneCache::removeScene(UBDocumentProxy* proxy, int pageIndex)
 {
-    UBGraphicsScene* scene = value(proxy, pageIndex);
-    if (scene && !scene->isActive())
+    UBSceneCacheID key(proxy, pageIndex);
+    UBGraphicsScene* scene = QHash<UBSceneCacheID, UBGraphicsScene*>::value(key);
+
+    if (scene && !isDisplayed(scene))
     {
-        UBSceneCacheID key(proxy, pageIndex);
-        int count = QHash<UBSceneCacheID, UBGraphicsScene*>::remove(key);
-        mCachedKeyFIFO.removeAll(key);
+        QHash<UBSceneCacheID, UBGraphicsScene*>::remove(key);
+        forget(key);
 
         mViewStates.insert(key, scene->viewState());
 
         scene->deleteLater();
-
-        mCachedSceneCount -= count;
     }
 }
 
@@ -157,7 +163,6 @@ void UBSceneCache::moveScene(UBDocumentProxy* proxy, int sourceIndex, int target
     if (QHash<UBSceneCacheID, UBGraphicsScene*>::contains(keySource))
     {
         scene = QHash<UBSceneCacheID, UBGraphicsScene*>::value(keySource);
-        mCachedKeyFIFO.removeAll(keySource);
     }
 
     if (sourceIndex < targetIndex)
@@ -180,12 +185,11 @@ void UBSceneCache::moveScene(UBDocumentProxy* proxy, int sourceIndex, int target
     if (scene)
     {
         insert(proxy, targetIndex, scene);
-        mCachedKeyFIFO.enqueue(keyTarget);
     }
     else if (QHash<UBSceneCacheID, UBGraphicsScene*>::contains(keyTarget))
     {
-        scene = QHash<UBSceneCacheID, UBGraphicsScene*>::take(keyTarget);
-        mCachedKeyFIFO.removeAll(keyTarget);
+        QHash<UBSceneCacheID, UBGraphicsScene*>::remove(keyTarget);
+        forget(keyTarget);
     }
 
 }
@@ -208,11 +212,11 @@ void UBSceneCache::reassignDocProxy(UBDocumentProxy *newDocument, UBDocumentProx
         if (currentScene) {
             currentScene->setDocument(newDocument);
         }
-        mCachedKeyFIFO.removeAll(sourceKey);
-        int count = QHash<UBSceneCacheID, UBGraphicsScene*>::remove(sourceKey);
-        mCachedSceneCount -= count;
+        QHash<UBSceneCacheID, UBGraphicsScene*>::remove(sourceKey);
+        forget(sourceKey);
 
-        insert(newDocument, i, currentScene);
+        if (currentScene)
+            insert(newDocument, i, currentScene);
     }
 
 }
@@ -227,32 +231,173 @@ void UBSceneCache::shiftUpScenes(UBDocumentProxy* proxy, int startIncIndex, int
 }
 
 
+UBSceneCache::Statistics UBSceneCache::statistics() const
+{
+    Statistics stats;
+
+    stats.sceneCount = size();
+    stats.estimatedBytes = mEstimatedBytes;
+    stats.byteBudget = UBSettings::settings()->pageCacheMemoryBudget->get().toLongLong() * 1024 * 1024;
+    stats.hits = mHits;
+    stats.misses = mMisses;
+    stats.evictions = mEvictions;
+
+    return stats;
+}
+
+
+/**
+ * @brief Rough estimation of the memory used by a scene
+ *
+ * Counts a fixed overhead per item plus the dominant payloads: polygon points, pixmaps and the
+ * rasterization of PDF pages.
+ */
+qint64 UBSceneCache::estimatedCost(UBGraphicsScene* scene)
+{
+    const qint64 itemOverhead = 512;
+
+    qint64 cost = sizeof(UBGraphicsScene);
+
+    foreach(QGraphicsItem* item, scene->items())
+    {
+        cost += itemOverhead;
+
+        switch (item->type())
+        {
+            case UBGraphicsPolygonItem::Type:
+            {
+                UBGraphicsPolygonItem* polygonItem = static_cast<UBGraphicsPolygonItem*>(item);
+                cost += polygonItem->polygon().size() * sizeof(QPointF);
+                break;
+            }
+            case UBGraphicsPixmapItem::Type:
+            {
+                QPixmap pixmap = static_cast<UBGraphicsPixmapItem*>(item)->pixmap();
+                cost += (qint64)pixmap.width() * pixmap.height() * pixmap.depth() / 8;
+                break;
+            }
+            case UBGraphicsPDFItem::Type:
+            {
+                // the renderer keeps a 32 bits bitmap of the page
+                QRectF bounds = item->boundingRect();
+                cost += (qint64)(bounds.width() * bounds.height()) * 4;
+                break;
+            }
+            default:
+                break;
+        }
+    }
+
+    return cost;
+}
+
+
 void UBSceneCache::internalMoveScene(UBDocumentProxy* proxy, int sourceIndex, int targetIndex)
 {
     UBSceneCacheID sourceKey(proxy, sourceIndex);
+    UBSceneCacheID targetKey(proxy, targetIndex);
 
     if (QHash<UBSceneCacheID, UBGraphicsScene*>::contains(sourceKey))
     {
-        UBGraphicsScene* scene = QHash<UBSceneCacheID, UBGraphicsScene*>::take(sourceKey);
-        mCachedKeyFIFO.removeAll(sourceKey);
+        if (QHash<UBSceneCacheID, UBGraphicsScene*>::contains(targetKey))
+        {
+            QHash<UBSceneCacheID, UBGraphicsScene*>::remove(targetKey);
+            forget(targetKey);
+        }
 
-        UBSceneCacheID targetKey(proxy, targetIndex);
+        UBGraphicsScene* scene = QHash<UBSceneCacheID, UBGraphicsScene*>::take(sourceKey);
         QHash<UBSceneCacheID, UBGraphicsScene*>::insert(targetKey, scene);
-        mCachedKeyFIFO.enqueue(targetKey);
 
+        // the scene keeps its cost and its position in the LRU list, only its key changes
+        mCosts.insert(targetKey, mCosts.take(sourceKey));
+
+        int lruPosition = mLruKeys.indexOf(sourceKey);
+        if (lruPosition >= 0)
+            mLruKeys[lruPosition] = targetKey;
+        else
+            mLruKeys.append(targetKey);
     }
     else
     {
-        UBSceneCacheID targetKey(proxy, targetIndex);
         if (QHash<UBSceneCacheID, UBGraphicsScene*>::contains(targetKey))
         {
-            /*UBGraphicsScene* scene = */QHash<UBSceneCacheID, UBGraphicsScene*>::take(targetKey);
+            QHash<UBSceneCacheID, UBGraphicsScene*>::remove(targetKey);
+            forget(targetKey);
+        }
+    }
+}
+
+
+void UBSceneCache::touch(const UBSceneCacheID& key)
+{
+    mLruKeys.removeAll(key);
+    mLruKeys.append(key);
+}
+
+
+void UBSceneCache::forget(const UBSceneCacheID& key)
+{
+    mLruKeys.removeAll(key);
+    mEstimatedBytes -= mCosts.take(key);
+}
+
 
-            mCachedKeyFIFO.removeAll(targetKey);
+/**
+ * @brief Drop the least recently used scenes until the cache fits in its byte budget and scene count limit
+ *
+ * The scenes being displayed and the ones with unsaved changes are never dropped.
+ */
+void UBSceneCache::evictIfNeeded(const UBSceneCacheID& keptKey)
+{
+    qint64 byteBudget = UBSettings::settings()->pageCacheMemoryBudget->get().toLongLong() * 1024 * 1024;
+    int maxSceneCount = UBSettings::settings()->pageCacheSize->get().toInt();
+
+    int i = 0;
+    while ((mEstimatedBytes > byteBudget || size() > maxSceneCount) && i < mLruKeys.size())
+    {
+        UBSceneCacheID key = mLruKeys.at(i);
+        UBGraphicsScene* scene = QHash<UBSceneCacheID, UBGraphicsScene*>::value(key);
+
+        if (key == keptKey || !scene || isDisplayed(scene) || scene->isModified())
+        {
+            i++;
+            continue;
         }
+
+        QHash<UBSceneCacheID, UBGraphicsScene*>::remove(key);
+        forget(key);
+
+        mViewStates.insert(key, scene->viewState());
+
+        scene->deleteLater();
+
+        mEvictions++;
     }
 }
 
+/**
+ * @brief Whether the scene is pinned by the board, which pins the scene it shows and the one it is about to show
+ *
+ * QGraphicsScene::isActive() is not used, it is false for the board scene while the main window is not active.
+ */
+bool UBSceneCache::isDisplayed(UBGraphicsScene* scene) const
+{
+    return mPinnedScenes.contains(scene);
+}
+
+
+void UBSceneCache::pinScene(UBGraphicsScene* scene)
+{
+    mPinnedScenes.insert(scene);
+}
+
+
+void UBSceneCache::unpinScene(UBGraphicsScene* scene)
+{
+    mPinnedScenes.remove(scene);
+}
+
+
 void UBSceneCache::dumpCacheContent()
 {
     foreach(UBSceneCacheID key, keys())
@@ -264,6 +409,8 @@ void UBSceneCache::dumpCacheContent()
 
         int index = key.pageIndex;
 
-        qDebug() << "UBSceneCache::dumpCacheContent:" << index << " : " << scene;
+        qDebug() << "UBSceneCache::dumpCacheContent:" << index << " : " << scene << mCosts.value(key) << "bytes";
     }
+
+    qDebug() << "UBSceneCache::dumpCacheContent:" << mEstimatedBytes << "bytes," << mHits << "hits," << mMisses << "misses," << mEvictions << "evictions";
 }
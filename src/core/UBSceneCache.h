@@ -69,13 +69,23 @@ inline bool operator==(const UBSceneCacheID &id1, const UBSceneCacheID &id2)
 
 inline uint qHash(const UBSceneCacheID &id)
 {
-    return qHash(id.pageIndex);
+    return qHash(qMakePair(id.documentProxy, id.pageIndex));
 }
 
 class UBSceneCache : public QHash<UBSceneCacheID, UBGraphicsScene*>
 {
     public:
 
+        struct Statistics
+        {
+            int sceneCount;
+            qint64 estimatedBytes;
+            qint64 byteBudget;
+            int hits;
+            int misses;
+            int evictions;
+        };
+
         UBSceneCache();
         virtual ~UBSceneCache();
 
@@ -102,19 +112,39 @@ class UBSceneCache : public QHash<UBSceneCacheID, UBGraphicsScene*>
 
         void shiftUpScenes(UBDocumentProxy* proxy, int startIncIndex, int endIncIndex);
 
+        void pinScene(UBGraphicsScene* scene);
+        void unpinScene(UBGraphicsScene* scene);
+
+        Statistics statistics() const;
+
+        static qint64 estimatedCost(UBGraphicsScene* scene);
 
     private:
 
         void internalMoveScene(UBDocumentProxy* proxy, int sourceIndex, int targetIndex);
 
+        void touch(const UBSceneCacheID& key);
+        void forget(const UBSceneCacheID& key);
+        void evictIfNeeded(const UBSceneCacheID& keptKey);
+        bool isDisplayed(UBGraphicsScene* scene) const;
+
         void dumpCacheContent();
 
-        int mCachedSceneCount;
+        // least recently used first
+        QList<UBSceneCacheID> mLruKeys;
+
+        QHash<UBSceneCacheID, qint64> mCosts;
+        qint64 mEstimatedBytes;
 
-        QQueue<UBSceneCacheID> mCachedKeyFIFO;
+        int mHits;
+        int mMisses;
+        int mEvictions;
 
         QHash<UBSceneCacheID, UBGraphicsScene::SceneViewState> mViewStates;
 
+        // the board active scene and the scene about to replace it
+        QSet<UBGraphicsScene*> mPinnedScenes;
+
 };
 
 
@@ -280,6 +280,9 @@ void UBSettings::init()
 
     boardUseHighResTabletEvent = new UBSetting(this, "Board", "UseHighResTabletEvent", true);
 
+    boardRenderCacheMode = new UBSetting(this, "Board", "RenderCacheMode", "Background");
+    boardShowFrameTimes = new UBSetting(this, "Board", "ShowFrameTimes", false);
+
     boardInterpolatePenStrokes = new UBSetting(this, "Board", "InterpolatePenStrokes", true);
     boardSimplifyPenStrokes = new UBSetting(this, "Board", "SimplifyPenStrokes", true);
     boardSimplifyPenStrokesThresholdAngle = new UBSetting(this, "Board", "SimplifyPenStrokesThresholdAngle", 2);
@@ -287,6 +290,7 @@ void UBSettings::init()
 
     boardInterpolateMarkerStrokes = new UBSetting(this, "Board", "InterpolateMarkerStrokes", true);
     boardSimplifyMarkerStrokes = new UBSetting(this, "Board", "SimplifyMarkerStrokes", true);
+    boardConsolidateStrokes = new UBSetting(this, "Board", "ConsolidateStrokes", true);
 
     boardKeyboardPaletteKeyBtnSize = new UBSetting(this, "Board", "KeyboardPaletteKeyBtnSize", "16x16");
     ValidateKeyboardPaletteKeyBtnSize();
@@ -364,6 +368,8 @@ void UBSettings::init()
     webShowAddBookmarkButton = new UBSetting(this, "Web", "ShowAddBookmarkButton", false);
 
     pageCacheSize = new UBSetting(this, "App", "PageCacheSize", 20);
+    pageCacheMemoryBudget = new UBSetting(this, "App", "PageCacheMemoryBudget", 512); // in MB
+    thumbnailCacheSize = new UBSetting(this, "App", "ThumbnailCacheSize", 64); // in MB
 
     bitmapFileExtensions << "jpg" << "jpeg" <<  "png" <<  "tiff" << "tif" << "bmp" << "gif";
     vectoFileExtensions << "svg" <<  "svgz";
@@ -403,10 +409,13 @@ void UBSettings::init()
     autoSaveInterval = new UBSetting(this, "Board", "AutoSaveIntervalInMinutes", "3");
 
     svgViewBoxMargin = new UBSetting(this, "SVG", "ViewBoxMargin", "50");
+    svgCompactStrokes = new UBSetting(this, "SVG", "CompactStrokes", false);
 
     pdfMargin = new UBSetting(this, "PDF", "Margin", "20");
     pdfPageFormat = new UBSetting(this, "PDF", "PageFormat", "A4");
     pdfResolution = new UBSetting(this, "PDF", "Resolution", "300");
+    pdfTileCacheSize = new UBSetting(this, "PDF", "TileCacheSize", 128); // in MB
+    pdfMergeBackgrounds = new UBSetting(this, "PDF", "MergeBackgrounds", false);
 
     podcastFramesPerSecond = new UBSetting(this, "Podcast", "FramesPerSecond", 10);
     podcastVideoSize = new UBSetting(this, "Podcast", "VideoSize", "Medium");
@@ -414,6 +423,11 @@ void UBSettings::init()
 
     podcastWindowsMediaBitsPerSecond = new UBSetting(this, "Podcast", "WindowsMediaBitsPerSecond", 1700000);
     podcastQuickTimeQuality = new UBSetting(this, "Podcast", "QuickTimeQuality", "High");
+    podcastFFmpegPreset = new UBSetting(this, "Podcast", "FFmpegPreset", "Quality"); // Quality, Balanced or Screen
+    podcastFFmpegCrf = new UBSetting(this, "Podcast", "FFmpegCrf", 0); // 0: preset value
+    podcastFFmpegMaxBitsPerSecond = new UBSetting(this, "Podcast", "FFmpegMaxBitsPerSecond", 0); // 0: no cap
+    podcastFFmpegKeyframeInterval = new UBSetting(this, "Podcast", "FFmpegKeyframeInterval", 0); // in seconds, 0: preset value
+    podcastFFmpegThreads = new UBSetting(this, "Podcast", "FFmpegThreads", 0); // 0: automatic
 
     podcastPublishToYoutube = new UBSetting(this, "Podcast", "PublishToYouTube", false);
     youTubeUserEMail = new UBSetting(this, "YouTube", "UserEMail", "");
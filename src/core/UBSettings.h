@@ -284,12 +284,16 @@ class UBSettings : public QObject
 
         UBSetting* boardUseHighResTabletEvent;
 
+        UBSetting* boardRenderCacheMode;
+        UBSetting* boardShowFrameTimes;
+
         UBSetting* boardInterpolatePenStrokes;
         UBSetting* boardSimplifyPenStrokes;
         UBSetting* boardSimplifyPenStrokesThresholdAngle;
         UBSetting* boardSimplifyPenStrokesThresholdWidthDifference;
         UBSetting* boardInterpolateMarkerStrokes;
         UBSetting* boardSimplifyMarkerStrokes;
+        UBSetting* boardConsolidateStrokes;
 
         UBSetting* boardKeyboardPaletteKeyBtnSize;
 
@@ -331,6 +335,8 @@ class UBSettings : public QObject
         UBSetting* webShowAddBookmarkButton;
 
         UBSetting* pageCacheSize;
+        UBSetting* pageCacheMemoryBudget;
+        UBSetting* thumbnailCacheSize;
 
         UBSetting* boardZoomFactor;
 
@@ -355,15 +361,23 @@ class UBSettings : public QObject
         QMap<DocumentSizeRatio::Enum, QSize> documentSizes;
 
         UBSetting* svgViewBoxMargin;
+        UBSetting* svgCompactStrokes;
         UBSetting* pdfMargin;
         UBSetting* pdfPageFormat;
         UBSetting* pdfResolution;
+        UBSetting* pdfTileCacheSize;
+        UBSetting* pdfMergeBackgrounds;
 
         UBSetting* podcastFramesPerSecond;
         UBSetting* podcastVideoSize;
         UBSetting* podcastWindowsMediaBitsPerSecond;
         UBSetting* podcastAudioRecordingDevice;
         UBSetting* podcastQuickTimeQuality;
+        UBSetting* podcastFFmpegPreset;
+        UBSetting* podcastFFmpegCrf;
+        UBSetting* podcastFFmpegMaxBitsPerSecond;
+        UBSetting* podcastFFmpegKeyframeInterval;
+        UBSetting* podcastFFmpegThreads;
 
         UBSetting* podcastPublishToYoutube;
         UBSetting* youTubeUserEMail;
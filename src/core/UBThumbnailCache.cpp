@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2015-2018 Département de l'Instruction Publique (DIP-SEM)
+ *
+ * Copyright (C) 2013 Open Education Foundation
+ *
+ * Copyright (C) 2010-2013 Groupement d'Intérêt Public pour
+ * l'Education Numérique en Afrique (GIP ENA)
+ *
+ * This file is part of OpenBoard.
+ *
+ * OpenBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License,
+ * with a specific linking exception for the OpenSSL project's
+ * "OpenSSL" library (or with modified versions of it that use the
+ * same license as the "OpenSSL" library).
+ *
+ * OpenBoard is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenBoard. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include <QTimer>
+
+#include "UBThumbnailCache.h"
+
+#include "core/UBApplication.h"
+#include "core/UBPersistenceManager.h"
+#include "core/UBSettings.h"
+
+#include "adaptors/UBThumbnailGenerator.h"
+
+#include "document/UBDocumentProxy.h"
+
+#include "core/memcheck.h"
+
+UBThumbnailCache* UBThumbnailCache::sSingleton = 0;
+
+UBThumbnailCache::UBThumbnailCache(QObject* parent)
+    : QObject(parent)
+    , mGenerationScheduled(false)
+{
+    mPixmaps.setMaxCost(UBSettings::settings()->thumbnailCacheSize->get().toInt() * 1024);
+
+    // leave a core to the GUI thread, which converts the decoded images
+    mThreadPool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() - 1));
+}
+
+UBThumbnailCache::~UBThumbnailCache()
+{
+    mThreadPool.clear();
+    mThreadPool.waitForDone();
+}
+
+UBThumbnailCache* UBThumbnailCache::thumbnailCache()
+{
+    if (!sSingleton)
+    {
+        sSingleton = new UBThumbnailCache(UBApplication::staticMemoryCleaner);
+    }
+
+    return sSingleton;
+}
+
+void UBThumbnailCache::destroy()
+{
+    if (sSingleton)
+        delete sSingleton;
+    sSingleton = NULL;
+}
+
+QPixmap UBThumbnailCache::thumbnail(UBDocumentProxy* proxy, int pageIndex)
+{
+    QString fileName = UBPersistenceManager::persistenceManager()->thumbnailFileName(proxy, pageIndex);
+
+    QPixmap* cached = mPixmaps.object(fileName);
+    if (cached)
+        return *cached;
+
+    if (mPendingDecodes.contains(fileName) || mPendingGenerations.contains(fileName))
+        return QPixmap();
+
+    // the thumbnail may still be waiting to be written by the persistence worker
+    QImage pendingThumbnail = UBPersistenceManager::persistenceManager()->pendingThumbnail(fileName);
+    if (!pendingThumbnail.isNull())
+    {
+        QPixmap pixmap = QPixmap::fromImage(pendingThumbnail);
+        store(fileName, pixmap);
+        return pixmap;
+    }
+
+    if (!QFile::exists(fileName))
+    {
+        // rendering pages needs the GUI thread, do it later rather than while the view is painting
+        MissingThumbnail missing;
+        missing.proxy = proxy;
+        missing.pageIndex = pageIndex;
+        missing.thumbnailFileName = fileName;
+
+        mMissingThumbnails << missing;
+        mPendingGenerations.insert(fileName);
+
+        scheduleGeneration();
+
+        return QPixmap();
+    }
+
+    mPendingDecodes.insert(fileName);
+    mThreadPool.start(new Worker(this, fileName, mGenerations.value(fileName)));
+
+    return QPixmap();
+}
+
+QPixmap UBThumbnailCache::placeholder()
+{
+    if (mPlaceholder.isNull())
+    {
+        mPlaceholder = QPixmap(UBSettings::maxThumbnailWidth, UBSettings::maxThumbnailWidth / UBSettings::minScreenRatio);
+        mPlaceholder.fill(QColor(224, 224, 224));
+    }
+
+    return mPlaceholder;
+}
+
+void UBThumbnailCache::insert(const QString& thumbnailFileName, const QImage& image)
+{
+    store(thumbnailFileName, QPixmap::fromImage(image));
+
+    emit thumbnailLoaded(thumbnailFileName);
+}
+
+void UBThumbnailCache::remove(const QString& thumbnailFileName)
+{
+    fileChanged(thumbnailFileName);
+
+    mPixmaps.remove(thumbnailFileName);
+}
+
+void UBThumbnailCache::removeDocument(UBDocumentProxy* proxy)
+{
+    QString documentPath = proxy->persistencePath() + "/";
+
+    foreach(const QString& fileName, mPixmaps.keys())
+    {
+        if (fileName.startsWith(documentPath))
+            remove(fileName);
+    }
+
+    foreach(const QString& fileName, mPendingDecodes)
+    {
+        if (fileName.startsWith(documentPath))
+            remove(fileName);
+    }
+}
+
+void UBThumbnailCache::thumbnailDecoded(const QString& thumbnailFileName, const QImage& image, int generation)
+{
+    // the file changed while it was being decoded
+    if (generation != mGenerations.value(thumbnailFileName))
+        return;
+
+    if (image.isNull())
+    {
+        qWarning() << "cannot decode thumbnail" << thumbnailFileName;
+        store(thumbnailFileName, placeholder());
+    }
+    else
+    {
+        store(thumbnailFileName, QPixmap::fromImage(image));
+    }
+
+    emit thumbnailLoaded(thumbnailFileName);
+}
+
+/**
+ * @brief Generate some of the missing thumbnails, all from the same document, and come back later for the others
+ *
+ * The pages are read and the thumbnails written on the generator's thread pool, only the rendering blocks the
+ * GUI thread, a few pages at a time.
+ */
+void UBThumbnailCache::resumeGeneration()
+{
+    scheduleGeneration();
+}
+
+void UBThumbnailCache::generateMissingThumbnails()
+{
+    static const int sPagesPerBatch = 4;
+
+    mGenerationScheduled = false;
+
+    UBDocumentProxy* proxy = 0;
+    QList<int> pageIndexes;
+    QStringList fileNames;
+
+    for (int i = 0; i < mMissingThumbnails.size() && pageIndexes.size() < sPagesPerBatch; )
+    {
+        const MissingThumbnail& missing = mMissingThumbnails.at(i);
+
+        if (!missing.proxy)
+        {
+            // the document is gone
+            mPendingGenerations.remove(missing.thumbnailFileName);
+            mMissingThumbnails.removeAt(i);
+            continue;
+        }
+
+        // the folder of the document must not change, e.g. while it is exported
+        if (UBPersistenceManager::persistenceManager()->isPersistenceSuspended(missing.proxy))
+        {
+            i++;
+            continue;
+        }
+
+        if (!proxy)
+            proxy = missing.proxy;
+
+        if (missing.proxy != proxy)
+        {
+            i++;
+            continue;
+        }
+
+        // pages moved since the request are asked for again by the views
+        if (missing.pageIndex < proxy->pageCount()
+                && UBPersistenceManager::persistenceManager()->thumbnailFileName(proxy, missing.pageIndex) == missing.thumbnailFileName)
+            pageIndexes << missing.pageIndex;
+
+        fileNames << missing.thumbnailFileName;
+        mMissingThumbnails.removeAt(i);
+    }
+
+    if (!pageIndexes.isEmpty())
+    {
+        UBThumbnailGenerator generator;
+        generator.generate(proxy, pageIndexes);
+    }
+
+    foreach(const QString& fileName, fileNames)
+    {
+        mPendingGenerations.remove(fileName);
+
+        // keep the placeholder, so that the page is not rendered again each time it is shown
+        if (!QFile::exists(fileName))
+            store(fileName, placeholder());
+
+        emit thumbnailLoaded(fileName);
+    }
+
+    scheduleGeneration();
+}
+
+/**
+ * @brief Generate missing thumbnails from the event loop, unless all of them wait for their document
+ */
+void UBThumbnailCache::scheduleGeneration()
+{
+    if (mGenerationScheduled)
+        return;
+
+    foreach(const MissingThumbnail& missing, mMissingThumbnails)
+    {
+        if (!missing.proxy || !UBPersistenceManager::persistenceManager()->isPersistenceSuspended(missing.proxy))
+        {
+            mGenerationScheduled = true;
+            QTimer::singleShot(0, this, SLOT(generateMissingThumbnails()));
+            return;
+        }
+    }
+}
+
+void UBThumbnailCache::store(const QString& thumbnailFileName, const QPixmap& pixmap)
+{
+    fileChanged(thumbnailFileName);
+
+    int cost = qMax(1, pixmap.width() * pixmap.height() * pixmap.depth() / 8 / 1024);
+    mPixmaps.insert(thumbnailFileName, new QPixmap(pixmap), cost);
+}
+
+void UBThumbnailCache::fileChanged(const QString& thumbnailFileName)
+{
+    mGenerations[thumbnailFileName]++;
+    mPendingDecodes.remove(thumbnailFileName);
+}
+
+void UBThumbnailCache::Worker::run()
+{
+    QImage image(mThumbnailFileName);
+
+    QMetaObject::invokeMethod(mCache, "thumbnailDecoded", Qt::QueuedConnection,
+                              Q_ARG(QString, mThumbnailFileName), Q_ARG(QImage, image), Q_ARG(int, mGeneration));
+}
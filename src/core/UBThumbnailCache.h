@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2015-2018 Département de l'Instruction Publique (DIP-SEM)
+ *
+ * Copyright (C) 2013 Open Education Foundation
+ *
+ * Copyright (C) 2010-2013 Groupement d'Intérêt Public pour
+ * l'Education Numérique en Afrique (GIP ENA)
+ *
+ * This file is part of OpenBoard.
+ *
+ * OpenBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License,
+ * with a specific linking exception for the OpenSSL project's
+ * "OpenSSL" library (or with modified versions of it that use the
+ * same license as the "OpenSSL" library).
+ *
+ * OpenBoard is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenBoard. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef UBTHUMBNAILCACHE_H_
+#define UBTHUMBNAILCACHE_H_
+
+#include <QtGui>
+#include <QCache>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QPointer>
+
+class UBDocumentProxy;
+
+/**
+ * @brief Bounded cache of the page thumbnails shown by the thumbnail views
+ *
+ * Thumbnails are keyed by their file name and decoded on a thread pool the first time they are asked for.
+ * Missing thumbnails are generated a few pages at a time from the event loop. Until then the views show
+ * the placeholder, and thumbnailLoaded() tells them when to ask again.
+ *
+ * Every change of a file bumps its generation, so that a decoding started before the change is dropped.
+ */
+class UBThumbnailCache : public QObject
+{
+    Q_OBJECT
+
+    public:
+        static UBThumbnailCache* thumbnailCache();
+        static void destroy();
+
+        // returns a null pixmap and schedules the decoding if the thumbnail is not cached yet
+        QPixmap thumbnail(UBDocumentProxy* proxy, int pageIndex);
+
+        QPixmap placeholder();
+
+        void insert(const QString& thumbnailFileName, const QImage& image);
+        void remove(const QString& thumbnailFileName);
+        void removeDocument(UBDocumentProxy* proxy);
+
+        // generates the missing thumbnails that waited for the persistence of their document to be resumed
+        void resumeGeneration();
+
+    signals:
+        void thumbnailLoaded(const QString& thumbnailFileName);
+
+    private slots:
+        void thumbnailDecoded(const QString& thumbnailFileName, const QImage& image, int generation);
+        void generateMissingThumbnails();
+
+    private:
+        UBThumbnailCache(QObject* parent = 0);
+        virtual ~UBThumbnailCache();
+
+        void store(const QString& thumbnailFileName, const QPixmap& pixmap);
+
+        void fileChanged(const QString& thumbnailFileName);
+        void scheduleGeneration();
+
+        class Worker : public QRunnable
+        {
+            public:
+                Worker(UBThumbnailCache* cache, const QString& thumbnailFileName, int generation)
+                    : mCache(cache)
+                    , mThumbnailFileName(thumbnailFileName)
+                    , mGeneration(generation)
+                {
+                    // NOOP
+                }
+
+                void run();
+
+            private:
+                UBThumbnailCache* mCache;
+                QString mThumbnailFileName;
+                int mGeneration;
+        };
+
+        struct MissingThumbnail
+        {
+            QPointer<UBDocumentProxy> proxy;
+            int pageIndex;
+            QString thumbnailFileName;
+        };
+
+        static UBThumbnailCache* sSingleton;
+
+        QCache<QString, QPixmap> mPixmaps;
+        QHash<QString, int> mGenerations;
+        QSet<QString> mPendingDecodes;
+        QList<MissingThumbnail> mMissingThumbnails;
+        QSet<QString> mPendingGenerations;
+        bool mGenerationScheduled;
+        QPixmap mPlaceholder;
+        QThreadPool mThreadPool;
+};
+
+#endif /* UBTHUMBNAILCACHE_H_ */
@@ -5,6 +5,8 @@ HEADERS      += src/core/UB.h \
                 src/core/UBSetting.h \
                 src/core/UBPersistenceManager.h \
                 src/core/UBSceneCache.h \
+                src/core/UBThumbnailCache.h \
+                src/core/UBDocumentIndex.h \
                 src/core/UBPreferencesController.h \
                 src/core/UBMimeData.h \
                 src/core/UBIdleTimer.h \
@@ -24,6 +26,8 @@ SOURCES      += src/core/main.cpp \
                 src/core/UBSetting.cpp \
                 src/core/UBPersistenceManager.cpp \
                 src/core/UBSceneCache.cpp \
+                src/core/UBThumbnailCache.cpp \
+                src/core/UBDocumentIndex.cpp \
                 src/core/UBPreferencesController.cpp \
                 src/core/UBMimeData.cpp \
                 src/core/UBIdleTimer.cpp \
@@ -110,6 +110,19 @@ int main(int argc, char *argv[])
     if (!logDir.exists())
         logDir.mkdir(dumpPath);
 
+    if (args.contains("-generate-thumbnails")) {
+        // the running instance may be writing the same documents
+        if (app.isRunning()) {
+            qWarning() << "OpenBoard is running, quit it before generating thumbnails";
+            return 1;
+        }
+
+        // pre-generate the missing thumbnails of the whole library, without showing the user interface
+        app.generateThumbnails();
+        app.cleanup();
+        return 0;
+    }
+
     QString fileToOpen;
 
     if (args.size() > 1) {
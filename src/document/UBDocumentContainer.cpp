@@ -28,8 +28,8 @@
 
 
 #include "UBDocumentContainer.h"
-#include "adaptors/UBThumbnailAdaptor.h"
 #include "core/UBPersistenceManager.h"
+#include "core/UBThumbnailCache.h"
 #include "core/memcheck.h"
 
 
@@ -40,10 +40,7 @@ UBDocumentContainer::UBDocumentContainer(QObject * parent)
 
 UBDocumentContainer::~UBDocumentContainer()
 {
-    foreach(const QPixmap* pm, mDocumentThumbs){
-        delete pm;
-        pm = NULL;
-    }
+    // NOOP
 }
 
 void UBDocumentContainer::setDocument(UBDocumentProxy* document, bool forceReload)
@@ -71,8 +68,6 @@ bool UBDocumentContainer::movePageToIndex(int source, int target)
 {
     //on document view
     UBPersistenceManager::persistenceManager()->moveSceneToIndex(mCurrentDocument, source, target);
-    deleteThumbPage(source);
-    insertThumbPage(target);
     emit documentThumbnailsUpdated(this);
     //on board thumbnails view
     emit moveThumbnailRequired(source, target);
@@ -85,7 +80,6 @@ void UBDocumentContainer::deletePages(QList<int>& pageIndexes)
     int offset = 0;
     foreach(int index, pageIndexes)
     {
-        deleteThumbPage(index - offset);
         emit removeThumbnailRequired(index - offset);
         offset++;
 
@@ -96,68 +90,37 @@ void UBDocumentContainer::deletePages(QList<int>& pageIndexes)
 void UBDocumentContainer::addPage(int index)
 {
     UBPersistenceManager::persistenceManager()->createDocumentSceneAt(mCurrentDocument, index);
-    insertThumbPage(index);
 
     emit documentThumbnailsUpdated(this);
     emit addThumbnailRequired(this, index);
 }
 
 
-void UBDocumentContainer::addPixmapAt(const QPixmap *pix, int index)
-{
-    mDocumentThumbs.insert(index, pix);
-    emit documentThumbnailsUpdated(this);
-}
-
-
-void UBDocumentContainer::clearThumbPage()
-{
-    qDeleteAll(mDocumentThumbs);
-    mDocumentThumbs.clear();
-}
-
-void UBDocumentContainer::initThumbPage()
-{
-    clearThumbPage();
-
-    for (int i=0; i < selectedDocument()->pageCount(); i++)
-        insertThumbPage(i);
-}
-
 void UBDocumentContainer::updatePage(int index)
 {
     updateThumbPage(index);
     emit documentThumbnailsUpdated(this);
 }
 
-void UBDocumentContainer::deleteThumbPage(int index)
-{
-    mDocumentThumbs.removeAt(index);
-}
-
 void UBDocumentContainer::updateThumbPage(int index)
 {
-    if (mDocumentThumbs.size() > index)
+    // the thumbnail cache is updated when the page is persisted
+    if (index < pageCount())
     {
-        mDocumentThumbs[index] = UBThumbnailAdaptor::get(mCurrentDocument, index);
         emit documentPageUpdated(index);
     }
     else
     {
-        qDebug() << "error [updateThumbPage] : index > mDocumentThumbs' size.";
+        qDebug() << "error [updateThumbPage] : index > page count.";
     }
 }
 
-void UBDocumentContainer::insertThumbPage(int index)
-{
-    mDocumentThumbs.insert(index, UBThumbnailAdaptor::get(mCurrentDocument, index));
-}
-
 void UBDocumentContainer::reloadThumbnails()
 {
+    // thumbnails are decoded again when the views ask for them
     if (mCurrentDocument)
     {
-        UBThumbnailAdaptor::load(mCurrentDocument, mDocumentThumbs);
+        UBThumbnailCache::thumbnailCache()->removeDocument(mCurrentDocument);
     }
     emit documentThumbnailsUpdated(this);
 }
@@ -171,9 +134,3 @@ int UBDocumentContainer::sceneIndexFromPage(int page)
 {
     return page-1;
 }
-
-void UBDocumentContainer::addEmptyThumbPage()
-{
-    const QPixmap* pThumb = new QPixmap();
-    mDocumentThumbs.append(pThumb);
-}
@@ -46,15 +46,6 @@ class UBDocumentContainer : public QObject
 
         UBDocumentProxy* selectedDocument(){return mCurrentDocument;}
         int pageCount(){return mCurrentDocument->pageCount();}
-        const QPixmap* pageAt(int index)
-        {
-            if (index < mDocumentThumbs.size())
-                return mDocumentThumbs[index];
-            else
-            {
-                return NULL;
-            }
-        }
 
         static int pageFromSceneIndex(int sceneIndex);
         static int sceneIndexFromPage(int sceneIndex);
@@ -62,23 +53,15 @@ class UBDocumentContainer : public QObject
         void duplicatePages(QList<int>& pageIndexes);
         bool movePageToIndex(int source, int target);
         void deletePages(QList<int>& pageIndexes);
-        void clearThumbPage();
-        void initThumbPage();
         void addPage(int index);
-        void addPixmapAt(const QPixmap *pix, int index);
         void updatePage(int index);
-        void addEmptyThumbPage();
         void reloadThumbnails();
 
-        void insertThumbPage(int index);
-
     private:
         UBDocumentProxy* mCurrentDocument;
-        QList<const QPixmap*>  mDocumentThumbs;
 
 
     protected:
-        void deleteThumbPage(int index);
         void updateThumbPage(int index);
 
     signals:
@@ -36,6 +36,7 @@
 
 #include "core/UBApplication.h"
 #include "core/UBPersistenceManager.h"
+#include "core/UBThumbnailCache.h"
 #include "core/UBDocumentManager.h"
 #include "core/UBApplicationController.h"
 #include "core/UBSettings.h"
@@ -1475,17 +1476,17 @@ void UBDocumentTreeView::dropEvent(QDropEvent *event)
 
                 UBPersistenceManager::persistenceManager()->insertDocumentSceneAt(targetDocProxy, sceneClone, targetDocProxy->pageCount());
 
-                QString thumbTmp(fromProxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.jpg", fromIndex));
-                QString thumbTo(targetDocProxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.jpg", toIndex));
+                QString thumbTmp(UBPersistenceManager::persistenceManager()->thumbnailFileName(fromProxy, fromIndex));
+                QString thumbTo(UBPersistenceManager::persistenceManager()->thumbnailFileName(targetDocProxy, toIndex));
 
                 QFile::remove(thumbTo);
                 QFile::copy(thumbTmp, thumbTo);
+                UBThumbnailCache::thumbnailCache()->remove(thumbTo);
 
                 Q_ASSERT(QFileInfo(thumbTmp).exists());
                 Q_ASSERT(QFileInfo(thumbTo).exists());
-                const QPixmap *pix = new QPixmap(thumbTmp);
                 UBDocumentController *ctrl = UBApplication::documentController;
-                ctrl->addPixmapAt(pix, toIndex);
+                emit ctrl->documentThumbnailsUpdated(ctrl);
                 ctrl->TreeViewSelectionChanged(ctrl->firstSelectedTreeIndex(), QModelIndex());
             }
 
@@ -2611,6 +2612,9 @@ void UBDocumentController::exportDocument()
 
     UBDocumentProxy* proxy = firstSelectedTreeProxy();
 
+    // exporters read the pages from disk
+    UBPersistenceManager::persistenceManager()->flushPendingSaves();
+
     selectedExportAdaptor->persist(proxy);
     emit exportDone();
 
@@ -3409,13 +3413,6 @@ void UBDocumentController:: refreshDocumentThumbnailsView(UBDocumentContainer*)
         return;
     }
 
-    QList<const QPixmap*> thumbs;
-
-    if (currentDocumentProxy)
-    {
-        UBThumbnailAdaptor::load(currentDocumentProxy, thumbs);
-    }
-
     QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
 
     QList<QGraphicsItem*> items;
@@ -3429,8 +3426,8 @@ void UBDocumentController:: refreshDocumentThumbnailsView(UBDocumentContainer*)
     {
         for (int i = 0; i < currentDocumentProxy->pageCount(); i++)
         {
-            const QPixmap* pix = thumbs.at(i);
-            QGraphicsPixmapItem *pixmapItem = new UBSceneThumbnailPixmap(*pix, currentDocumentProxy, i); // deleted by the tree widget
+            // the thumbnail widget shows the thumbnails of the visible pages from the UBThumbnailCache
+            QGraphicsPixmapItem *pixmapItem = new UBSceneThumbnailPixmap(UBThumbnailCache::thumbnailCache()->placeholder(), currentDocumentProxy, i); // deleted by the tree widget
 
             if (currentDocumentProxy == mBoardController->selectedDocument() && mBoardController->activeSceneIndex() == i)
             {
@@ -81,12 +81,15 @@
 #include "domain/UBGraphicsGroupContainerItem.h"
 
 #include "UBGraphicsStroke.h"
+#include "UBPageBackgroundPainter.h"
 
 #include "core/memcheck.h"
 
 
 #define DEFAULT_Z_VALUE 0.0
 
+const int UBGraphicsScene::sStrokeConsolidationDelay = 500;
+
 qreal UBZLayerController::errorNumber = -20000001.0;
 
 UBZLayerController::UBZLayerController(QGraphicsScene *scene) :
@@ -363,6 +366,10 @@ UBGraphicsScene::UBGraphicsScene(UBDocumentProxy* parent, bool enableUndoRedoSta
 //    Just for debug. Do not delete please
 //    connect(this, SIGNAL(selectionChanged()), this, SLOT(selectionChangedProcessing()));
     connect(UBApplication::undoStack.data(), SIGNAL(indexChanged(int)), this, SLOT(updateSelectionFrameWrapper(int)));
+
+    mStrokeConsolidationTimer.setSingleShot(true);
+    mStrokeConsolidationTimer.setInterval(sStrokeConsolidationDelay);
+    connect(&mStrokeConsolidationTimer, SIGNAL(timeout()), this, SLOT(consolidatePendingStrokes()));
 }
 
 UBGraphicsScene::~UBGraphicsScene()
@@ -408,6 +415,13 @@ bool UBGraphicsScene::inputDevicePress(const QPointF& scenePos, const qreal& pre
 
         UBStylusTool::Enum currentTool = (UBStylusTool::Enum)UBDrawingController::drawingController()->stylusTool();
 
+        // merge the strokes drawn so far before the eraser or the selector can reference their segments,
+        // a new stroke just postpones it to the next idle period
+        if (UBDrawingController::drawingController()->isDrawingTool())
+            mStrokeConsolidationTimer.stop();
+        else
+            consolidatePendingStrokes();
+
         if (UBDrawingController::drawingController()->isDrawingTool()) {
             // -----------------------------------------------------------------
             // We fall here if we are using the Pen, the Marker or the Line tool
@@ -428,6 +442,14 @@ bool UBGraphicsScene::inputDevicePress(const QPointF& scenePos, const qreal& pre
             if (currentTool == UBStylusTool::Pen)
                 hidePenCircle();
 
+            // keep the existing content in the views' background cache while the stroke is drawn
+            foreach(QGraphicsView* view, views())
+            {
+                UBBoardView* boardView = qobject_cast<UBBoardView*>(view);
+                if (boardView)
+                    boardView->beginStaticLayer();
+            }
+
             // ---------------------------------------------------------------
             // Create a new Stroke. A Stroke is a collection of QGraphicsLines
             // ---------------------------------------------------------------
@@ -723,6 +745,9 @@ bool UBGraphicsScene::inputDeviceRelease()
             mAddedItems << pStrokes;
             addItem(pStrokes);
 
+            if (UBSettings::settings()->boardConsolidateStrokes->get().toBool())
+                mStrokesToConsolidate << pStrokes;
+
             if (mCurrentStroke->polygons().empty()){
                 delete mCurrentStroke;
                 mCurrentStroke = 0;
@@ -748,6 +773,16 @@ bool UBGraphicsScene::inputDeviceRelease()
 
     mInputDeviceIsPressed = false;
 
+    if (!mStrokesToConsolidate.isEmpty())
+        mStrokeConsolidationTimer.start();
+
+    foreach(QGraphicsView* view, views())
+    {
+        UBBoardView* boardView = qobject_cast<UBBoardView*>(view);
+        if (boardView)
+            boardView->endStaticLayer();
+    }
+
     setDocumentUpdated();
 
     if (mCurrentStroke && mCurrentStroke->polygons().empty()){
@@ -991,11 +1026,12 @@ void UBGraphicsScene::eraseLineTo(const QPointF &pEndPoint, const qreal &pWidth)
 
     const QPolygonF eraserPolygon = UBGeometryUtils::lineToPolygon(line, pWidth);
     const QRectF eraserBoundingRect = eraserPolygon.boundingRect();
+    const qreal eraserRadius = pWidth / 2;
 
     QPainterPath eraserPath;
     eraserPath.addPolygon(eraserPolygon);
 
-    // Get all the items that are intersecting with the eraser path
+    // Get all the items whose bounding rect intersects the eraser (this query goes through the scene's BSP index)
     QList<QGraphicsItem*> collidItems = items(eraserBoundingRect, Qt::IntersectsItemBoundingRect);
 
     QList<UBGraphicsPolygonItem*> intersectedItems;
@@ -1010,10 +1046,19 @@ void UBGraphicsScene::eraseLineTo(const QPointF &pEndPoint, const qreal &pWidth)
         if(pi == NULL)
             continue;
 
-        QPainterPath itemPainterPath;
-        itemPainterPath.addPolygon(pi->sceneTransform().map(pi->polygon()));
+        const QPolygonF itemPolygon = pi->sceneTransform().map(pi->polygon());
 
-        if (eraserPath.contains(itemPainterPath))
+        // Sharing a bounding rect with the eraser is not enough: discard the polygons that the eraser
+        // doesn't actually touch before doing any (expensive) painter path operation
+        if (!UBGeometryUtils::polygonIntersectsCapsule(itemPolygon, line, eraserRadius))
+            continue;
+
+        // The eraser polygon is convex, so the item is entirely erased if all its vertices are inside it
+        bool fullyErased = true;
+        for (int j = 0; j < itemPolygon.size() && fullyErased; j++)
+            fullyErased = eraserPolygon.containsPoint(itemPolygon[j], Qt::OddEvenFill);
+
+        if (fullyErased)
         {
             #pragma omp critical
             {
@@ -1021,10 +1066,15 @@ void UBGraphicsScene::eraseLineTo(const QPointF &pEndPoint, const qreal &pWidth)
                 intersectedItems << pi;
                 intersectedPolygons << QList<QPolygonF>();
             }
+            continue;
         }
-        else if (eraserPath.intersects(itemPainterPath))
+
+        QPainterPath itemPainterPath;
+        itemPainterPath.addPolygon(itemPolygon);
+
+        if (eraserPath.intersects(itemPainterPath))
         {
-            itemPainterPath.setFillRule(Qt::WindingFill);
+            itemPainterPath.setFillRule(pi->fillRule());
             QPainterPath newPath = itemPainterPath.subtracted(eraserPath);
             #pragma omp critical
             {
@@ -2609,60 +2659,9 @@ void UBGraphicsScene::drawBackground(QPainter *painter, const QRectF &rect)
         QGraphicsScene::drawBackground (painter, rect);
         return;
     }
-    bool darkBackground = isDarkBackground ();
-
-    if (darkBackground)
-    {
-      painter->fillRect (rect, QBrush (QColor (Qt::black)));
-    }
-    else
-    {
-      painter->fillRect (rect, QBrush (QColor (Qt::white)));
-    }
-
-    if (mZoomFactor > 0.5)
-    {
-        QColor bgCrossColor;
 
-        if (darkBackground)
-            bgCrossColor = QColor(UBSettings::settings()->boardCrossColorDarkBackground->get().toString());
-        else
-            bgCrossColor = QColor(UBSettings::settings()->boardCrossColorLightBackground->get().toString());
-        if (mZoomFactor < 0.7)
-        {
-            int alpha = 255 * mZoomFactor / 2;
-            bgCrossColor.setAlpha (alpha); // fade the crossing on small zooms
-        }
-
-        painter->setPen (bgCrossColor);
-
-        if (mPageBackground == UBPageBackground::crossed)
-        {
-            qreal firstY = ((int) (rect.y () / backgroundGridSize())) * backgroundGridSize();
-
-            for (qreal yPos = firstY; yPos < rect.y () + rect.height (); yPos += backgroundGridSize())
-            {
-                painter->drawLine (rect.x (), yPos, rect.x () + rect.width (), yPos);
-            }
-
-            qreal firstX = ((int) (rect.x () / backgroundGridSize())) * backgroundGridSize();
-
-            for (qreal xPos = firstX; xPos < rect.x () + rect.width (); xPos += backgroundGridSize())
-            {
-                painter->drawLine (xPos, rect.y (), xPos, rect.y () + rect.height ());
-            }
-        }
-
-        else if (mPageBackground == UBPageBackground::ruled)
-        {
-            qreal firstY = ((int) (rect.y () / backgroundGridSize())) * backgroundGridSize();
-
-            for (qreal yPos = firstY; yPos < rect.y () + rect.height (); yPos += backgroundGridSize())
-            {
-                painter->drawLine (rect.x (), yPos, rect.x () + rect.width (), yPos);
-            }
-        }
-    }
+    UBPageBackgroundPainter::backgroundPainter()->paint(painter, rect, mPageBackground, isDarkBackground(),
+                                                       backgroundGridSize(), mZoomFactor);
 }
 
 void UBGraphicsScene::keyReleaseEvent(QKeyEvent * keyEvent)
@@ -2796,6 +2795,20 @@ void UBGraphicsScene::simplifyCurrentStroke()
 
 }
 
+void UBGraphicsScene::consolidatePendingStrokes()
+{
+    mStrokeConsolidationTimer.stop();
+
+    foreach(QPointer<UBGraphicsStrokesGroup> strokesGroup, mStrokesToConsolidate)
+    {
+        // strokes that were undone in the meantime are left as they are
+        if (strokesGroup && strokesGroup->scene() == this)
+            strokesGroup->consolidate();
+    }
+
+    mStrokesToConsolidate.clear();
+}
+
 void UBGraphicsScene::setDocumentUpdated()
 {
     if (document())
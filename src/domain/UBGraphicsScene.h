@@ -54,6 +54,7 @@ class UBGraphicsCompass;
 class UBDocumentProxy;
 class UBGraphicsCurtainItem;
 class UBGraphicsStroke;
+class UBGraphicsStrokesGroup;
 class UBMagnifierParams;
 class UBMagnifier;
 class UBGraphicsCache;
@@ -416,6 +417,9 @@ public slots:
         virtual void drawBackground(QPainter *painter, const QRectF &rect);
 
 
+    private slots:
+        void consolidatePendingStrokes();
+
     private:
         void setDocumentUpdated();
         void createEraiser();
@@ -486,6 +490,12 @@ public slots:
         bool mDrawWithCompass;
         UBGraphicsPolygonItem *mCurrentPolygon;
         UBSelectionFrame *mSelectionFrame;
+
+        // finished strokes waiting to be merged into a single polygon once the input is idle
+        QList<QPointer<UBGraphicsStrokesGroup> > mStrokesToConsolidate;
+        QTimer mStrokeConsolidationTimer;
+
+        static const int sStrokeConsolidationDelay;
 };
 
 
@@ -116,6 +116,69 @@ QColor UBGraphicsStrokesGroup::color(colorType pColorType) const
     return result;
 }
 
+/**
+ * @brief Replaces the segment polygons of a finished stroke by the outline of their union
+ *
+ * A pen stroke is made of one polygon per drawn segment. Once the stroke is finished these
+ * are merged into as few polygon items as possible (usually one), which keeps the scene index,
+ * the rendering and the saved page small. Eraser, undo, selection and persistence keep working
+ * on the resulting UBGraphicsPolygonItem children as before.
+ *
+ * @return true if the group was consolidated
+ */
+bool UBGraphicsStrokesGroup::consolidate()
+{
+    QList<UBGraphicsPolygonItem*> polygons;
+
+    foreach (QGraphicsItem *item, childItems()) {
+        if (item->type() == UBGraphicsPolygonItem::Type)
+            polygons << static_cast<UBGraphicsPolygonItem *>(item);
+    }
+
+    if (polygons.size() < 2)
+        return false;
+
+    UBGraphicsPolygonItem *firstPolygon = polygons.first();
+    UBGraphicsStroke *stroke = firstPolygon->stroke();
+
+    // strokes without pressure are saved as a polyline built from the original segments
+    if (!stroke || !stroke->hasPressure())
+        return false;
+
+    QPainterPath outline;
+    outline.setFillRule(Qt::WindingFill);
+
+    foreach (UBGraphicsPolygonItem *polygon, polygons) {
+        if (polygon->stroke() != stroke || polygon->brush() != firstPolygon->brush())
+            return false;
+
+        outline.addPolygon(polygon->mapToParent(polygon->polygon()));
+        outline.closeSubpath();
+    }
+
+    // the fill polygons carry the holes of the outline and are meant for the odd-even rule
+    QList<QPolygonF> fillPolygons = outline.simplified().toFillPolygons();
+
+    if (fillPolygons.isEmpty() || fillPolygons.size() >= polygons.size())
+        return false;
+
+    foreach (const QPolygonF &fillPolygon, fillPolygons) {
+        UBGraphicsPolygonItem *polygonItem = new UBGraphicsPolygonItem(fillPolygon, this);
+
+        firstPolygon->copyItemParameters(polygonItem);
+        polygonItem->resetTransform();
+        polygonItem->setFillRule(Qt::OddEvenFill);
+        polygonItem->setNominalLine(false);
+        polygonItem->setStroke(stroke);
+        polygonItem->setStrokesGroup(this);
+        addToGroup(polygonItem);
+    }
+
+    qDeleteAll(polygons);
+
+    return true;
+}
+
 void UBGraphicsStrokesGroup::mousePressEvent(QGraphicsSceneMouseEvent *event)
 {
     Delegate()->startUndoStep();
@@ -59,6 +59,8 @@ public:
     void setColor(const QColor &color, colorType pColorType = currentColor);
     QColor color(colorType pColorType = currentColor) const;
 
+    bool consolidate();
+
 protected:
 
     virtual QPainterPath shape () const;
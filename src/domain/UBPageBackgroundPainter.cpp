@@ -0,0 +1,179 @@
+/*
+ * Copyright (C) 2015-2018 Département de l'Instruction Publique (DIP-SEM)
+ *
+ * Copyright (C) 2013 Open Education Foundation
+ *
+ * Copyright (C) 2010-2013 Groupement d'Intérêt Public pour
+ * l'Education Numérique en Afrique (GIP ENA)
+ *
+ * This file is part of OpenBoard.
+ *
+ * OpenBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License,
+ * with a specific linking exception for the OpenSSL project's
+ * "OpenSSL" library (or with modified versions of it that use the
+ * same license as the "OpenSSL" library).
+ *
+ * OpenBoard is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenBoard. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#include "UBPageBackgroundPainter.h"
+
+#include <QPixmapCache>
+
+#include "core/UBSettings.h"
+
+#include "core/memcheck.h"
+
+UBPageBackgroundPainter* UBPageBackgroundPainter::sSingleton = 0;
+
+const int UBPageBackgroundPainter::sMaxTileSize = 1024;
+
+UBPageBackgroundPainter* UBPageBackgroundPainter::backgroundPainter()
+{
+    if (!sSingleton)
+        sSingleton = new UBPageBackgroundPainter(qApp);
+
+    return sSingleton;
+}
+
+UBPageBackgroundPainter::UBPageBackgroundPainter(QObject* parent)
+    : QObject(parent)
+{
+    connect(UBSettings::settings()->boardCrossColorDarkBackground, SIGNAL(changed(QVariant)),
+            this, SLOT(crossColorChanged()));
+
+    connect(UBSettings::settings()->boardCrossColorLightBackground, SIGNAL(changed(QVariant)),
+            this, SLOT(crossColorChanged()));
+
+    crossColorChanged();
+}
+
+void UBPageBackgroundPainter::crossColorChanged()
+{
+    mCrossColorDarkBackground = QColor(UBSettings::settings()->boardCrossColorDarkBackground->get().toString());
+    mCrossColorLightBackground = QColor(UBSettings::settings()->boardCrossColorLightBackground->get().toString());
+
+    // tiles are keyed by colour, the stale ones just age out of the QPixmapCache
+}
+
+void UBPageBackgroundPainter::paint(QPainter* painter, const QRectF& rect, UBPageBackground background,
+                                    bool darkBackground, qreal gridSize, qreal zoomFactor)
+{
+    QColor backgroundColor(darkBackground ? Qt::black : Qt::white);
+
+    if (background == UBPageBackground::plain || zoomFactor <= 0.5 || gridSize <= 0)
+    {
+        painter->fillRect(rect, backgroundColor);
+        return;
+    }
+
+    QColor crossColor = darkBackground ? mCrossColorDarkBackground : mCrossColorLightBackground;
+
+    if (zoomFactor < 0.7)
+    {
+        int alpha = 255 * zoomFactor / 2;
+        crossColor.setAlpha(alpha); // fade the crossing on small zooms
+    }
+
+    QPaintEngine* engine = painter->paintEngine();
+    bool rasterDevice = engine && (engine->type() == QPaintEngine::Raster || engine->type() == QPaintEngine::OpenGL2);
+    bool axisAligned = painter->transform().type() <= QTransform::TxScale;
+
+    int tileSize = 0;
+
+    // the tile is rendered at the current zoom, so that it is painted almost one to one:
+    // only the rounding of its size to whole pixels is left to the brush transform
+    if (rasterDevice && axisAligned)
+        tileSize = qRound(gridSize * qAbs(painter->transform().m11()));
+
+    if (tileSize < 2 || tileSize > sMaxTileSize)
+    {
+        painter->fillRect(rect, backgroundColor);
+        drawGridLines(painter, rect, background, crossColor, gridSize);
+        return;
+    }
+
+    // the tile holds one grid cell with its lines centered on the edges, the brush
+    // transform maps it back to scene units so the pattern stays anchored at the origin;
+    // lines are one scene unit wide, like the pen of the vector drawing
+    QBrush pattern(patternTile(background, backgroundColor, crossColor, tileSize, tileSize / gridSize));
+    pattern.setTransform(QTransform::fromScale(gridSize / tileSize, gridSize / tileSize));
+
+    // filtered sampling never skips a line when the tile is scaled by its rounding
+    painter->save();
+    painter->setRenderHint(QPainter::SmoothPixmapTransform);
+    painter->fillRect(rect, pattern);
+    painter->restore();
+}
+
+QPixmap UBPageBackgroundPainter::patternTile(UBPageBackground background, const QColor& backgroundColor,
+                                             const QColor& crossColor, int tileSize, qreal lineWidth)
+{
+    QString key = QString("UBPageBackground-%1-%2-%3-%4-%5")
+            .arg((int)background)
+            .arg(tileSize)
+            .arg(qRound(lineWidth * 100))
+            .arg(backgroundColor.rgba(), 8, 16, QChar('0'))
+            .arg(crossColor.rgba(), 8, 16, QChar('0'));
+
+    QPixmap tile;
+
+    if (QPixmapCache::find(key, &tile))
+        return tile;
+
+    tile = QPixmap(tileSize, tileSize);
+    tile.fill(backgroundColor);
+
+    // a line centered on the cell edge is split between both sides of the tile,
+    // the neighbouring tiles put the two halves back together
+    qreal halfWidth = qMin(lineWidth, (qreal)tileSize) / 2;
+
+    QPainter tilePainter(&tile);
+    tilePainter.setRenderHint(QPainter::Antialiasing);
+    tilePainter.fillRect(QRectF(0, 0, tileSize, halfWidth), crossColor);
+    tilePainter.fillRect(QRectF(0, tileSize - halfWidth, tileSize, halfWidth), crossColor);
+
+    if (background == UBPageBackground::crossed)
+    {
+        tilePainter.fillRect(QRectF(0, 0, halfWidth, tileSize), crossColor);
+        tilePainter.fillRect(QRectF(tileSize - halfWidth, 0, halfWidth, tileSize), crossColor);
+    }
+
+    tilePainter.end();
+
+    QPixmapCache::insert(key, tile);
+
+    return tile;
+}
+
+void UBPageBackgroundPainter::drawGridLines(QPainter* painter, const QRectF& rect, UBPageBackground background,
+                                            const QColor& crossColor, qreal gridSize)
+{
+    QVector<QLineF> lines;
+
+    qreal firstY = ((int) (rect.y() / gridSize)) * gridSize;
+
+    for (qreal yPos = firstY; yPos < rect.y() + rect.height(); yPos += gridSize)
+        lines << QLineF(rect.x(), yPos, rect.x() + rect.width(), yPos);
+
+    if (background == UBPageBackground::crossed)
+    {
+        qreal firstX = ((int) (rect.x() / gridSize)) * gridSize;
+
+        for (qreal xPos = firstX; xPos < rect.x() + rect.width(); xPos += gridSize)
+            lines << QLineF(xPos, rect.y(), xPos, rect.y() + rect.height());
+    }
+
+    painter->setPen(crossColor);
+    painter->drawLines(lines);
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2015-2018 Département de l'Instruction Publique (DIP-SEM)
+ *
+ * Copyright (C) 2013 Open Education Foundation
+ *
+ * Copyright (C) 2010-2013 Groupement d'Intérêt Public pour
+ * l'Education Numérique en Afrique (GIP ENA)
+ *
+ * This file is part of OpenBoard.
+ *
+ * OpenBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License,
+ * with a specific linking exception for the OpenSSL project's
+ * "OpenSSL" library (or with modified versions of it that use the
+ * same license as the "OpenSSL" library).
+ *
+ * OpenBoard is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenBoard. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef UBPAGEBACKGROUNDPAINTER_H
+#define UBPAGEBACKGROUNDPAINTER_H
+
+#include <QtGui>
+
+#include "core/UB.h"
+
+/**
+ * @brief Paints the plain, crossed and ruled page backgrounds.
+ *
+ * On raster devices the grid is drawn with a texture brush made of a single grid cell,
+ * pre-rendered at the device resolution of the current zoom with the same one scene unit
+ * wide lines as the vector drawing, and kept in the QPixmapCache. Other devices (PDF,
+ * printer, SVG) get the lines drawn as vectors.
+ */
+class UBPageBackgroundPainter : public QObject
+{
+    Q_OBJECT
+
+    public:
+        static UBPageBackgroundPainter* backgroundPainter();
+
+        void paint(QPainter* painter, const QRectF& rect, UBPageBackground background,
+                   bool darkBackground, qreal gridSize, qreal zoomFactor);
+
+    private slots:
+        void crossColorChanged();
+
+    private:
+        UBPageBackgroundPainter(QObject* parent);
+
+        QPixmap patternTile(UBPageBackground background, const QColor& backgroundColor,
+                            const QColor& crossColor, int tileSize, qreal lineWidth);
+
+        void drawGridLines(QPainter* painter, const QRectF& rect, UBPageBackground background,
+                           const QColor& crossColor, qreal gridSize);
+
+        QColor mCrossColorDarkBackground;
+        QColor mCrossColorLightBackground;
+
+        static UBPageBackgroundPainter* sSingleton;
+        static const int sMaxTileSize;
+};
+
+#endif // UBPAGEBACKGROUNDPAINTER_H
@@ -33,6 +33,9 @@
 
 #include "core/UBApplication.h"
 
+#include "frameworks/UBPlatformUtils.h"
+#include "frameworks/UBZipCompressor.h"
+
 #include "globals/UBGlobals.h"
 
 THIRD_PARTY_WARNINGS_DISABLE
@@ -329,6 +332,52 @@ bool UBFileSystemUtils::moveDir(const QString& pSourceDirPath, const QString& pT
 }
 
 
+/**
+ * @brief Move a file or a directory, by renaming it when source and destination are on the same volume
+ */
+bool UBFileSystemUtils::moveFile(const QString& source, const QString& destination)
+{
+    QDir().mkpath(QFileInfo(destination).absolutePath());
+
+    if (QDir().rename(source, destination))
+        return true;
+
+    if (QFileInfo(source).isDir())
+        return moveDir(source, destination);
+
+    return QFile::copy(source, destination) && QFile::remove(source);
+}
+
+
+/**
+ * @brief Give a file or a directory a second location, sharing the data through hard links where the file
+ * system supports them and copying it otherwise
+ */
+bool UBFileSystemUtils::linkOrCopy(const QString& source, const QString& destination)
+{
+    QFileInfo sourceInfo(source);
+
+    if (sourceInfo.isDir())
+    {
+        if (!QDir().mkpath(destination))
+            return false;
+
+        foreach(QFileInfo dirContent, QDir(source).entryInfoList(QDir::Files | QDir::Dirs
+                | QDir::NoDotAndDotDot | QDir::Hidden , QDir::Name))
+        {
+            if (!linkOrCopy(source + "/" + dirContent.fileName(), destination + "/" + dirContent.fileName()))
+                return false;
+        }
+
+        return true;
+    }
+
+    QDir().mkpath(QFileInfo(destination).absolutePath());
+
+    return UBPlatformUtils::hardLinkFile(source, destination) || QFile::copy(source, destination);
+}
+
+
 
 QString UBFileSystemUtils::cleanName(const QString& name)
 {
@@ -641,86 +690,9 @@ QString UBFileSystemUtils::getFirstExistingFileFromList(const QString& path, con
 
 bool UBFileSystemUtils::compressDirInZip(const QDir& pDir, const QString& pDestPath, QuaZipFile *pOutZipFile, bool pRootDocumentFolder, UBProcessingProgressListener* progressListener)
 {
-    QFileInfoList files = pDir.entryInfoList(QDir::AllDirs | QDir::Files | QDir::NoDotAndDotDot);
-
-    QStringList filters;
-    filters << "*.svg";
-    QFileInfoList pageFiles = pDir.entryInfoList(filters);
-
-    foreach (QFileInfo file, files)
-    {
-        if (file.isDir())
-        {
-            QDir dir(file.absoluteFilePath());
-            if (!compressDirInZip(dir, pDestPath + dir.dirName() + "/" , pOutZipFile, false))
-            {
-                return false;
-            }
-        }
-
-        if (file.isFile())
-        {
-            QString objectType;
-            if (pRootDocumentFolder)
-            {
-                objectType = "Page";
-            }
-            else
-            {
-                objectType = pDir.dirName();
-            }
-
-            if (!pRootDocumentFolder)
-            {
-                if (progressListener)
-                    progressListener->processing(objectType, files.indexOf(file), files.size());
-            }
-            // we ignore thumbnails message because it is very fast.
-            else if (progressListener && file.suffix() == "svg")
-            {
-                progressListener->processing(objectType, pageFiles.indexOf(file), pageFiles.size());
-            }
-
-            QFile inFile(file.absoluteFilePath());
-            if(!inFile.open(QIODevice::ReadOnly))
-            {
-                qWarning() << "Compression of file" << inFile.fileName() << " failed. Cause: inFile.open(): " << inFile.errorString();
-                return false;
-            }
-
-            qDebug() << "will open" << pDestPath << file.fileName() << inFile.fileName();
-
-            if(!pOutZipFile->open(QIODevice::WriteOnly, QuaZipNewInfo(pDestPath + file.fileName(), inFile.fileName())))
-            {
-                qWarning() << "Compression of file" << inFile.fileName() << " failed. Cause: outFile.open(): " << pOutZipFile->getZipError();
-                inFile.close();
-                return false;
-            }
-
-            pOutZipFile->write(inFile.readAll());
-            if(pOutZipFile->getZipError() != UNZ_OK)
-            {
-                qWarning() << "Compression of file" << inFile.fileName() << " failed. Cause: outFile.write(): " << pOutZipFile->getZipError();
+    UBZipCompressor compressor(pOutZipFile, progressListener);
 
-                inFile.close();
-                pOutZipFile->close();
-                return false;
-            }
-
-            pOutZipFile->close();
-            if(pOutZipFile->getZipError() != UNZ_OK)
-            {
-                qWarning() << "Compression of file" << inFile.fileName() << " failed. Cause: outFile.close(): " << pOutZipFile->getZipError();
-
-                inFile.close();
-                return false;
-            }
-
-            inFile.close();
-        }
-    }
-
-    return true;
+    return compressor.compress(pDir, pDestPath, pRootDocumentFolder);
 }
 
 
@@ -66,6 +66,10 @@ class UBFileSystemUtils : public QObject
 
         static bool moveDir(const QString& pSourceDirPath, const QString& pTargetDirPath);
 
+        static bool moveFile(const QString& source, const QString& destination);
+
+        static bool linkOrCopy(const QString& source, const QString& destination);
+
         static bool copyFile(const QString &source, const QString &destination, bool overwrite = false);
 
         static bool copy(const QString &source, const QString &Destination, bool overwrite = false);
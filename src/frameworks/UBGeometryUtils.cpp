@@ -467,3 +467,67 @@ QList<QPointF> UBGeometryUtils::quadraticBezier(const QPointF& p0, const QPointF
 
     return points;
 }
+
+/**
+ * @brief Return the shortest distance between a point and a line segment
+ */
+qreal UBGeometryUtils::distanceToSegment(const QPointF& point, const QLineF& segment)
+{
+    qreal dx = segment.dx();
+    qreal dy = segment.dy();
+    qreal squaredLength = dx*dx + dy*dy;
+
+    if (squaredLength == 0)
+        return QLineF(point, segment.p1()).length();
+
+    // Project the point on the segment and clamp the projection to the segment's ends
+    qreal t = ((point.x() - segment.x1()) * dx + (point.y() - segment.y1()) * dy) / squaredLength;
+    t = qBound(qreal(0), t, qreal(1));
+
+    return QLineF(point, QPointF(segment.x1() + t*dx, segment.y1() + t*dy)).length();
+}
+
+/**
+ * @brief Return the shortest distance between two line segments (0 if they cross)
+ */
+qreal UBGeometryUtils::distanceBetweenSegments(const QLineF& first, const QLineF& second)
+{
+    QPointF intersection;
+    if (first.intersect(second, &intersection) == QLineF::BoundedIntersection)
+        return 0;
+
+    qreal distance = distanceToSegment(first.p1(), second);
+    distance = qMin(distance, distanceToSegment(first.p2(), second));
+    distance = qMin(distance, distanceToSegment(second.p1(), first));
+    distance = qMin(distance, distanceToSegment(second.p2(), first));
+
+    return distance;
+}
+
+/**
+ * @brief Check whether a polygon touches a capsule, i.e. the area swept by a disc of the given radius
+ * moving along the axis segment.
+ *
+ * This is a cheap alternative to building painter paths and calling QPainterPath::intersects, and is
+ * used to discard polygons that only share a bounding rect with the eraser.
+ */
+bool UBGeometryUtils::polygonIntersectsCapsule(const QPolygonF& polygon, const QLineF& axis, qreal radius)
+{
+    int n_points = polygon.size();
+
+    if (n_points == 0)
+        return false;
+
+    if (n_points == 1)
+        return distanceToSegment(polygon.first(), axis) <= radius;
+
+    for (int i(0); i < n_points; ++i) {
+        QLineF edge(polygon[i], polygon[(i + 1) % n_points]);
+
+        if (distanceBetweenSegments(edge, axis) <= radius)
+            return true;
+    }
+
+    // No edge is close enough to the axis: the capsule is either entirely inside the polygon or outside it
+    return polygon.containsPoint(axis.p1(), Qt::WindingFill);
+}
@@ -59,6 +59,10 @@ class UBGeometryUtils
 
         static QList<QPointF> quadraticBezier(const QPointF& p0, const QPointF& p1, const QPointF& p2, unsigned int nPoints);
 
+        static qreal distanceToSegment(const QPointF& point, const QLineF& segment);
+        static qreal distanceBetweenSegments(const QLineF& first, const QLineF& second);
+        static bool polygonIntersectsCapsule(const QPolygonF& polygon, const QLineF& axis, qreal radius);
+
         const static int centimeterGraduationHeight;
         const static int halfCentimeterGraduationHeight;
         const static int millimeterGraduationHeight;
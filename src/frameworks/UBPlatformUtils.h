@@ -193,6 +193,7 @@ public:
         static QString applicationResourcesDirectory();
         static void hideFile(const QString &filePath);
         static void setFileType(const QString &filePath, unsigned long fileType);
+        static bool hardLinkFile(const QString& source, const QString& destination);
         static void fadeDisplayOut();
         static void fadeDisplayIn();
         static QString translationPath(QString pFilePrefix, QString pLanguage);
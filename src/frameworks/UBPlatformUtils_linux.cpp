@@ -62,6 +62,11 @@ void UBPlatformUtils::setFileType(const QString &filePath, unsigned long fileTyp
     // No fileType equivalent on Linux
 }
 
+bool UBPlatformUtils::hardLinkFile(const QString& source, const QString& destination)
+{
+    return ::link(QFile::encodeName(source).constData(), QFile::encodeName(destination).constData()) == 0;
+}
+
 void UBPlatformUtils::fadeDisplayOut()
 {
     // NOOP
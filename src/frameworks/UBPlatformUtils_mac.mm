@@ -34,6 +34,8 @@
 
 #include <QWidget>
 
+#include <unistd.h>
+
 #import <Foundation/NSAutoreleasePool.h>
 #import <Cocoa/Cocoa.h>
 #import <Carbon/Carbon.h>
@@ -181,6 +183,11 @@ void UBPlatformUtils::setFileType(const QString &filePath, unsigned long fileTyp
     FSSetCatalogInfo(&ref, whichInfo, &catalogInfo);
 }
 
+bool UBPlatformUtils::hardLinkFile(const QString& source, const QString& destination)
+{
+    return ::link(QFile::encodeName(source).constData(), QFile::encodeName(destination).constData()) == 0;
+}
+
 static CGDisplayFadeReservationToken token = NULL;
 
 void UBPlatformUtils::fadeDisplayOut()
@@ -64,6 +64,12 @@ void UBPlatformUtils::setFileType(const QString &filePath, unsigned long fileTyp
     // Probably no fileType equivalent on Windows
 }
 
+bool UBPlatformUtils::hardLinkFile(const QString& source, const QString& destination)
+{
+    return CreateHardLinkW((LPCWSTR)QDir::toNativeSeparators(destination).utf16(),
+                           (LPCWSTR)QDir::toNativeSeparators(source).utf16(), NULL) != 0;
+}
+
 void UBPlatformUtils::fadeDisplayOut()
 {
     // NOOP
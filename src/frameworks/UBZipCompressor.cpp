@@ -0,0 +1,347 @@
+/*
+ * Copyright (C) 2015-2018 Département de l'Instruction Publique (DIP-SEM)
+ *
+ * Copyright (C) 2013 Open Education Foundation
+ *
+ * Copyright (C) 2010-2013 Groupement d'Intérêt Public pour
+ * l'Education Numérique en Afrique (GIP ENA)
+ *
+ * This file is part of OpenBoard.
+ *
+ * OpenBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License,
+ * with a specific linking exception for the OpenSSL project's
+ * "OpenSSL" library (or with modified versions of it that use the
+ * same license as the "OpenSSL" library).
+ *
+ * OpenBoard is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenBoard. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#include "UBZipCompressor.h"
+
+#include "frameworks/UBFileSystemUtils.h"
+
+#include "globals/UBGlobals.h"
+
+THIRD_PARTY_WARNINGS_DISABLE
+#include "quazipfile.h"
+#include "zlib.h"
+THIRD_PARTY_WARNINGS_ENABLE
+
+#include "core/memcheck.h"
+
+static const qint64 sChunkSize = 64 * 1024;
+
+// files bigger than that are deflated by the writer, chunk by chunk, instead of being held in memory
+static const qint64 sMaxDeflatedInAdvanceSize = 8 * 1024 * 1024;
+
+// memory held by the files deflated in advance, each one counting twice while it is read and deflated
+static const qint64 sMaxReadAheadSize = 32 * 1024 * 1024;
+
+
+UBZipCompressor::UBZipCompressor(QuaZipFile* pOutZipFile, UBProcessingProgressListener* progressListener)
+    : mOutZipFile(pOutZipFile)
+    , mProgressListener(progressListener)
+{
+    // NOOP
+}
+
+
+UBZipCompressor::~UBZipCompressor()
+{
+    mThreadPool.waitForDone();
+}
+
+
+bool UBZipCompressor::isCompressed(const QString& fileName)
+{
+    static QStringList compressedSuffixes = QStringList()
+            << "jpg" << "jpeg" << "png" << "gif" << "webp"
+            << "mp3" << "m4a" << "aac" << "ogg" << "oga" << "wma"
+            << "mp4" << "m4v" << "mov" << "avi" << "mkv" << "ogv" << "webm" << "wmv" << "flv" << "3gp"
+            << "pdf" << "zip" << "ubz" << "wgt" << "gz" << "7z" << "swf";
+
+    return compressedSuffixes.contains(QFileInfo(fileName).suffix().toLower());
+}
+
+
+bool UBZipCompressor::compress(const QDir& pDir, const QString& pDestPath, bool pRootDocumentFolder)
+{
+    mEntries.clear();
+    collectEntries(pDir, pDestPath, pRootDocumentFolder);
+
+    int nextToSchedule = 0;
+    qint64 readAheadSize = 0;
+    bool succeeded = true;
+
+    for (int i = 0; i < mEntries.size(); i++)
+    {
+        while (nextToSchedule < mEntries.size())
+        {
+            const Entry& next = mEntries.at(nextToSchedule);
+
+            if (next.deflatedInAdvance)
+            {
+                // the file being written is always scheduled, whatever its size
+                if (readAheadSize > 0 && readAheadSize + 2 * next.size > sMaxReadAheadSize)
+                    break;
+
+                mThreadPool.start(new DeflateWorker(this, nextToSchedule, next.filePath));
+                readAheadSize += 2 * next.size;
+            }
+
+            nextToSchedule++;
+        }
+
+        const Entry& entry = mEntries.at(i);
+
+        if (mProgressListener && !entry.objectType.isEmpty())
+            mProgressListener->processing(entry.objectType, entry.current, entry.total);
+
+        if (entry.deflatedInAdvance)
+            readAheadSize -= 2 * entry.size;
+
+        if (!writeEntry(entry, i))
+        {
+            succeeded = false;
+            break;
+        }
+    }
+
+    mThreadPool.waitForDone();
+    mDeflatedFiles.clear();
+
+    return succeeded;
+}
+
+
+void UBZipCompressor::collectEntries(const QDir& pDir, const QString& pDestPath, bool pRootDocumentFolder)
+{
+    QFileInfoList files = pDir.entryInfoList(QDir::AllDirs | QDir::Files | QDir::NoDotAndDotDot);
+
+    QStringList filters;
+    filters << "*.svg";
+    QFileInfoList pageFiles = pDir.entryInfoList(filters);
+
+    foreach (QFileInfo file, files)
+    {
+        if (file.isDir())
+        {
+            QDir dir(file.absoluteFilePath());
+            collectEntries(dir, pDestPath + dir.dirName() + "/", false);
+        }
+
+        if (file.isFile())
+        {
+            Entry entry;
+            entry.filePath = file.absoluteFilePath();
+            entry.zipPath = pDestPath + file.fileName();
+            entry.size = file.size();
+            entry.deflatedInAdvance = !isCompressed(file.fileName()) && file.size() <= sMaxDeflatedInAdvanceSize;
+
+            if (!pRootDocumentFolder)
+            {
+                entry.objectType = pDir.dirName();
+                entry.current = files.indexOf(file);
+                entry.total = files.size();
+            }
+            // we ignore thumbnails message because it is very fast.
+            else if (file.suffix() == "svg")
+            {
+                entry.objectType = "Page";
+                entry.current = pageFiles.indexOf(file);
+                entry.total = pageFiles.size();
+            }
+            else
+            {
+                entry.current = 0;
+                entry.total = 0;
+            }
+
+            mEntries << entry;
+        }
+    }
+}
+
+
+bool UBZipCompressor::writeEntry(const Entry& entry, int entryIndex)
+{
+    if (entry.deflatedInAdvance)
+    {
+        DeflatedFile deflated = takeDeflatedFile(entryIndex);
+
+        if (!deflated.succeeded)
+        {
+            qWarning() << "Compression of file" << entry.filePath << " failed. Cause: deflate failed";
+            return false;
+        }
+
+        return writeDeflatedEntry(entry, deflated);
+    }
+
+    return writeStreamedEntry(entry, isCompressed(entry.filePath));
+}
+
+
+bool UBZipCompressor::writeDeflatedEntry(const Entry& entry, const DeflatedFile& deflated)
+{
+    QuaZipNewInfo info(entry.zipPath, entry.filePath);
+    info.uncompressedSize = deflated.size;
+
+    if (!mOutZipFile->open(QIODevice::WriteOnly, info, NULL, deflated.crc, Z_DEFLATED, Z_DEFAULT_COMPRESSION, true))
+    {
+        qWarning() << "Compression of file" << entry.filePath << " failed. Cause: outFile.open(): " << mOutZipFile->getZipError();
+        return false;
+    }
+
+    mOutZipFile->write(deflated.data);
+    if (mOutZipFile->getZipError() != UNZ_OK)
+    {
+        qWarning() << "Compression of file" << entry.filePath << " failed. Cause: outFile.write(): " << mOutZipFile->getZipError();
+        mOutZipFile->close();
+        return false;
+    }
+
+    mOutZipFile->close();
+    if (mOutZipFile->getZipError() != UNZ_OK)
+    {
+        qWarning() << "Compression of file" << entry.filePath << " failed. Cause: outFile.close(): " << mOutZipFile->getZipError();
+        return false;
+    }
+
+    return true;
+}
+
+
+bool UBZipCompressor::writeStreamedEntry(const Entry& entry, bool store)
+{
+    QFile inFile(entry.filePath);
+    if (!inFile.open(QIODevice::ReadOnly))
+    {
+        qWarning() << "Compression of file" << inFile.fileName() << " failed. Cause: inFile.open(): " << inFile.errorString();
+        return false;
+    }
+
+    // already compressed files are stored, deflating them again only costs time
+    int method = store ? 0 : Z_DEFLATED;
+    int level = store ? 0 : Z_DEFAULT_COMPRESSION;
+
+    if (!mOutZipFile->open(QIODevice::WriteOnly, QuaZipNewInfo(entry.zipPath, inFile.fileName()), NULL, 0, method, level))
+    {
+        qWarning() << "Compression of file" << inFile.fileName() << " failed. Cause: outFile.open(): " << mOutZipFile->getZipError();
+        return false;
+    }
+
+    QByteArray buffer;
+    while (!inFile.atEnd())
+    {
+        buffer = inFile.read(sChunkSize);
+        if (buffer.isEmpty() && inFile.error() != QFile::NoError)
+        {
+            qWarning() << "Compression of file" << inFile.fileName() << " failed. Cause: inFile.read(): " << inFile.errorString();
+            mOutZipFile->close();
+            return false;
+        }
+
+        mOutZipFile->write(buffer);
+        if (mOutZipFile->getZipError() != UNZ_OK)
+        {
+            qWarning() << "Compression of file" << inFile.fileName() << " failed. Cause: outFile.write(): " << mOutZipFile->getZipError();
+            mOutZipFile->close();
+            return false;
+        }
+    }
+
+    mOutZipFile->close();
+    if (mOutZipFile->getZipError() != UNZ_OK)
+    {
+        qWarning() << "Compression of file" << inFile.fileName() << " failed. Cause: outFile.close(): " << mOutZipFile->getZipError();
+        return false;
+    }
+
+    return true;
+}
+
+
+void UBZipCompressor::fileDeflated(int entryIndex, const DeflatedFile& deflated)
+{
+    QMutexLocker locker(&mMutex);
+    mDeflatedFiles.insert(entryIndex, deflated);
+    mFileDeflated.wakeAll();
+}
+
+
+UBZipCompressor::DeflatedFile UBZipCompressor::takeDeflatedFile(int entryIndex)
+{
+    QMutexLocker locker(&mMutex);
+
+    while (!mDeflatedFiles.contains(entryIndex))
+        mFileDeflated.wait(&mMutex);
+
+    return mDeflatedFiles.take(entryIndex);
+}
+
+
+void UBZipCompressor::DeflateWorker::run()
+{
+    DeflatedFile deflated;
+    deflated.succeeded = false;
+    deflated.crc = 0;
+    deflated.size = 0;
+
+    QFile inFile(mFilePath);
+    if (!inFile.open(QIODevice::ReadOnly))
+    {
+        qWarning() << "cannot open" << mFilePath << "for compression:" << inFile.errorString();
+        mCompressor->fileDeflated(mEntryIndex, deflated);
+        return;
+    }
+
+    QByteArray content = inFile.readAll();
+    inFile.close();
+
+    deflated.size = content.size();
+    deflated.crc = crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(content.constData()), content.size());
+
+    // negative window bits produce raw deflate data, the zip entry headers are written by QuaZip
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK)
+    {
+        deflated.data.resize(deflateBound(&stream, content.size()));
+
+        stream.next_in = reinterpret_cast<Bytef*>(content.data());
+        stream.avail_in = content.size();
+        stream.next_out = reinterpret_cast<Bytef*>(deflated.data.data());
+        stream.avail_out = deflated.data.size();
+
+        if (deflate(&stream, Z_FINISH) == Z_STREAM_END)
+        {
+            deflated.data.resize(stream.total_out);
+            // release the unused part of the deflate bound while the file waits for the writer
+            deflated.data.squeeze();
+            deflated.succeeded = true;
+        }
+
+        deflateEnd(&stream);
+    }
+
+    if (!deflated.succeeded)
+    {
+        qWarning() << "cannot deflate" << mFilePath;
+        deflated.data.clear();
+    }
+
+    mCompressor->fileDeflated(mEntryIndex, deflated);
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright (C) 2015-2018 Département de l'Instruction Publique (DIP-SEM)
+ *
+ * Copyright (C) 2013 Open Education Foundation
+ *
+ * Copyright (C) 2010-2013 Groupement d'Intérêt Public pour
+ * l'Education Numérique en Afrique (GIP ENA)
+ *
+ * This file is part of OpenBoard.
+ *
+ * OpenBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License,
+ * with a specific linking exception for the OpenSSL project's
+ * "OpenSSL" library (or with modified versions of it that use the
+ * same license as the "OpenSSL" library).
+ *
+ * OpenBoard is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenBoard. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+#ifndef UBZIPCOMPRESSOR_H_
+#define UBZIPCOMPRESSOR_H_
+
+#include <QtCore>
+#include <QThreadPool>
+#include <QRunnable>
+
+class QuaZipFile;
+class UBProcessingProgressListener;
+
+/**
+ * @brief Writes the content of a directory into a zip file
+ *
+ * Files that are already compressed (pictures, media, PDF) are stored as they are. Other files are deflated
+ * on a thread pool ahead of the one being written, and added in raw mode. Files are read in chunks, except
+ * for the small ones deflated in advance, whose read-ahead is bounded in bytes, so the memory used does not
+ * depend on the size of the directory.
+ */
+class UBZipCompressor
+{
+    public:
+        UBZipCompressor(QuaZipFile* pOutZipFile, UBProcessingProgressListener* progressListener = 0);
+        virtual ~UBZipCompressor();
+
+        bool compress(const QDir& pDir, const QString& pDestPath, bool pRootDocumentFolder);
+
+        static bool isCompressed(const QString& fileName);
+
+    private:
+        struct Entry
+        {
+            QString filePath;
+            QString zipPath;
+            QString objectType;
+            qint64 size;
+            int current;
+            int total;
+            bool deflatedInAdvance;
+        };
+
+        struct DeflatedFile
+        {
+            bool succeeded;
+            QByteArray data;
+            quint32 crc;
+            qint64 size;
+        };
+
+        class DeflateWorker : public QRunnable
+        {
+            public:
+                DeflateWorker(UBZipCompressor* compressor, int entryIndex, const QString& filePath)
+                    : mCompressor(compressor)
+                    , mEntryIndex(entryIndex)
+                    , mFilePath(filePath)
+                {
+                    // NOOP
+                }
+
+                void run();
+
+            private:
+                UBZipCompressor* mCompressor;
+                int mEntryIndex;
+                QString mFilePath;
+        };
+
+        void collectEntries(const QDir& pDir, const QString& pDestPath, bool pRootDocumentFolder);
+        bool writeEntry(const Entry& entry, int entryIndex);
+        bool writeDeflatedEntry(const Entry& entry, const DeflatedFile& deflated);
+        bool writeStreamedEntry(const Entry& entry, bool store);
+
+        void fileDeflated(int entryIndex, const DeflatedFile& deflated);
+        DeflatedFile takeDeflatedFile(int entryIndex);
+
+        QuaZipFile* mOutZipFile;
+        UBProcessingProgressListener* mProgressListener;
+
+        QList<Entry> mEntries;
+
+        QThreadPool mThreadPool;
+        QMutex mMutex;
+        QWaitCondition mFileDeflated;
+        QHash<int, DeflatedFile> mDeflatedFiles;
+};
+
+#endif /* UBZIPCOMPRESSOR_H_ */
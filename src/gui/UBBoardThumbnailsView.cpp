@@ -46,15 +46,16 @@
 #include "board/UBBoardPaletteManager.h"
 #include "core/UBApplicationController.h"
 #include "core/UBPersistenceManager.h"
-#include "UBThumbnailView.h"
+#include "core/UBThumbnailCache.h"
 
 UBBoardThumbnailsView::UBBoardThumbnailsView(QWidget *parent, const char *name)
     : QGraphicsView(parent)
     , mThumbnailWidth(0)
     , mThumbnailMinWidth(100)
     , mMargin(20)
-    , mDropSource(NULL)
-    , mDropTarget(NULL)
+    , mSource(NULL)
+    , mDropSource(-1)
+    , mDropTarget(-1)
     , mDropBar(new QGraphicsRectItem(0))
     , mLongPressInterval(350)
 {
@@ -80,6 +81,10 @@ UBBoardThumbnailsView::UBBoardThumbnailsView(QWidget *parent, const char *name)
     connect(this, SIGNAL(moveThumbnailRequired(int, int)), this, SLOT(moveThumbnail(int, int)), Qt::UniqueConnection);
     connect(UBApplication::boardController, SIGNAL(updateThumbnailsRequired()), this, SLOT(updateThumbnails()), Qt::UniqueConnection);
     connect(UBApplication::boardController, SIGNAL(removeThumbnailRequired(int)), this, SLOT(removeThumbnail(int)), Qt::UniqueConnection);
+    connect(UBApplication::boardController, SIGNAL(documentPageUpdated(int)), this, SLOT(updateThumbnailPixmaps()), Qt::UniqueConnection);
+
+    connect(verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(updateVisibleThumbnails()), Qt::UniqueConnection);
+    connect(UBThumbnailCache::thumbnailCache(), SIGNAL(thumbnailLoaded(QString)), this, SLOT(updateThumbnailPixmaps()), Qt::UniqueConnection);
 
     connect(&mLongPressTimer, SIGNAL(timeout()), this, SLOT(longPressTimeout()), Qt::UniqueConnection);
 
@@ -91,8 +96,11 @@ UBBoardThumbnailsView::UBBoardThumbnailsView(QWidget *parent, const char *name)
 
 void UBBoardThumbnailsView::moveThumbnail(int from, int to)
 {
-    mThumbnails.move(from, to);
+    Q_UNUSED(from);
+    Q_UNUSED(to);
 
+    // the visible items are recreated for their new pages
+    clearThumbnails();
     updateThumbnailsPos();
 }
 
@@ -103,90 +111,154 @@ void UBBoardThumbnailsView::updateThumbnails()
 
 void UBBoardThumbnailsView::removeThumbnail(int i)
 {
-    UBDraggableThumbnailView* item = mThumbnails.at(i);
-
-    scene()->removeItem(item->pageNumber());
-    scene()->removeItem(item);
-
-    mThumbnails.removeAt(i);
+    Q_UNUSED(i);
 
+    clearThumbnails();
     updateThumbnailsPos();
 }
 
-UBDraggableThumbnailView* UBBoardThumbnailsView::createThumbnail(UBDocumentContainer* source, int i)
+UBDraggableThumbnailView* UBBoardThumbnailsView::createThumbnail(int i)
 {
-    UBApplication::showMessage(tr("Loading page (%1/%2)").arg(i+1).arg(source->selectedDocument()->pageCount()));
+    QPixmap pixmap = UBThumbnailCache::thumbnailCache()->thumbnail(mSource->selectedDocument(), i);
 
-    UBGraphicsScene* pageScene = UBPersistenceManager::persistenceManager()->loadDocumentScene(source->selectedDocument(), i);
-    UBThumbnailView* pageView = new UBThumbnailView(pageScene);
+    if (pixmap.isNull())
+        pixmap = UBThumbnailCache::thumbnailCache()->placeholder();
 
-    return new UBDraggableThumbnailView(pageView, source->selectedDocument(), i);
+    return new UBDraggableThumbnailView(pixmap, mSource->selectedDocument(), i);
+}
+
+void UBBoardThumbnailsView::deleteThumbnail(UBDraggableThumbnailView* item)
+{
+    scene()->removeItem(item->pageNumber());
+    scene()->removeItem(item);
+    item->deleteLater();
 }
 
 void UBBoardThumbnailsView::addThumbnail(UBDocumentContainer* source, int i)
 {
-    UBDraggableThumbnailView* item = createThumbnail(source, i);
-    mThumbnails.insert(i, item);
+    Q_UNUSED(i);
 
-    scene()->addItem(item);
-    scene()->addItem(item->pageNumber());
+    mSource = source;
 
+    clearThumbnails();
     updateThumbnailsPos();
 }
 
 void UBBoardThumbnailsView::clearThumbnails()
 {
-    for(int i = 0; i < mThumbnails.size(); i++)
-    {
-        scene()->removeItem(mThumbnails.at(i)->pageNumber());
-        scene()->removeItem(mThumbnails.at(i));
-        mThumbnails.at(i)->deleteLater();
-    }
+    foreach(UBDraggableThumbnailView* item, mThumbnails)
+        deleteThumbnail(item);
 
     mThumbnails.clear();
 }
 
 void UBBoardThumbnailsView::initThumbnails(UBDocumentContainer* source)
 {
+    mSource = source;
+
     clearThumbnails();
+    updateThumbnailsPos();
+}
 
-    for(int i = 0; i < source->selectedDocument()->pageCount(); i++)
-    {
-        mThumbnails.append(createThumbnail(source, i));
+int UBBoardThumbnailsView::pageCount()
+{
+    if (!mSource || !mSource->selectedDocument())
+        return 0;
 
-        scene()->addItem(mThumbnails.last());
-        scene()->addItem(mThumbnails.last()->pageNumber());
-    }
+    return mSource->selectedDocument()->pageCount();
+}
 
-    updateThumbnailsPos();
+qreal UBBoardThumbnailsView::thumbnailRowHeight()
+{
+    // must match the layout of UBDraggableThumbnail::updatePos
+    QFontMetrics fm(QApplication::font());
+
+    return mThumbnailWidth / UBSettings::minScreenRatio + UBSettings::thumbnailSpacing + fm.height();
+}
+
+QRectF UBBoardThumbnailsView::thumbnailRect(int index)
+{
+    return QRectF(0, index * thumbnailRowHeight(), mThumbnailWidth, thumbnailRowHeight());
 }
 
 void UBBoardThumbnailsView::centerOnThumbnail(int index)
 {
-    centerOn(mThumbnails.at(index));
+    centerOn(thumbnailRect(index).center());
 }
 
 void UBBoardThumbnailsView::ensureVisibleThumbnail(int index)
 {
-    ensureVisible(mThumbnails.at(index));
+    ensureVisible(thumbnailRect(index));
 }
 
 void UBBoardThumbnailsView::updateThumbnailsPos()
 {    
-    qreal thumbnailHeight = mThumbnailWidth / UBSettings::minScreenRatio;
+    scene()->setSceneRect(0, 0, mThumbnailWidth, pageCount() * thumbnailRowHeight());
+
+    updateVisibleThumbnails();
+}
+
+/**
+ * @brief Create the thumbnails of the visible pages and delete the others
+ *
+ * Pages within one screen of the visible area are kept, so that scrolling does not show empty rows.
+ */
+void UBBoardThumbnailsView::updateVisibleThumbnails()
+{
+    int count = pageCount();
 
-    for (int i=0; i < mThumbnails.length(); i++)
+    QRectF visibleArea = mapToScene(viewport()->rect()).boundingRect();
+    qreal rowHeight = thumbnailRowHeight();
+
+    int first = qMax(0, (int)((visibleArea.top() - visibleArea.height()) / rowHeight));
+    int last = qMin(count - 1, (int)((visibleArea.bottom() + visibleArea.height()) / rowHeight));
+
+    foreach(int i, mThumbnails.keys())
     {
-        mThumbnails.at(i)->setSceneIndex(i);
-        mThumbnails.at(i)->setPageNumber(i);
-        mThumbnails.at(i)->updatePos(mThumbnailWidth, thumbnailHeight);
+        if (i < first || i > last)
+            deleteThumbnail(mThumbnails.take(i));
     }
 
-    scene()->setSceneRect(0, 0, scene()->itemsBoundingRect().size().width() - verticalScrollBar()->width(), scene()->itemsBoundingRect().size().height());
+    qreal thumbnailHeight = mThumbnailWidth / UBSettings::minScreenRatio;
+
+    for (int i = first; i <= last; i++)
+    {
+        UBDraggableThumbnailView* item = mThumbnails.value(i);
+
+        if (!item)
+        {
+            item = createThumbnail(i);
+            mThumbnails.insert(i, item);
+
+            scene()->addItem(item);
+            scene()->addItem(item->pageNumber());
+        }
+
+        item->setSceneIndex(i);
+        item->setPageNumber(i);
+        item->updatePos(mThumbnailWidth, thumbnailHeight);
+    }
 
     update();
 }
 
+void UBBoardThumbnailsView::updateThumbnailPixmaps()
+{
+    qreal thumbnailHeight = mThumbnailWidth / UBSettings::minScreenRatio;
+
+    foreach(UBDraggableThumbnailView* item, mThumbnails)
+    {
+        QPixmap pixmap = UBThumbnailCache::thumbnailCache()->thumbnail(item->documentProxy(), item->sceneIndex());
+
+        // keep the current pixmap while the thumbnail is being decoded
+        if (!pixmap.isNull() && pixmap.cacheKey() != item->thumbnail()->cacheKey())
+        {
+            item->setThumbnail(pixmap);
+            item->updatePos(mThumbnailWidth, thumbnailHeight);
+        }
+    }
+}
+
 void UBBoardThumbnailsView::resizeEvent(QResizeEvent *event)
 {
     Q_UNUSED(event);
@@ -239,8 +311,8 @@ void UBBoardThumbnailsView::mousePressAndHoldEvent(QPoint pos)
     UBDraggableThumbnailView* item = dynamic_cast<UBDraggableThumbnailView*>(itemAt(pos));
     if (item)
     {
-        mDropSource = item;
-        mDropTarget = item;
+        mDropSource = item->sceneIndex();
+        mDropTarget = item->sceneIndex();
 
         QPixmap pixmap = item->widget()->grab().scaledToWidth(mThumbnailWidth/2);
 
@@ -289,8 +361,8 @@ void UBBoardThumbnailsView::dragMoveEvent(QDragMoveEvent *event)
     UBDraggableThumbnailView* item = dynamic_cast<UBDraggableThumbnailView*>(itemAt(position.toPoint()));
     if (item)
     {
-        if (item != mDropTarget)
-            mDropTarget = item;
+        if (item->sceneIndex() != mDropTarget)
+            mDropTarget = item->sceneIndex();
 
         qreal scale = item->transform().m11();
 
@@ -298,7 +370,7 @@ void UBBoardThumbnailsView::dragMoveEvent(QDragMoveEvent *event)
                            item->pos().y() + item->boundingRect().height() * scale / 2);
 
         bool dropAbove = mapToScene(position.toPoint()).y() < itemCenter.y();
-        bool movingUp = mDropSource->sceneIndex() > item->sceneIndex();
+        bool movingUp = mDropSource > item->sceneIndex();
         qreal y = 0;
 
         if (movingUp)
@@ -328,11 +400,11 @@ void UBBoardThumbnailsView::dropEvent(QDropEvent *event)
 {
     Q_UNUSED(event);
 
-    if (mDropSource->sceneIndex() != mDropTarget->sceneIndex())
-        UBApplication::boardController->moveSceneToIndex(mDropSource->sceneIndex(), mDropTarget->sceneIndex());
+    if (mDropSource >= 0 && mDropTarget >= 0 && mDropSource != mDropTarget)
+        UBApplication::boardController->moveSceneToIndex(mDropSource, mDropTarget);
 
-    mDropSource = NULL;
-    mDropTarget = NULL;
+    mDropSource = -1;
+    mDropTarget = -1;
 
     mDropBar->setRect(QRectF());
     mDropBar->hide();
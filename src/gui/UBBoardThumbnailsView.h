@@ -54,6 +54,8 @@ public slots:
     void moveThumbnail(int from, int to);
     void removeThumbnail(int i);
     void updateThumbnails();
+    void updateVisibleThumbnails();
+    void updateThumbnailPixmaps();
 
     void longPressTimeout();
     void mousePressAndHoldEvent(QPoint pos);
@@ -74,17 +76,24 @@ signals:
     void moveThumbnailRequired(int from, int to);
 
 private:
-    UBDraggableThumbnailView* createThumbnail(UBDocumentContainer* source, int i);
+    UBDraggableThumbnailView* createThumbnail(int i);
+    void deleteThumbnail(UBDraggableThumbnailView* item);
     void updateThumbnailsPos();
+    int pageCount();
+    qreal thumbnailRowHeight();
+    QRectF thumbnailRect(int index);
 
-    QList<UBDraggableThumbnailView*> mThumbnails;
+    // only the thumbnails of the visible pages are created, by page index
+    QMap<int, UBDraggableThumbnailView*> mThumbnails;
+    UBDocumentContainer* mSource;
 
     int mThumbnailWidth;
     const int mThumbnailMinWidth;
     const int mMargin;
 
-    UBDraggableThumbnailView* mDropSource;
-    UBDraggableThumbnailView* mDropTarget;
+    // page indexes, as the items may be deleted when scrolling during the drag
+    int mDropSource;
+    int mDropTarget;
     QGraphicsRectItem *mDropBar;
 
     int mLongPressInterval;
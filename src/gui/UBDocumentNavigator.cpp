@@ -45,6 +45,7 @@
 #include "domain/UBGraphicsScene.h"
 #include "board/UBBoardPaletteManager.h"
 #include "core/UBApplicationController.h"
+#include "core/UBThumbnailCache.h"
 
 #include "core/memcheck.h"
 
@@ -84,6 +85,9 @@ UBDocumentNavigator::UBDocumentNavigator(QWidget *parent, const char *name):QGra
     connect(UBApplication::boardController, SIGNAL(documentPageUpdated(int)), this, SLOT(updateSpecificThumbnail(int)));
     connect(UBApplication::boardController, SIGNAL(pageSelectionChanged(int)), this, SLOT(onScrollToSelectedPage(int)));
 
+    connect(verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(updateVisibleThumbnails()));
+    connect(UBThumbnailCache::thumbnailCache(), SIGNAL(thumbnailLoaded(QString)), this, SLOT(updateVisibleThumbnails()));
+
     connect(&mLongPressTimer, SIGNAL(timeout()), this, SLOT(longPressTimeout()), Qt::UniqueConnection);
 
     connect(this, SIGNAL(mousePressAndHoldEventRequired(QPoint)), this, SLOT(mousePressAndHoldEvent(QPoint)), Qt::UniqueConnection);
@@ -123,18 +127,14 @@ void UBDocumentNavigator::generateThumbnails(UBDocumentContainer* source)
         }
     }
 
+    // every page starts with the shared placeholder, the thumbnails are only decoded once visible
+    QPixmap placeholder = UBThumbnailCache::thumbnailCache()->placeholder();
+
     for(int i = 0; i < source->selectedDocument()->pageCount(); i++)
     {
-        //claudio This is a very bad hack and shows a architectural problem
-        // source->selectedDocument()->pageCount()  !=   source->pageCount()
-        if(i>=source->pageCount() || !source->pageAt(i))
-            source->insertThumbPage(i);
-
-        const QPixmap* pix = source->pageAt(i);
-        Q_ASSERT(!pix->isNull());
         int pageIndex = UBDocumentContainer::pageFromSceneIndex(i);
 
-        UBSceneThumbnailNavigPixmap* pixmapItem = new UBSceneThumbnailNavigPixmap(*pix, source->selectedDocument(), i);
+        UBSceneThumbnailNavigPixmap* pixmapItem = new UBSceneThumbnailNavigPixmap(placeholder, source->selectedDocument(), i);
 
         QString label = tr("Page %0").arg(pageIndex);
         UBThumbnailTextItem *labelItem = new UBThumbnailTextItem(label);
@@ -182,20 +182,43 @@ void UBDocumentNavigator::onScrollToSelectedPage(int index)
  */
 void UBDocumentNavigator::updateSpecificThumbnail(int iPage)
 {
-    const QPixmap* pix = UBApplication::boardController->pageAt(iPage);
-    UBSceneThumbnailNavigPixmap* newItem = new UBSceneThumbnailNavigPixmap(*pix, UBApplication::boardController->selectedDocument(), iPage);
+    // the old thumbnail stays until the new one is decoded
+    if (iPage < mThumbsWithLabels.size())
+        updateVisibleThumbnails();
+}
+
+/**
+ * \brief Show the decoded thumbnails of the visible pages, and release the others
+ *
+ * Pages within one screen of the visible area are kept, so that scrolling does not show placeholders.
+ */
+void UBDocumentNavigator::updateVisibleThumbnails()
+{
+    QRectF visibleArea = mapToScene(viewport()->rect()).boundingRect();
+    visibleArea.adjust(0, -visibleArea.height(), 0, visibleArea.height());
+
+    QPixmap placeholder = UBThumbnailCache::thumbnailCache()->placeholder();
 
-    // Get the old thumbnail
-    UBSceneThumbnailNavigPixmap* oldItem = mThumbsWithLabels.at(iPage).getThumbnail();
-    if(NULL != oldItem)
+    for(int i = 0; i < mThumbsWithLabels.size(); i++)
     {
-        mScene->removeItem(oldItem);
-        mScene->addItem(newItem);
-        mThumbsWithLabels[iPage].setThumbnail(newItem);
-        delete oldItem;
-        oldItem = NULL;
-    }
+        UBSceneThumbnailNavigPixmap* item = mThumbsWithLabels.at(i).getThumbnail();
+        QPixmap pixmap = placeholder;
+
+        if (visibleArea.intersects(item->sceneBoundingRect()))
+        {
+            pixmap = UBThumbnailCache::thumbnailCache()->thumbnail(item->proxy(), i);
+
+            // keep the current pixmap while the thumbnail is being decoded
+            if (pixmap.isNull())
+                continue;
+        }
 
+        if (pixmap.cacheKey() != item->pixmap().cacheKey())
+        {
+            item->setPixmap(pixmap);
+            placeThumbnail(i);
+        }
+    }
 }
 
 /**
@@ -203,17 +226,25 @@ void UBDocumentNavigator::updateSpecificThumbnail(int iPage)
  */
 void UBDocumentNavigator::refreshScene()
 {
-    qreal thumbnailHeight = mThumbnailWidth / UBSettings::minScreenRatio;
-
     for(int i = 0; i < mThumbsWithLabels.size(); i++)
-    {
-        // Get the item
-        UBImgTextThumbnailElement& item = mThumbsWithLabels[i];
-        int columnIndex = i % mNbColumns;
-        int rowIndex = i / mNbColumns;
-        item.Place(rowIndex, columnIndex, mThumbnailWidth, thumbnailHeight);
-    }
+        placeThumbnail(i);
+
     scene()->setSceneRect(scene()->itemsBoundingRect());
+
+    updateVisibleThumbnails();
+}
+
+/**
+ * \brief Put the given element in the right place in the scene.
+ * @param index as the index of the element
+ */
+void UBDocumentNavigator::placeThumbnail(int index)
+{
+    qreal thumbnailHeight = mThumbnailWidth / UBSettings::minScreenRatio;
+
+    int columnIndex = index % mNbColumns;
+    int rowIndex = index / mNbColumns;
+    mThumbsWithLabels[index].Place(rowIndex, columnIndex, mThumbnailWidth, thumbnailHeight);
 }
 
 /**
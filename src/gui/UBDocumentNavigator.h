@@ -57,7 +57,8 @@ public:
 public slots:
     void onScrollToSelectedPage(int index);// { if (mCrntItem) centerOn(mCrntItem); }
     void generateThumbnails(UBDocumentContainer* source);
-    void updateSpecificThumbnail(int iPage);    
+    void updateSpecificThumbnail(int iPage);
+    void updateVisibleThumbnails();
 
     void longPressTimeout();
     void mousePressAndHoldEvent(QPoint pos);
@@ -78,6 +79,7 @@ signals:
 private:
 
     void refreshScene();
+    void placeThumbnail(int index);
     int border();
 
     /** The scene */
@@ -27,11 +27,14 @@
 
 
 
+#include <QScrollBar>
+
 #include "UBDocumentThumbnailWidget.h"
 
 #include "core/UBApplication.h"
 #include "core/UBMimeData.h"
 #include "core/UBSettings.h"
+#include "core/UBThumbnailCache.h"
 
 #include "board/UBBoardController.h"
 
@@ -46,10 +49,15 @@ UBDocumentThumbnailWidget::UBDocumentThumbnailWidget(QWidget* parent)
     , mClosestDropItem(0)
     , mDragEnabled(true)
     , mScrollMagnitude(0)
+    , mUpdatingThumbnails(false)
 {
     bCanDrag = false;
     mScrollTimer = new QTimer(this);
     connect(mScrollTimer, SIGNAL(timeout()), this, SLOT(autoScroll()));
+
+    connect(verticalScrollBar(), SIGNAL(valueChanged(int)), this, SLOT(updateVisibleThumbnails()));
+    connect(verticalScrollBar(), SIGNAL(rangeChanged(int, int)), this, SLOT(updateVisibleThumbnails()));
+    connect(UBThumbnailCache::thumbnailCache(), SIGNAL(thumbnailLoaded(const QString&)), this, SLOT(updateVisibleThumbnails()));
 }
 
 
@@ -285,6 +293,57 @@ void UBDocumentThumbnailWidget::setGraphicsItems(const QList<QGraphicsItem*>& pG
     deleteDropCaret();
 
     UBThumbnailWidget::setGraphicsItems(pGraphicsItems, pItemPaths, pLabels, pMimeType);
+
+    updateVisibleThumbnails();
+}
+
+/**
+ * @brief Show the thumbnails of the pages around the visible area, and the placeholder everywhere else
+ *
+ * Thumbnails come from the UBThumbnailCache, so the pixmaps of the pages scrolled away can be released.
+ */
+void UBDocumentThumbnailWidget::updateVisibleThumbnails()
+{
+    if (mUpdatingThumbnails)
+        return;
+
+    mUpdatingThumbnails = true;
+
+    QRectF visibleArea = mapToScene(viewport()->rect()).boundingRect();
+    visibleArea.adjust(0, -visibleArea.height(), 0, visibleArea.height());
+
+    QPixmap placeholder = UBThumbnailCache::thumbnailCache()->placeholder();
+    bool sizeChanged = false;
+
+    foreach(QGraphicsItem* graphicsItem, mGraphicItems)
+    {
+        UBSceneThumbnailPixmap* item = dynamic_cast<UBSceneThumbnailPixmap*>(graphicsItem);
+        if (!item || !item->proxy())
+            continue;
+
+        QPixmap pixmap = placeholder;
+
+        if (visibleArea.intersects(item->sceneBoundingRect()))
+        {
+            pixmap = UBThumbnailCache::thumbnailCache()->thumbnail(item->proxy(), item->sceneIndex());
+
+            // keep the current pixmap while the thumbnail is being decoded
+            if (pixmap.isNull())
+                continue;
+        }
+
+        if (pixmap.cacheKey() != item->pixmap().cacheKey())
+        {
+            sizeChanged |= pixmap.size() != item->pixmap().size();
+            item->setPixmap(pixmap);
+        }
+    }
+
+    // items are scaled and centered in their cell according to their size
+    if (sizeChanged)
+        refreshScene();
+
+    mUpdatingThumbnails = false;
 }
 
 void UBDocumentThumbnailWidget::setDragEnabled(bool enabled)
@@ -57,6 +57,7 @@ class UBDocumentThumbnailWidget: public UBThumbnailWidget
 
     private slots:
         void autoScroll();
+        void updateVisibleThumbnails();
 
     protected:
 
@@ -76,6 +77,7 @@ class UBDocumentThumbnailWidget: public UBThumbnailWidget
         bool mDragEnabled;
         QTimer* mScrollTimer;
         int mScrollMagnitude;
+        bool mUpdatingThumbnails;
 };
 
 #endif /* UBDOCUMENTTHUMBNAILWIDGET_H_ */
@@ -299,8 +299,8 @@ void UBDocumentTreeWidget::dropEvent(QDropEvent *event)
 
                             //due to incorrect generation of thumbnails of invisible scene I've used direct copying of thumbnail files
                             //it's not universal and good way but it's faster
-                            QString from = sourceItem.documentProxy()->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.jpg", sourceItem.sceneIndex());
-                            QString to  = targetDocProxy->persistencePath() + UBFileSystemUtils::digitFileFormat("/page%1.thumbnail.jpg", targetDocProxy->pageCount());
+                            QString from = UBPersistenceManager::persistenceManager()->thumbnailFileName(sourceItem.documentProxy(), sourceItem.sceneIndex());
+                            QString to  = UBPersistenceManager::persistenceManager()->thumbnailFileName(targetDocProxy, targetDocProxy->pageCount() - 1);
                             QFile::remove(to);
                             QFile::copy(from, to);
                           }
@@ -547,23 +547,26 @@ class UBDraggableThumbnailView : public UBDraggableThumbnail
 {
     Q_OBJECT
     public:
-        UBDraggableThumbnailView(UBThumbnailView* thumbnailView, UBDocumentProxy* documentProxy, int index)
+        UBDraggableThumbnailView(const QPixmap& pixmap, UBDocumentProxy* documentProxy, int index)
             : UBDraggableThumbnail(documentProxy, index)
-            , mThumbnailView(thumbnailView)
+            , mThumbnailLabel(new QLabel())
         {
             setFlag(QGraphicsItem::ItemIsSelectable, true);
-            setWidget(mThumbnailView);
-            setAcceptDrops(true);            
+            mThumbnailLabel->setStyleSheet("background:white");
+            setThumbnail(pixmap);
+            setWidget(mThumbnailLabel);
+            setAcceptDrops(true);
         }
 
-        ~UBDraggableThumbnailView()
+        const QPixmap* thumbnail()
         {
-            delete mPageNumber; // not a child of "this" QObject so it has to be deleted manually
+            return mThumbnailLabel->pixmap();
         }
 
-        UBThumbnailView* thumbnailView()
+        void setThumbnail(const QPixmap& pixmap)
         {
-            return mThumbnailView;
+            mThumbnailLabel->setPixmap(pixmap);
+            mThumbnailLabel->setFixedSize(pixmap.size());
         }
 
         UBThumbnailTextItem* pageNumber()
@@ -581,8 +584,8 @@ class UBDraggableThumbnailView : public UBDraggableThumbnail
                 mPageNumber->setHtml("<span style=\";color: #000000\">" + tr("Page %0").arg(i+1) + "</span>");
         }
 
-    private:        
-        UBThumbnailView* mThumbnailView;
+    private:
+        QLabel* mThumbnailLabel;
 };
 
 namespace UBThumbnailUI
@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2015-2018 Département de l'Instruction Publique (DIP-SEM)
+ *
+ * Copyright (C) 2013 Open Education Foundation
+ *
+ * Copyright (C) 2010-2013 Groupement d'Intérêt Public pour
+ * l'Education Numérique en Afrique (GIP ENA)
+ *
+ * This file is part of OpenBoard.
+ *
+ * OpenBoard is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3 of the License,
+ * with a specific linking exception for the OpenSSL project's
+ * "OpenSSL" library (or with modified versions of it that use the
+ * same license as the "OpenSSL" library).
+ *
+ * OpenBoard is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with OpenBoard. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+
+
+#if !defined ContentView_h
+#define ContentView_h
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <string.h>
+
+namespace merge_lib
+{
+   //This class gives read-only access to a buffer it does not own,
+   //typically a mapped file, with the subset of the std::string
+   //interface the parser needs. Out of range characters read as '\0',
+   //as std::string does at its end, so scans stop at the end of the buffer.
+   class ContentView
+   {
+   public:
+      static const size_t npos = std::string::npos;
+
+      ContentView(): _data(0), _size(0) {}
+      ContentView(const char * data, size_t size): _data(data), _size(size) {}
+
+      const char * data() const { return _data; }
+      size_t size() const { return _size; }
+      bool empty() const { return _size == 0; }
+
+      char operator[](size_t position) const
+      {
+         return position < _size ? _data[position] : '\0';
+      }
+
+      size_t find(const std::string & str, size_t position = 0) const
+      {
+         if(position > _size || str.size() > _size - position)
+            return npos;
+         const char * end = _data + _size;
+         const char * found = std::search(_data + position, end, str.begin(), str.end());
+         return found == end ? npos : found - _data;
+      }
+
+      size_t rfind(const std::string & str, size_t position = npos) const
+      {
+         if(str.size() > _size)
+            return npos;
+         size_t current = std::min(position, _size - str.size()) + 1;
+         while(current-- > 0)
+         {
+            if(memcmp(_data + current, str.data(), str.size()) == 0)
+               return current;
+         }
+         return npos;
+      }
+
+      size_t find_first_of(const std::string & chars, size_t position = 0) const
+      {
+         for(; position < _size; ++position)
+         {
+            if(chars.find(_data[position]) != std::string::npos)
+               return position;
+         }
+         return npos;
+      }
+
+      size_t find_first_not_of(const std::string & chars, size_t position = 0) const
+      {
+         for(; position < _size; ++position)
+         {
+            if(chars.find(_data[position]) == std::string::npos)
+               return position;
+         }
+         return npos;
+      }
+
+      size_t find_last_of(const std::string & chars, size_t position = npos) const
+      {
+         if(_size == 0)
+            return npos;
+         size_t current = std::min(position, _size - 1) + 1;
+         while(current-- > 0)
+         {
+            if(chars.find(_data[current]) != std::string::npos)
+               return current;
+         }
+         return npos;
+      }
+
+      std::string substr(size_t position, size_t length = npos) const
+      {
+         if(position > _size)
+            throw std::out_of_range("ContentView::substr");
+         return std::string(_data + position, std::min(length, _size - position));
+      }
+
+      int compare(size_t position, size_t length, const char * str) const
+      {
+         return substr(position, length).compare(str);
+      }
+
+   private:
+      const char * _data;
+      size_t       _size;
+   };
+}
+#endif
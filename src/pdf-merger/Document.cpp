@@ -40,10 +40,9 @@
 #include "core/memcheck.h"
 
 using namespace merge_lib;
-const std::string firstObj("%PDF-1.4\n1 0 obj\n<<\n/Title ()/Creator ()/Producer (Qt 4.5.0 (C) 1992-2009 Nokia Corporation and/or its subsidiary(-ies))/CreationDate (D:20090424120829)\n>>\nendobj\n");
-const std::string zeroStr("0000000000");
+const std::string firstObj("%PDF-1.5\n1 0 obj\n<<\n/Title ()/Creator ()/Producer (Qt 4.5.0 (C) 1992-2009 Nokia Corporation and/or its subsidiary(-ies))/CreationDate (D:20090424120829)\n>>\nendobj\n");
 Document::Document(const char * fileName):
-    _root(0), _pages(), _documentName(fileName), _maxObjectNumber(0)
+    _root(0), _pages(), _documentName(fileName), _maxObjectNumber(0), _parser(0)
 {
 
 }
@@ -60,6 +59,7 @@ Document::~Document()
       delete (*it).second;
    }
    _pages.clear();
+   delete _parser;
 }
 
 
@@ -74,20 +74,22 @@ Page * Document::getPage(unsigned int pageNumber)
          << _documentName;
       throw Exception(error);*/
    }
+   if(_parser)
+      _parser->loadPage(_pages[pageNumber]);
    return  _pages[pageNumber];
 }
 
-void Document::saveAs(const char * newFileName)
+void Document::saveAs(const char * newFileName, bool compressStreams)
 {
    //first two objects will be created by hand
    unsigned int fromObjNumber = 2;
    _root->recalculateObjectNumbers(fromObjNumber);
    _root->retrieveMaxObjectNumber(_maxObjectNumber);
    
-   //sizes of all objects
+   //offsets of all objects
    //key - object number
-   //value - size of object
-   std :: map < unsigned int, std::pair<unsigned long long, unsigned int > > sizesAndGenerationNumbers;
+   //value - offset in the file and generation number
+   std :: map < unsigned int, std::pair<unsigned long long, unsigned int > > offsetsAndGenerationNumbers;
    std::ofstream out;
    out.open(newFileName, std::ios::binary);
    if(!out.is_open())
@@ -98,33 +100,62 @@ void Document::saveAs(const char * newFileName)
    }
 
    out << firstObj.c_str();
-   _root->serialize( out, sizesAndGenerationNumbers);
+   offsetsAndGenerationNumbers[1] = std::make_pair((unsigned long long)firstObj.find("1 0 obj"), 0u);
+   //objects are written one by one as the graph is walked, only the
+   //stream being written is held in memory
+   _root->serialize( out, offsetsAndGenerationNumbers, compressStreams);
    
-   std::map< unsigned int, std::pair<unsigned long long, unsigned int > >::iterator sizeIterator;
-
-   unsigned int numberOfObjects = 2;
-   for ( sizeIterator = sizesAndGenerationNumbers.begin() ; sizeIterator != sizesAndGenerationNumbers.end(); sizeIterator++ )
-   {
-      numberOfObjects++;
-   }
-   
-   //create xref
-   out << "xref\n"
-      << "0 " << numberOfObjects  << "\n"
-      << "0000000000 65535 f \n"
-      << "0000000009 00000 n \n";
-
-
-   unsigned long long sizeInXref = firstObj.size();
-
-   for ( sizeIterator = sizesAndGenerationNumbers.begin() ; sizeIterator != sizesAndGenerationNumbers.end(); sizeIterator++ )
+   //the xref is written as a compressed xref stream, which needs PDF 1.5
+   unsigned long long startOfXref = out.tellp();
+   unsigned int xrefObjectNumber = offsetsAndGenerationNumbers.rbegin()->first + 1;
+   offsetsAndGenerationNumbers[xrefObjectNumber] = std::make_pair(startOfXref, 0u);
+
+   //type (1 byte), offset (as few bytes as needed), generation (2 bytes)
+   unsigned int offsetWidth = 1;
+   while(offsetWidth < 8 && (startOfXref >> (8 * offsetWidth)))
+      ++offsetWidth;
+   const unsigned int rowSize = 1 + offsetWidth + 2;
+
+   //rows are PNG "Up" predicted, each starts with the predictor byte
+   std::string xref;
+   xref.reserve((rowSize + 1) * (xrefObjectNumber + 1));
+   //kept to write the xref unfiltered if it cannot be compressed
+   std::string plainXref;
+   plainXref.reserve(rowSize * (xrefObjectNumber + 1));
+   std::string previousRow(rowSize, '\0');
+   std::string row(rowSize, '\0');
+   for(unsigned int objectNumber = 0; objectNumber <= xrefObjectNumber; ++objectNumber)
    {
-      out << std::setfill('0')<<std::setw(10)<<sizeInXref << " " << std::setw(5) << (*sizeIterator).second.second << " n \n";
-      sizeInXref = sizeInXref + (*sizeIterator).second.first;
+      std::map< unsigned int, std::pair<unsigned long long, unsigned int > >::iterator entry = offsetsAndGenerationNumbers.find(objectNumber);
+      bool isUsed = entry != offsetsAndGenerationNumbers.end();
+      unsigned long long offset = isUsed ? (*entry).second.first : 0;
+      unsigned int generationNumber = isUsed ? (*entry).second.second : (objectNumber == 0 ? 65535 : 0);
+
+      row[0] = isUsed ? 1 : 0;
+      for(unsigned int i = 0; i < offsetWidth; ++i)
+         row[offsetWidth - i] = (char)((offset >> (8 * i)) & 0xFF);
+      row[rowSize - 2] = (char)((generationNumber >> 8) & 0xFF);
+      row[rowSize - 1] = (char)(generationNumber & 0xFF);
+
+      xref += (char)2;
+      for(unsigned int i = 0; i < rowSize; ++i)
+         xref += (char)(row[i] - previousRow[i]);
+      plainXref += row;
+      previousRow = row;
    }
-   out << "trailer\n<<\n/Size " << numberOfObjects  << "\n/Info 1 0 R\n"
-      << "/Root " << _root->getObjectNumber() << " 0 R\n >>\nstartxref\n" << sizeInXref << "\n%%EOF";
-
+   FlateDecode flate;
+   bool compressed = flate.encode(xref);
+   if(!compressed)
+      xref.swap(plainXref);
+
+   out << xrefObjectNumber << " 0 obj\n"
+      << "<<\n/Type /XRef\n/Size " << xrefObjectNumber + 1 << "\n/W [1 " << offsetWidth << " 2]\n/Info 1 0 R\n"
+      << "/Root " << _root->getObjectNumber() << " 0 R\n";
+   if(compressed)
+      out << "/Filter /FlateDecode\n/DecodeParms << /Columns " << rowSize << " /Predictor 12 >>\n";
+   out << "/Length " << xref.size() << "\n>>\nstream\n";
+   out.write(xref.data(), xref.size());
+   out << "\nendstream\nendobj\nstartxref\n" << startOfXref << "\n%%EOF";
 }
 
 Object * Document::getDocumentObject()
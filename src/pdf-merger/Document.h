@@ -35,6 +35,8 @@
 
 namespace merge_lib
 {
+   class Parser;
+
    //this class contains all info about pdf document
    class Document
    {
@@ -50,7 +52,8 @@ namespace merge_lib
       Page *   getPage(unsigned int pageNumber);
       
       //save document with newFileName file name
-      void     saveAs(const char * newFileName);   
+      //compressStreams - flate encode the streams stored without filter
+      void     saveAs(const char * newFileName, bool compressStreams = true);   
 
       //get root of all document objects
       Object * getDocumentObject();
@@ -83,6 +86,9 @@ namespace merge_lib
       //max number of all document's objects
       unsigned int _maxObjectNumber;
 
+      //parser of a document whose pages are parsed on demand, owned
+      Parser * _parser;
+
    };
 }
 #endif
@@ -39,8 +39,6 @@
 
 using namespace merge_lib;
 
-Parser Merger::_parser;
-
 Merger::Merger():_baseDocuments(),_overlayDocument(0)
 {
 
@@ -68,7 +66,18 @@ void Merger::addBaseDocument(const char * docName)
    //if docName has been already opened then do nothing
    if(_baseDocuments.count(docName))
       return;
-   Document * newBaseDoc = _parser.parseDocument(docName);
+   //the pages of a base document are parsed when they are merged
+   Parser * parser = new Parser(true);
+   Document * newBaseDoc = 0;
+   try
+   {
+      newBaseDoc = parser->parseDocument(docName);
+   }
+   catch(std::exception &)
+   {
+      delete parser;
+      throw;
+   }
    _baseDocuments.insert(std::pair<std::string, Document *>(docName, newBaseDoc));
 }
 
@@ -133,8 +142,8 @@ void Merger::merge(const char * overlayDocName, const MergeDescription & pagesTo
 
 }
 // Method performs saving of merged documents into selected file
-void Merger::saveMergedDocumentsAs(const char * outDocumentName)
+void Merger::saveMergedDocumentsAs(const char * outDocumentName, bool compressStreams)
 {
-   _overlayDocument->saveAs(outDocumentName);
+   _overlayDocument->saveAs(outDocumentName, compressStreams);
 }
 
@@ -52,13 +52,12 @@ namespace merge_lib
 
       void addOverlayDocument(const char *docName);
 
-      void saveMergedDocumentsAs(const char *outDocumentName);
+      void saveMergedDocumentsAs(const char *outDocumentName, bool compressStreams = true);
 
       void merge(const char *overlayDocName, const MergeDescription & pagesToMerge);
 
    private:
       std::map<std::string, Document * > _baseDocuments;
-      static Parser _parser;
       Document * _overlayDocument;
    };
 }
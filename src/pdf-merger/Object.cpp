@@ -30,6 +30,7 @@
 #include "Object.h"
 #include "Parser.h"
 #include "Exception.h"
+#include "FlateDecode.h"
 #include <string.h>
 #include <algorithm>
 #include <fstream>
@@ -48,10 +49,10 @@ Object::~Object()
    _content.clear();
 }
 
-Object * Object::getClone(std::vector<Object *> & clones)
+Object * Object::getClone(std::vector<Object *> & clones, const std::set<Object *> & sharedObjects)
 {
    std::map<unsigned int, Object *> clonesMap;
-   Object * clone = _getClone(clonesMap);
+   Object * clone = _getClone(clonesMap, sharedObjects);
    std::map<unsigned int, Object *>::iterator conesIterator = clonesMap.begin();
    for(; conesIterator != clonesMap.end(); ++conesIterator)
       clones.push_back((*conesIterator).second);
@@ -60,7 +61,7 @@ Object * Object::getClone(std::vector<Object *> & clones)
    return clone;
 }
 
-Object * Object::_getClone(std::map<unsigned int, Object *> & clones)
+Object * Object::_getClone(std::map<unsigned int, Object *> & clones, const std::set<Object *> & sharedObjects)
 {
    _isPassed = true;
    unsigned int objectNumber = this->getObjectNumber();   
@@ -76,13 +77,17 @@ Object * Object::_getClone(std::map<unsigned int, Object *> & clones)
 
       Object * cloneOfCurrentChild = 0;
 
-      if(currentObject->isPassed())
+      if(sharedObjects.count(currentObject))
+      {
+         cloneOfCurrentChild = currentObject;
+      }
+      else if(currentObject->isPassed())
       {
          cloneOfCurrentChild = clones[childObjectNumber];
       }
       else
       {
-         cloneOfCurrentChild = currentObject->_getClone(clones);
+         cloneOfCurrentChild = currentObject->_getClone(clones, sharedObjects);
       }
       ChildAndItPositionInContent newChild(
          cloneOfCurrentChild, 
@@ -262,32 +267,28 @@ void Object::insertToContent(unsigned int position, const char * insertedStr, un
 }
 
 //vector <object number, its size>
-void Object::serialize(std::ofstream & out, std::map< unsigned int, std::pair<unsigned long long, unsigned int > > & sizesAndGenerationNumbers)
+void Object::serialize(std::ofstream & out, std::map< unsigned int, std::pair<unsigned long long, unsigned int > > & offsetsAndGenerationNumbers, bool compressStreams)
 {
-   //is this element already printed
-   if(sizesAndGenerationNumbers.find(_number) != sizesAndGenerationNumbers.end()) return;
-
-   std::string stream;
-   if(_hasStream && !_hasStreamInContent)
-   {       
-      getStream(stream);
-      stream.append("endstream\n");       
-   }
-   // xxxx + " " + "0" + " " + "obj" + "\n" + _content.size() + "endobj\n", where x - is a digit
-   unsigned long long objectSizeForXref = (static_cast<unsigned int>(std::log10(static_cast<double>(_number))) + 1) + 14 + _content.size() + stream.size();    
+   //depth first without recursion, the object graph of a big document
+   //is too deep for the call stack
+   std::vector<Object *> objectsToWrite(1, this);
+   while(!objectsToWrite.empty())
+   {
+      Object * currentObject = objectsToWrite.back();
+      objectsToWrite.pop_back();
 
-   sizesAndGenerationNumbers.insert(std::pair<unsigned int, std::pair<unsigned long long, unsigned int > >(_number, std::make_pair(objectSizeForXref, _generationNumber)));
+      //is this element already printed
+      if(offsetsAndGenerationNumbers.find(currentObject->_number) != offsetsAndGenerationNumbers.end())
+         continue;
 
-   _serialize(out, stream);
-   stream.clear();
-   stream.reserve();
+      offsetsAndGenerationNumbers.insert(std::pair<unsigned int, std::pair<unsigned long long, unsigned int > >(currentObject->_number, 
+         std::make_pair(static_cast<unsigned long long>(out.tellp()), currentObject->_generationNumber)));
+      currentObject->_serialize(out, compressStreams);
 
-   //call serialize of each child
-   Children::iterator it;
-   for ( it=_children.begin() ; it != _children.end(); it++ )
-   {
-      Object * currentChild = (*it).second.first;
-      currentChild->serialize(out, sizesAndGenerationNumbers);
+      //reversed, so children are still written in the order they are stored
+      Children::reverse_iterator it;
+      for ( it = currentObject->_children.rbegin() ; it != currentObject->_children.rend(); it++ )
+         objectsToWrite.push_back((*it).second.first);
    }
 }
 void Object::recalculateObjectNumbers(unsigned int & newNumber)
@@ -429,10 +430,62 @@ void Object::_addParent(Object * child)
 {
    _parents.insert(child);
 }
-void Object::_serialize(std::ofstream  & out, const std::string & stream)
+void Object::_serialize(std::ofstream  & out, bool compressStreams)
 {
-    out << _number << " " << _generationNumber << " obj\n" << _content << stream << "endobj\n";
-   out.flush();
+   out << _number << " " << _generationNumber << " obj\n";
+   if(_hasStream && !_hasStreamInContent)
+   {
+      //the stream is read from the source file only while it is written
+      std::string stream;
+      getStream(stream);
+      std::string header;
+      if(compressStreams && _compressStream(header, stream))
+         out << header << "stream\n" << stream << "\nendstream\n";
+      else
+         out << _content << stream << "endstream\n";
+   }
+   else
+   {
+      out << _content;
+   }
+   out << "endobj\n";
+}
+
+//compress a stream stored without any filter
+//header receives the dictionary with the new /Filter and /Length
+bool Object::_compressStream(std::string & header, std::string & stream)
+{
+   getHeader(header);
+   if((int)Parser::findTokenName(header, "/Filter") != -1 || (int)Parser::findToken(header, "/Metadata") != -1)
+      return false;
+
+   std::string lengthToken("/Length");
+   size_t startOfLength = Parser::findTokenName(header, lengthToken);
+   if((int)startOfLength == -1)
+      return false;
+   size_t startOfNumber = header.find_first_not_of(Parser::WHITESPACES, startOfLength + lengthToken.size());
+   if((int)startOfNumber == -1)
+      return false;
+   size_t endOfNumber = header.find_first_not_of(Parser::NUMBERS, startOfNumber);
+   if((int)endOfNumber == -1 || endOfNumber == startOfNumber)
+      return false;
+   //indirect length like "/Length 12 0 R" cannot be rewritten here
+   size_t nextToken = header.find_first_not_of(Parser::WHITESPACES, endOfNumber);
+   if((int)nextToken != -1 && (int)Parser::NUMBERS.find(header[nextToken]) != -1)
+      return false;
+
+   unsigned int length = Utils::stringToInt(header.substr(startOfNumber, endOfNumber - startOfNumber));
+   if(length > stream.size())
+      return false;
+   std::string compressed = stream.substr(0, length);
+   FlateDecode flate;
+   if(!flate.encode(compressed) || compressed.size() >= length)
+      return false;
+
+   header.replace(startOfNumber, endOfNumber - startOfNumber, Utils::uIntToStr(compressed.size()));
+   header.insert(startOfLength, "/Filter /FlateDecode ");
+   stream.swap(compressed);
+   return true;
 }
 
 /** @brief getStream
@@ -67,7 +67,8 @@ namespace merge_lib
        {
        }
        virtual ~Object();
-       Object *                    getClone(std::vector<Object *> & clones);
+       //sharedObjects are referenced by the clone instead of being cloned
+       Object *                    getClone(std::vector<Object *> & clones, const std::set<Object *> & sharedObjects = std::set<Object *>());
        void                        addChild(Object * child, const std::vector<unsigned int> childPositionsInContent);
        void                        addChild(const Children & children);
        ReferencePositionsInContent removeChild(Object * child);
@@ -93,8 +94,8 @@ namespace merge_lib
        void                        insertToContent(unsigned int position, const char * insertedStr, unsigned int length);
        void                        insertToContent(unsigned int position, const std::string & insertedStr);   
 
-       //vector <object number, its size>
-       void serialize(std::ofstream & out, std::map< unsigned int, std::pair<unsigned long long, unsigned int > > & sizesAndGenerationNumbers);
+       //map <object number, <its offset in out, generation number>>
+       void serialize(std::ofstream & out, std::map< unsigned int, std::pair<unsigned long long, unsigned int > > & offsetsAndGenerationNumbers, bool compressStreams);
 
        void recalculateObjectNumbers(unsigned int & newNumber);
 
@@ -147,12 +148,13 @@ namespace merge_lib
     private:
        //methods
        Object(const Object & copy);
-       Object * _getClone(std::map<unsigned int, Object *> & clones);
+       Object * _getClone(std::map<unsigned int, Object *> & clones, const std::set<Object *> & sharedObjects);
        void _addChild(Object * child, const ReferencePositionsInContent & childPositionsInContent);
        void _setObjectNumber(unsigned int objectNumber);       
        void _addParent(Object * child);
        bool _findObject(const std::string & token, Object* & foundObject, unsigned int & tokenPositionInContent);
-       void _serialize(std::ofstream  & out, const std::string & stream);
+       void _serialize(std::ofstream  & out, bool compressStreams);
+       bool _compressStream(std::string & header, std::string & stream);
        void _recalculateObjectNumbers(unsigned int & maxNumber);
        void _recalculateReferencePositions(unsigned int changedReference, int displacement);
        void _retrieveMaxObjectNumber(unsigned int & maxNumber);
@@ -136,9 +136,10 @@ void OverlayDocumentParser::_getPartOfFileContent(long startOfPart, unsigned int
    else 
       dir = ios_base::end;
    pdfFile.seekg (startOfPart, dir);
-   _fileContent.resize(length);
-   pdfFile.read(&_fileContent[0], length);
+   _filePart.resize(length);
+   pdfFile.read(&_filePart[0], length);
    pdfFile.close();
+   _fileContent = ContentView(_filePart.data(), _filePart.size());
 }
 
 void OverlayDocumentParser::_readXref(std::map<unsigned int, unsigned long> & objectsAndSizes)
@@ -45,7 +45,7 @@ namespace merge_lib
    class OverlayDocumentParser: private Parser
    {
    public:   
-      OverlayDocumentParser(): Parser(), _fileName()  {};
+      OverlayDocumentParser(): Parser(), _fileName(), _filePart()  {};
       Document * parseDocument(const char * fileName);
 
    protected:
@@ -63,6 +63,8 @@ namespace merge_lib
 
       //members
       std::string _fileName;
+      //part of the file read last, _fileContent views it
+      std::string _filePart;
    };
 }
 #endif
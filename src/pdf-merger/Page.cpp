@@ -82,7 +82,29 @@ void Page::recalculateObjectNumbers(unsigned int & newNumber)
 
 Object * Page::pageToXObject(std::vector<Object *> & allObjects, std::vector<Object *> & annots, bool isCloneNeeded)
 {
-   Object * xObject = (isCloneNeeded) ? _root->getClone(allObjects) : _root;
+   Object * xObject = _root;
+   if(!isCloneNeeded)
+      return _pageToXObject(xObject, annots);
+
+   //the merge does not modify the resources, the clones of a page share
+   //them; the parent is removed from the XObject, so the page tree is
+   //not copied along with it either
+   std::set<Object *> sharedObjects;
+   const char * sharedEntries[] = {"/Resources", "/Parent"};
+   std::string & content = _root->getObjectContent();
+   for(size_t i = 0; i < sizeof(sharedEntries) / sizeof(sharedEntries[0]); ++i)
+   {
+      std::string entry(sharedEntries[i]);
+      size_t startOfEntry = Parser::findTokenName(content, entry);
+      if((int)startOfEntry == -1)
+         continue;
+      size_t endOfEntry = Parser::findEndOfElementContent(content, startOfEntry + entry.size());
+      if((int)endOfEntry == -1)
+         continue;
+      std::vector<Object *> children = _root->getChildrenByBounds(startOfEntry, endOfEntry);
+      sharedObjects.insert(children.begin(), children.end());
+   }
+   xObject = _root->getClone(allObjects, sharedObjects);
    return _pageToXObject(xObject, annots);
 }
 
@@ -28,15 +28,20 @@
 
 
 #include <QtGlobal>
+#include <QFile>
+#include <QString>
 #include <fstream>
 #include <iostream>
 #include <vector>
 #include <map>
 #include <stack>
+#include <set>
+#include <algorithm>
 #include <string.h>
 #include "Parser.h"
 #include "Object.h"
 #include "Exception.h"
+#include "Filter.h"
 #include "Utils.h"
 
 #include "core/memcheck.h"
@@ -49,6 +54,10 @@ const std::string Parser::DELIMETERS("()<>{}/%][");
 const std::string Parser::NUMBERS("0123456789");
 const std::string Parser::WHITESPACES_AND_DELIMETERS = Parser::WHITESPACES + Parser::DELIMETERS;
 
+//the tokenizer works on std::string and on the mapped file content
+template<class Content> static std::string getNextTokenIn(const Content &str, unsigned int &position);
+template<class Content> static size_t findTokenIn(const Content &content, const std::string &keyword, size_t start);
+
 Document * Parser::parseDocument(const char * fileName)
 {
    _document = new Document(fileName);
@@ -64,9 +73,47 @@ Document * Parser::parseDocument(const char * fileName)
       _document = NULL;
       throw;
    }
+   if(_pagesOnDemand)
+      _document->_parser = this;
    return _document;
 }
 
+Parser::~Parser()
+{
+   _clearParser();
+}
+
+// links everything the page references, except the kids of the page tree
+// nodes (reached through /Parent), so the other pages are not parsed
+void Parser::loadPage(Page * page)
+{
+   std::vector<Object *> objectsToLoad(1, page->_root);
+   while(!objectsToLoad.empty())
+   {
+      Object * currentObject = objectsToLoad.back();
+      objectsToLoad.pop_back();
+      if(!_loadedObjects.insert(currentObject).second)
+         continue;
+      _linkObject(currentObject);
+      std::vector<Object *> kids;
+      if(_pageTreeNodes.count(currentObject))
+      {
+         std::string & objectContent = currentObject->getObjectContent();
+         unsigned int startOfKids = objectContent.find("/Kids");
+         if((int)startOfKids != -1)
+            kids = currentObject->getChildrenByBounds(startOfKids, objectContent.find("]", startOfKids));
+      }
+      const Object::Children & children = currentObject->getChildren();
+      Object::Children::const_iterator childrenIterator = children.begin();
+      for(; childrenIterator != children.end(); ++childrenIterator)
+      {
+         Object * child = (*childrenIterator).second.first;
+         if(std::find(kids.begin(), kids.end(), child) == kids.end())
+            objectsToLoad.push_back(child);
+      }
+   }
+}
+
 void Parser::_retrieveAllPages(Object * objectWithKids)
 {
    std::string & objectContent = objectWithKids->getObjectContent();
@@ -84,6 +131,8 @@ void Parser::_retrieveAllPages(Object * objectWithKids)
       return;
    }
 
+   _linkObject(objectWithKids);
+   _pageTreeNodes.insert(objectWithKids);
    const std::vector<Object *> & kids = objectWithKids->getSortedByPositionChildren(startOfKids, endOfKids);
    for(size_t i(0); i < kids.size(); ++i)
    {
@@ -106,43 +155,56 @@ void Parser::_createDocument(const char * docName)
    _retrieveAllPages(objectWithKids[0]);
 
    _root->retrieveMaxObjectNumber(_document->_maxObjectNumber);
-   _clearParser();
+   if(!_pagesOnDemand)
+      _clearParser();
 }
 
 void Parser::_clearParser()
 {
    _root = 0;
-   _fileContent.clear();
-   _fileContent.reserve();
+   _fileContent = ContentView();
+   //closing the file unmaps it
+   delete _file;
+   _file = 0;
    _objects.clear();
+   _objectPositions.clear();
+   _compressedObjects.clear();
+   _objectStreams.clear();
+   _trailerDictionary.clear();
+   _linkedObjects.clear();
+   _pageTreeNodes.clear();
+   _loadedObjects.clear();
 }
 
 
 void Parser::_getFileContent(const char * fileName)
 {
-   ifstream pdfFile;
-   pdfFile.open (fileName, ios::binary );
-   if (pdfFile.fail())
+   _file = new QFile(QString::fromLocal8Bit(fileName));
+   if (!_file->open(QIODevice::ReadOnly))
    {
       stringstream errorMessage("File ");
       errorMessage << fileName << " is absent" << "\0";
       throw Exception(errorMessage);
    }
-   // get length of file:
-   pdfFile.seekg (0, ios::end);
-   int length = pdfFile.tellg();
-   pdfFile.seekg (0, ios::beg);
-   _fileContent.resize(length);
-   pdfFile.read(&_fileContent[0], length);
+   // the file is parsed in place from its mapping, only the content of the
+   // objects that are used is copied
+   qint64 length = _file->size();
+   const char * data = length > 0 ? reinterpret_cast<const char *>(_file->map(0, length)) : 0;
+   if (!data)
+   {
+      stringstream errorMessage("File ");
+      errorMessage << fileName << " cannot be read" << "\0";
+      throw Exception(errorMessage);
+   }
+   _fileContent = ContentView(data, length);
 
    // check version
    const char *header = "%PDF-1.";
-   size_t verPos = _fileContent.find(header);
-   if( verPos == 0 )
+   size_t headerLength = strlen(header);
+   if( (size_t)length > headerLength && _fileContent.compare(0, headerLength, header) == 0 )
    {
-      verPos += strlen(header);
-      char ver = _fileContent[verPos];
-      if( ver < '0' || ver > '4' )
+      char ver = _fileContent[headerLength];
+      if( ver < '0' || ver > '7' )
       {
          stringstream errorMsg;
          errorMsg<<" File with verion 1."<<ver<<" is not currently supported by merge library\n";
@@ -153,7 +215,6 @@ void Parser::_getFileContent(const char * fileName)
    {
       throw Exception("Unrecognized header of PDF file");
    }
-   pdfFile.close();
 }
 
 
@@ -165,11 +226,15 @@ void Parser::_createObjectTree(const char * fileName)
       _getFileContent(fileName);
       _readXRefAndCreateObjects();
       rootObjectNumber = _readTrailerAndReturnRoot();
+      _root = _materializeObject(rootObjectNumber);
+      if(!_root)
+         throw Exception("Some document is wrong");
    }
    catch (std::exception &)
    {
+      //with pagesOnDemand the document already owns them
       std::map<unsigned int, Object *>::const_iterator it(_objects.begin());
-      for(;it != _objects.end();it++)
+      for(;it != _objects.end() && !_pagesOnDemand;it++)
       {
          delete (*it).second;
       }
@@ -177,24 +242,107 @@ void Parser::_createObjectTree(const char * fileName)
       throw;
    }
 
-   std::map<unsigned int, Object *>::iterator objectsIterator;
+   // the rest of the page tree is linked by _retrieveAllPages, the pages
+   // by loadPage()
+   if(_pagesOnDemand)
+   {
+      _linkObject(_root);
+      return;
+   }
 
-   for ( objectsIterator = _objects.begin() ; objectsIterator != _objects.end(); objectsIterator++ )
+   // only the objects reachable from the root are parsed and linked, the
+   // rest of the file (unused or superseded objects) is never copied
+   std::vector<Object *> objectsToLink(1, _root);
+   while(!objectsToLink.empty())
    {
-      Object * currentObject = (*objectsIterator).second;
+      Object * currentObject = objectsToLink.back();
+      objectsToLink.pop_back();
+      if(!_linkObject(currentObject))
+         continue;
       _document->_allObjects.push_back(currentObject);
-      //key - object number :  value - positions in object content of this reference
-      const std::map<unsigned int, Object::ReferencePositionsInContent> & refs = 
-         _getReferences(currentObject->getObjectContent());      
-      std::map<unsigned int, Object::ReferencePositionsInContent>::const_iterator refsIterator = refs.begin();
-      for(; refsIterator !=  refs.end(); ++refsIterator)
-      {        
-         if(_objects.count((*refsIterator).first))
-            currentObject->addChild(_objects[(*refsIterator).first], (*refsIterator).second);        
-      }
+      const Object::Children & children = currentObject->getChildren();
+      Object::Children::const_iterator childrenIterator = children.begin();
+      for(; childrenIterator != children.end(); ++childrenIterator)
+         objectsToLink.push_back((*childrenIterator).second.first);
    }   
-   _root = _objects[rootObjectNumber];
 
+   // objects created up front by a derived parser but not referenced
+   // from the document are not owned by anyone
+   std::map<unsigned int, Object *>::iterator objectsIterator;
+   for ( objectsIterator = _objects.begin() ; objectsIterator != _objects.end(); objectsIterator++ )
+   {
+      if(!_linkedObjects.count((*objectsIterator).second))
+         delete (*objectsIterator).second;
+   }
+}
+
+bool Parser::_linkObject(Object * object)
+{
+   if(!_linkedObjects.insert(object).second)
+      return false;
+   //key - object number :  value - positions in object content of this reference
+   const std::map<unsigned int, Object::ReferencePositionsInContent> & refs = 
+      _getReferences(object->getObjectContent());      
+   std::map<unsigned int, Object::ReferencePositionsInContent>::const_iterator refsIterator = refs.begin();
+   for(; refsIterator !=  refs.end(); ++refsIterator)
+   {        
+      Object * child = _materializeObject((*refsIterator).first);
+      if(child)
+         object->addChild(child, (*refsIterator).second);        
+   }
+   return true;
+}
+
+Object * Parser::_materializeObject(unsigned int objectNumber)
+{
+   std::map<unsigned int, Object *>::iterator objectIterator = _objects.find(objectNumber);
+   if(objectIterator != _objects.end())
+      return (*objectIterator).second;
+
+   std::map<unsigned int, unsigned long>::iterator positionIterator = _objectPositions.find(objectNumber);
+   if(positionIterator == _objectPositions.end())
+   {
+      std::map<unsigned int, std::pair<unsigned int, unsigned int> >::iterator compressed = _compressedObjects.find(objectNumber);
+      if(compressed == _compressedObjects.end())
+         return 0;
+      std::pair<unsigned int, unsigned int> location = (*compressed).second;
+      _compressedObjects.erase(compressed);
+      try
+      {
+         //objects inside an object stream never have a stream of their own
+         const std::string & content = _getCompressedObjectContent(location.first, location.second);
+         Object * newObject = new Object(objectNumber, 0, content, _document->_documentName);
+         _objects[objectNumber] = newObject;
+         if(_pagesOnDemand)
+            _document->_allObjects.push_back(newObject);
+         return newObject;
+      }
+      catch(std::exception &)
+      {
+      }
+      return 0;
+   }
+   unsigned long position = (*positionIterator).second;
+   _objectPositions.erase(positionIterator);
+
+   try
+   {
+      std::pair<unsigned int, unsigned int> streamBounds;
+      bool hasObjectStream;
+      unsigned int number;
+      unsigned int generationNumber;
+      const std::string & content = _getObjectContent(position, number, generationNumber, streamBounds, hasObjectStream);
+      Object * newObject = new Object(number, generationNumber, content, _document->_documentName ,streamBounds, hasObjectStream);
+      _objects[objectNumber] = newObject;
+      //objects parsed on demand are not all reachable from the root
+      if(_pagesOnDemand)
+         _document->_allObjects.push_back(newObject);
+      return newObject;
+   }
+   catch(std::exception &)
+   {
+   }
+   return 0;
 }
 
 const std::map<unsigned int, Object::ReferencePositionsInContent> & Parser::_getReferences(const std::string & objectContent)
@@ -281,80 +429,257 @@ unsigned int Parser::_skipNumber(const std::string & str, unsigned int currentPo
 void Parser::_readXRefAndCreateObjects()
 {      
    unsigned int currentPostion = _getStartOfXrefWithRoot();
-   do
+   std::set<unsigned int> readSections;
+   while(readSections.insert(currentPostion).second)
    {
-      const std::string & currentToken = _getNextToken(currentPostion);
-      if(currentToken != "xref")
+      bool isNewestSection = readSections.size() == 1;
+      unsigned int tokenPosition = currentPostion;
+      if(_getNextToken(tokenPosition) != "xref")
       {
-         throw Exception("Wrong xref in some document");
+         //PDF 1.5 cross-reference stream, its dictionary is the trailer
+         std::string dictionary;
+         _readXRefStream(currentPostion, dictionary);
+         if(isNewestSection)
+            _trailerDictionary = dictionary;
+         if(!_getDictionaryNumber(dictionary, "/Prev", currentPostion))
+            break;
+         continue;
       }
-      unsigned int endOfLine = _getEndOfLineFromContent(currentPostion );
-      if(_countTokens(currentPostion, endOfLine) != 2)
-      {
-         throw Exception("Wrong xref in some document");
+      _readXRefTable(currentPostion);
 
+      //hybrid files list their compressed objects in an additional xref stream
+      unsigned int startOfTrailer = findTokenIn(_fileContent, "trailer", currentPostion);
+      if((int)startOfTrailer != -1)
+      {
+         unsigned int endOfTrailer = _fileContent.find("startxref", startOfTrailer);
+         std::string trailerDictionary = _fileContent.substr(startOfTrailer, endOfTrailer - startOfTrailer);
+         unsigned int xrefStreamPosition;
+         if(_getDictionaryNumber(trailerDictionary, "/XRefStm", xrefStreamPosition) && readSections.insert(xrefStreamPosition).second)
+         {
+            std::string dictionary;
+            _readXRefStream(xrefStreamPosition, dictionary);
+         }
       }
-      //now we are reading the xref
-      while(1)
+      if(!_readTrailerAndRterievePrev(currentPostion, currentPostion))
+         break;
+   }
+}
+
+void Parser::_readXRefTable(unsigned int & currentPostion)
+{
+   const std::string & currentToken = _getNextToken(currentPostion);
+   if(currentToken != "xref")
+   {
+      throw Exception("Wrong xref in some document");
+   }
+   unsigned int endOfLine = _getEndOfLineFromContent(currentPostion );
+   if(_countTokens(currentPostion, endOfLine) != 2)
+   {
+      throw Exception("Wrong xref in some document");
+
+   }
+   //now we are reading the xref
+   while(1)
+   {
+      unsigned int firstObjectNumber = Utils::stringToInt(_getNextToken(currentPostion));
+      unsigned int objectCount = Utils::stringToInt(_getNextToken(currentPostion));
+      for(unsigned int i(0); i < objectCount; i++)
       {
-         Utils::stringToInt(_getNextToken(currentPostion));
-         unsigned int objectCount = Utils::stringToInt(_getNextToken(currentPostion));
-         for(unsigned int i(0); i < objectCount; i++)
+         unsigned long  first;
+
+         if(_countTokens(currentPostion, _getEndOfLineFromContent(currentPostion)) == 3)
+         {
+            first  = Utils::stringToInt(_getNextToken(currentPostion));
+            Utils::stringToInt(_getNextToken(currentPostion));
+            const string & use         = _getNextToken(currentPostion);
+            //objects are parsed on demand by _materializeObject, the newest
+            //xref section is read first so it wins over the older ones
+            if(!use.compare("n") && !_isObjectListed(firstObjectNumber + i))
+               _objectPositions[firstObjectNumber + i] = first;
+         }
+         else
          {
-            unsigned long  first;
+            ;
+         }
+         ++currentPostion;
 
-            if(_countTokens(currentPostion, _getEndOfLineFromContent(currentPostion)) == 3)
-            {
-               first  = Utils::stringToInt(_getNextToken(currentPostion));
-               Utils::stringToInt(_getNextToken(currentPostion));
-               const string & use         = _getNextToken(currentPostion);
-               if(!use.compare("n"))
-               {
-                  unsigned int objectNumber;
 
-                  try               
-                  {
-                     std::pair<unsigned int, unsigned int> streamBounds;
-                     bool hasObjectStream;
-                     unsigned int generationNumber;
-                     const std::string content = _getObjectContent(first, objectNumber, generationNumber, streamBounds, hasObjectStream);
-                     if(!_objects.count(objectNumber))
-                     {
-                        Object * newObject = new Object(objectNumber, generationNumber, content, _document->_documentName ,streamBounds, hasObjectStream);
-                        _objects[objectNumber] = newObject;
-                     }
-                  }
-                  catch(std::exception &)
-                  {
-                  }
+      }
+      unsigned int previosPostion = currentPostion;
+      const std::string & isTrailer = _getNextToken(currentPostion);
 
-               }
-            }
-            else
-            {
-               ;
-            }
-            ++currentPostion;
+      std::string trailer("trailer");
+      if(isTrailer == trailer)
+      {
+         currentPostion -= trailer.size();
+         break;
+      }
+      else
+         currentPostion = previosPostion;
 
+   }
+}
 
-         }
-         unsigned int previosPostion = currentPostion;
-         const std::string & isTrailer = _getNextToken(currentPostion);
+void Parser::_readXRefStream(unsigned int position, std::string & dictionary)
+{
+   std::string entries;
+   _getDecodedStream(position, dictionary, entries);
+   if((int)Parser::findToken(dictionary, "/XRef") == -1)
+   {
+      throw Exception("Wrong xref stream in some document");
+   }
 
-         std::string trailer("trailer");
-         if(isTrailer == trailer)
+   std::vector<unsigned int> widths = _getDictionaryArray(dictionary, "/W");
+   if(widths.size() != 3)
+   {
+      throw Exception("Wrong xref stream in some document");
+   }
+   unsigned int entrySize = widths[0] + widths[1] + widths[2];
+
+   //without /Index the stream describes objects 0 .. /Size - 1
+   std::vector<unsigned int> subsections = _getDictionaryArray(dictionary, "/Index");
+   if(subsections.empty())
+   {
+      unsigned int size = 0;
+      _getDictionaryNumber(dictionary, "/Size", size);
+      subsections.push_back(0);
+      subsections.push_back(size);
+   }
+
+   const unsigned char * entry = reinterpret_cast<const unsigned char *>(entries.data());
+   const unsigned char * endOfEntries = entry + entries.size();
+   for(size_t subsection = 0; subsection + 1 < subsections.size(); subsection += 2)
+   {
+      unsigned int objectNumber = subsections[subsection];
+      for(unsigned int i = 0; i < subsections[subsection + 1] && entry + entrySize <= endOfEntries; ++i, ++objectNumber)
+      {
+         unsigned long fields[3] = {1, 0, 0};
+         for(int field = 0; field < 3; ++field)
          {
-            currentPostion -= trailer.size();
-            break;
+            if(widths[field] == 0)
+               continue;
+            fields[field] = 0;
+            for(unsigned int byte = 0; byte < widths[field]; ++byte)
+               fields[field] = (fields[field] << 8) | *entry++;
          }
-         else
-            currentPostion = previosPostion;
+         if(_isObjectListed(objectNumber))
+            continue;
+         if(fields[0] == 1)
+            _objectPositions[objectNumber] = fields[1];
+         else if(fields[0] == 2)
+            _compressedObjects[objectNumber] = std::make_pair((unsigned int)fields[1], (unsigned int)fields[2]);
+      }
+   }
+}
+
+void Parser::_getDecodedStream(unsigned int position, std::string & header, std::string & stream)
+{
+   std::pair<unsigned int, unsigned int> streamBounds;
+   bool hasObjectStream;
+   unsigned int objectNumber;
+   unsigned int generationNumber;
+   const std::string & content = _getObjectContent(position, objectNumber, generationNumber, streamBounds, hasObjectStream);
+   if(!hasObjectStream)
+   {
+      std::stringstream errorMessage;
+      errorMessage << "Object " << objectNumber << " has no stream" << "\0";
+      throw Exception(errorMessage);
+   }
+   Object objectWithStream(objectNumber, generationNumber, content, _document->_documentName, streamBounds, hasObjectStream);
+   objectWithStream.getHeader(header);
+   Filter filter(&objectWithStream);
+   filter.getDecodedStream(stream);
+}
 
+const std::string & Parser::_getCompressedObjectContent(unsigned int objectStreamNumber, unsigned int index)
+{
+   std::map<unsigned int, ObjectStream>::iterator found = _objectStreams.find(objectStreamNumber);
+   if(found == _objectStreams.end())
+   {
+      std::map<unsigned int, unsigned long>::iterator position = _objectPositions.find(objectStreamNumber);
+      if(position == _objectPositions.end())
+      {
+         throw Exception("Object stream is absent");
+      }
+      std::string header;
+      std::string data;
+      _getDecodedStream((*position).second, header, data);
+      unsigned int objectCount = 0;
+      unsigned int first = 0;
+      if(!_getDictionaryNumber(header, "/N", objectCount) || !_getDictionaryNumber(header, "/First", first) || first > data.size())
+      {
+         throw Exception("Wrong object stream in some document");
       }
+
+      //the stream starts with /N pairs of object number and offset from /First
+      ObjectStream & objectStream = _objectStreams[objectStreamNumber];
+      std::stringstream offsets(data.substr(0, first));
+      for(unsigned int i = 0; i < objectCount; ++i)
+      {
+         unsigned int number;
+         unsigned int offset;
+         if(!(offsets >> number >> offset))
+            break;
+         objectStream.offsets.push_back(offset);
+      }
+      objectStream.content = data.substr(first);
+      found = _objectStreams.find(objectStreamNumber);
    }
-   while(_readTrailerAndRterievePrev(currentPostion, currentPostion));
 
+   const ObjectStream & objectStream = (*found).second;
+   if(index >= objectStream.offsets.size() || objectStream.offsets[index] > objectStream.content.size())
+   {
+      throw Exception("Wrong object stream in some document");
+   }
+   unsigned int startOfObject = objectStream.offsets[index];
+   unsigned int endOfObject = (index + 1 < objectStream.offsets.size()) ? objectStream.offsets[index + 1] : objectStream.content.size();
+   if(endOfObject < startOfObject || endOfObject > objectStream.content.size())
+      endOfObject = objectStream.content.size();
+
+   static std::string objectContent;
+   //written back as a plain object, so it needs a separator before endobj
+   objectContent = objectStream.content.substr(startOfObject, endOfObject - startOfObject);
+   if(objectContent.empty() || (int)WHITESPACES.find(objectContent[objectContent.size() - 1]) == -1)
+      objectContent += "\n";
+   return objectContent;
+}
+
+bool Parser::_isObjectListed(unsigned int objectNumber) const
+{
+   return _objectPositions.count(objectNumber) || _compressedObjects.count(objectNumber);
+}
+
+bool Parser::_getDictionaryNumber(const std::string & dictionary, const std::string & key, unsigned int & value)
+{
+   size_t position = Parser::findTokenName(dictionary, key);
+   if((int)position == -1)
+      return false;
+   position += key.size();
+   std::string number;
+   if(!Parser::getNextWord(number, dictionary, position))
+      return false;
+   size_t endOfNumber = number.find_first_not_of(NUMBERS);
+   if(endOfNumber == 0)
+      return false;
+   value = Utils::stringToInt(number.substr(0, endOfNumber));
+   return true;
+}
 
+std::vector<unsigned int> Parser::_getDictionaryArray(const std::string & dictionary, const std::string & key)
+{
+   std::vector<unsigned int> result;
+   size_t position = Parser::findTokenName(dictionary, key);
+   if((int)position == -1)
+      return result;
+   size_t startOfArray = dictionary.find('[', position + key.size());
+   size_t endOfArray = dictionary.find(']', startOfArray);
+   if((int)startOfArray == -1 || (int)endOfArray == -1)
+      return result;
+   std::stringstream values(dictionary.substr(startOfArray + 1, endOfArray - startOfArray - 1));
+   unsigned int value;
+   while(values >> value)
+      result.push_back(value);
+   return result;
 }
 
 unsigned int Parser::_getStartOfXrefWithRoot()
@@ -394,13 +719,15 @@ const std::string & Parser::_getNextToken(unsigned int & fromPosition)
 {
    fromPosition = _skipWhiteSpacesFromContent(fromPosition);
    unsigned int position = _fileContent.find_first_of(WHITESPACES, fromPosition);
+   if(position > _fileContent.size())
+      position = _fileContent.size();
 
    static std::string token;
    if(position > fromPosition)
    {        
       unsigned int tokenSize = position - fromPosition;
       token.resize(tokenSize);
-      memcpy(&token[0], &_fileContent[fromPosition], tokenSize);
+      memcpy(&token[0], _fileContent.data() + fromPosition, tokenSize);
       fromPosition = position;
       return token;
    }
@@ -456,7 +783,7 @@ const std::string & Parser::_getObjectContent(unsigned int objectPosition, unsig
    token = _getNextToken(currentPosition);  // generation number - not interesting
    generationNumber = Utils::stringToInt(token);
 
-   token = Parser::getNextToken(_fileContent,currentPosition);
+   token = getNextTokenIn(_fileContent,currentPosition);
 
    if( token != "obj" )
    {
@@ -497,20 +824,22 @@ const std::string & Parser::_getObjectContent(unsigned int objectPosition, unsig
       streamBounds.first = beginOfStream;
 
       // try to use Length field to determine end of stream.
+      // it is searched in the stream dictionary only
+      const std::string dictionary = _fileContent.substr(contentStart, beginOfStream - contentStart);
       std::string lengthToken = "/Length";
-      size_t lengthBegin = Parser::findTokenName(_fileContent,lengthToken,contentStart);
+      size_t lengthBegin = Parser::findTokenName(dictionary,lengthToken);
       if ((int) lengthBegin != -1 )
       {
          std::string lengthStr;
          size_t lenPos = lengthBegin + lengthToken.size();
          bool useContentLength = false;
-         if( Parser::getNextWord(lengthStr,_fileContent,lenPos) )
+         if( Parser::getNextWord(lengthStr,dictionary,lenPos) )
          {
             useContentLength = true;
             std::string refStr;
-            if( Parser::getNextWord(refStr,_fileContent,lenPos))
+            if( Parser::getNextWord(refStr,dictionary,lenPos))
             {
-               if( Parser::getNextWord(refStr,_fileContent,lenPos))
+               if( Parser::getNextWord(refStr,dictionary,lenPos))
                {
                   if( refStr == "R" )
                   {
@@ -540,24 +869,36 @@ const std::string & Parser::_getObjectContent(unsigned int objectPosition, unsig
    }
    unsigned int contentSize = endOfContent - currentPosition;
 
-   objectContent.resize(contentSize);
-   memcpy(&objectContent[0], &_fileContent[currentPosition], contentSize);
+   objectContent.assign(_fileContent.data() + currentPosition, contentSize);
    return objectContent;
 
 }
 
 unsigned int Parser::_readTrailerAndReturnRoot()
 {
+   if(!_trailerDictionary.empty())
+   {
+      if((int) Parser::findTokenName(_trailerDictionary, "/Encrypt") != -1 )
+      {
+         throw Exception("Encrypted PDF is not supported!");
+      }
+      unsigned int rootObjectNumber;
+      if(!_getDictionaryNumber(_trailerDictionary, "/Root", rootObjectNumber))
+      {
+         throw Exception("Cannot find Root object !");
+      }
+      return rootObjectNumber;
+   }
 
-   unsigned int startOfTrailer = Parser::findToken(_fileContent,"trailer", _getStartOfXrefWithRoot());
+   unsigned int startOfTrailer = findTokenIn(_fileContent,"trailer", _getStartOfXrefWithRoot());
    std::string rootStr("/Root");
-   unsigned int startOfRoot = Parser::findToken(_fileContent,rootStr.data(), startOfTrailer);
+   unsigned int startOfRoot = findTokenIn(_fileContent,rootStr.data(), startOfTrailer);
    if((int) startOfRoot == -1)
    {
       throw Exception("Cannot find Root object !");
    }
    std::string encryptStr("/Encrypt");
-   if((int) Parser::findToken(_fileContent,encryptStr,startOfTrailer) != -1 )
+   if((int) findTokenIn(_fileContent,encryptStr,startOfTrailer) != -1 )
    {
       throw Exception("Encrypted PDF is not supported!");
    }
@@ -571,7 +912,7 @@ unsigned int Parser::_readTrailerAndReturnRoot()
 
 unsigned int Parser::_readTrailerAndRterievePrev(const unsigned int startPositionForSearch, unsigned int & previosXref)
 {
-   unsigned int startOfTrailer = Parser::findToken(_fileContent,"trailer", startPositionForSearch);
+   unsigned int startOfTrailer = findTokenIn(_fileContent,"trailer", startPositionForSearch);
    if((int) startOfTrailer == -1 )
    {
       throw Exception("Cannot find trailer!");
@@ -597,6 +938,12 @@ unsigned int Parser::_readTrailerAndRterievePrev(const unsigned int startPositio
 // It uses PDF whitespaces and delimeters to recognize
 // Returned string without begin/end spaces
 std::string Parser::getNextToken(const std::string &str, unsigned int  &position)
+{
+   return getNextTokenIn(str, position);
+}
+
+template<class Content>
+static std::string getNextTokenIn(const Content &str, unsigned int &position)
 {
    if( position >= str.size() )
    {
@@ -704,6 +1051,12 @@ std::string Parser::findTokenStr(const std::string &content, const std::string &
 // Example: content "/Transparency/ ..." pattern "/Trans
 //          will return npos.
 size_t Parser::findToken(const std::string &content, const std::string &keyword,size_t start)
+{
+   return findTokenIn(content, keyword, start);
+}
+
+template<class Content>
+static size_t findTokenIn(const Content &content, const std::string &keyword, size_t start)
 {
    size_t cur_pos  = start;
    // lets find pattern first
@@ -33,10 +33,13 @@
 #include "Object.h"
 #include "Document.h"
 #include "Page.h"
+#include "ContentView.h"
 
 #include <string>
 #include <vector>
+#include <set>
 
+class QFile;
 
 namespace merge_lib
 {
@@ -44,11 +47,16 @@ namespace merge_lib
 
    //This class parsed the pdf document and creates
    //an Document object
+   //With pagesOnDemand the file stays mapped and only the page tree is
+   //parsed up front, the objects of a page are parsed when the page is
+   //first asked for. The document then owns the parser.
    class Parser
    {
    public:   
-      Parser(): _root(0), _fileContent(), _objects(), _document(0)  {};
+      Parser(bool pagesOnDemand = false): _root(0), _file(0), _fileContent(), _objects(), _objectPositions(), _compressedObjects(), _objectStreams(), _trailerDictionary(), _document(0), _pagesOnDemand(pagesOnDemand), _linkedObjects(), _pageTreeNodes(), _loadedObjects()  {};
+      virtual ~Parser();
       Document * parseDocument(const char * fileName);
+      void       loadPage(Page * page);
 
       static const std::string WHITESPACES;
       static const std::string DELIMETERS;
@@ -73,9 +81,18 @@ namespace merge_lib
       bool                                          _getNextObject(Object * object);
       void                                          _callObserver(std::string objectContent);
       void                                          _createObjectTree(const char * fileName);
+      Object *                                      _materializeObject(unsigned int objectNumber);
+      bool                                          _linkObject(Object * object);
       void                                          _retrieveAllPages(Object * objectWithKids);
       void                                          _fillOutObjects();
       virtual void                                  _readXRefAndCreateObjects();
+      void                                          _readXRefTable(unsigned int & currentPostion);
+      void                                          _readXRefStream(unsigned int position, std::string & dictionary);
+      void                                          _getDecodedStream(unsigned int position, std::string & header, std::string & stream);
+      const std::string &                           _getCompressedObjectContent(unsigned int objectStreamNumber, unsigned int index);
+      bool                                          _isObjectListed(unsigned int objectNumber) const;
+      static bool                                   _getDictionaryNumber(const std::string & dictionary, const std::string & key, unsigned int & value);
+      static std::vector<unsigned int>              _getDictionaryArray(const std::string & dictionary, const std::string & key);
       unsigned int                                  _getEndOfLineFromContent(unsigned int fromPosition);
       const std::pair<unsigned int, unsigned int> & _getLineBounds(const std::string & str, unsigned int fromPosition);
       const std::string &                           _getNextToken(unsigned int & fromPosition);
@@ -89,15 +106,38 @@ namespace merge_lib
       virtual unsigned int                          _getStartOfXrefWithRoot();
       unsigned int                                  _readTrailerAndRterievePrev(const unsigned int startPositionForSearch, unsigned int & previosXref);
       void                                          _clearParser();      
+      Parser(const Parser &);
+      Parser & operator=(const Parser &);
       
 
    protected:  
 
       //members
       Object *                         _root;
-      std::string                      _fileContent;
+      //mapped input file, _fileContent views its mapping
+      QFile *                          _file;
+      ContentView                      _fileContent;
       std::map<unsigned int, Object *> _objects;
+      //xref offsets of the objects not parsed yet
+      std::map<unsigned int, unsigned long> _objectPositions;
+      //object stream number and index of the compressed objects not parsed yet
+      std::map<unsigned int, std::pair<unsigned int, unsigned int> > _compressedObjects;
+      //decoded object streams, content starts at /First
+      struct ObjectStream
+      {
+         std::string content;
+         std::vector<unsigned int> offsets;
+      };
+      std::map<unsigned int, ObjectStream> _objectStreams;
+      //dictionary of the newest xref stream, empty for classic trailers
+      std::string                      _trailerDictionary;
       Document *                       _document;
+      bool                             _pagesOnDemand;
+      //objects whose references have been parsed and added as children
+      std::set<Object *>               _linkedObjects;
+      std::set<Object *>               _pageTreeNodes;
+      //objects linked with everything they reference, see loadPage()
+      std::set<Object *>               _loadedObjects;
       
    };
 }
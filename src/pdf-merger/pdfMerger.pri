@@ -5,6 +5,7 @@ HEADERS += \
 	src/pdf-merger/CCITTFaxDecode.h \
 	src/pdf-merger/Config.h \
 	src/pdf-merger/ContentHandler.h \
+	src/pdf-merger/ContentView.h \
 	src/pdf-merger/DCTDecode.h \
 	src/pdf-merger/Decoder.h \
 	src/pdf-merger/Document.h \
@@ -42,6 +42,8 @@ GraphicsPDFItem::GraphicsPDFItem(PDFRenderer *renderer, int pageNumber, QGraphic
 {
     setCacheMode(QGraphicsItem::DeviceCoordinateCache);
     mRenderer->attach();
+
+    connect(mRenderer, SIGNAL(pageRendered(int)), this, SLOT(onPageRendered(int)));
 }
 
 GraphicsPDFItem::~GraphicsPDFItem()
@@ -69,9 +71,22 @@ void GraphicsPDFItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *o
         return;
     }
 
-    if (option)
-        mRenderer->render(painter, mPageNumber, option->exposedRect);
-    else
+    if (!option)
+    {
         qWarning("GraphicsPDFItem::paint: option is null, ignoring painting");
+        return;
+    }
 
+    // on screen the page may be completed later on; when rendering to an image, a printer, etc. (no widget)
+    // the full page must be painted right away
+    if (widget)
+        mRenderer->renderProgressively(painter, mPageNumber, option->exposedRect);
+    else
+        mRenderer->render(painter, mPageNumber, option->exposedRect);
+}
+
+void GraphicsPDFItem::onPageRendered(int pageNumber)
+{
+    if (pageNumber == mPageNumber)
+        update();
 }
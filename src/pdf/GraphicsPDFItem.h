@@ -52,6 +52,9 @@ class GraphicsPDFItem : public QObject, public QGraphicsItem
         QUuid fileUuid() const { return mRenderer->fileUuid(); }
         QByteArray fileData() const { return mRenderer->fileData(); }
 
+    protected slots:
+        void onPageRendered(int pageNumber);
+
     protected:
         PDFRenderer *mRenderer;
         int mPageNumber;
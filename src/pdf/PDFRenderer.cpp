@@ -77,6 +77,11 @@ PDFRenderer* PDFRenderer::rendererForUuid(const QUuid &uuid, const QString &file
     }
 }
 
+void PDFRenderer::renderProgressively(QPainter *p, int pageNumber, const QRectF &bounds)
+{
+    render(p, pageNumber, bounds);
+}
+
 void PDFRenderer::setRefCount(const QAtomicInt &refCount)
 {
     mRefCount = refCount;
@@ -69,6 +69,12 @@ class PDFRenderer : public QObject
     public slots:
         virtual void render(QPainter *p, int pageNumber, const QRectF &bounds = QRectF()) = 0;
 
+        // paints what is readily available and completes the page asynchronously, see pageRendered()
+        virtual void renderProgressively(QPainter *p, int pageNumber, const QRectF &bounds = QRectF());
+
+    signals:
+        void pageRendered(int pageNumber);
+
     private:
         QAtomicInt mRefCount;
         QByteArray mFileData;
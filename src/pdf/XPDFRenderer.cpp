@@ -30,33 +30,326 @@
 #include "XPDFRenderer.h"
 
 #include <QtGui>
+#include <QCache>
+
+#include <climits>
 
 #include <frameworks/UBPlatformUtils.h>
 
+#include "core/UBSettings.h"
+
 #include "core/memcheck.h"
 
 QAtomicInt XPDFRenderer::sInstancesCount = 0;
 
+// tiles are square, in device pixels
+static const int sTileSize = 256;
+
+// zoom factors are rounded to the nearest of 4 steps per doubling, tiles are scaled for the remainder
+static const int sZoomBucketsPerOctave = 4;
+
+// the low resolution preview painted while tiles are rendered, size of its longest side in pixels
+static const int sPreviewSize = 512;
+static const int sPreviewBucket = INT_MIN;
+
+static const int sMaxQueuedTiles = 64;
+
+// pages an XPDFPageBatch renders ahead of the ones taken
+static const int sMaxPagesAhead = 16;
+
+// shared by all the renderers, the cost of a tile is its size in KB
+static QCache<XPDFTileKey, QImage> sTileCache;
+
+
+XPDFTileThread::XPDFTileThread(const QString& filename, QObject *parent)
+    : QThread(parent)
+    , mFileName(filename)
+    , mAbort(false)
+{
+    // NOOP
+}
+
+XPDFTileThread::~XPDFTileThread()
+{
+    mMutex.lock();
+    mAbort = true;
+    mWaitCondition.wakeOne();
+    mMutex.unlock();
+
+    wait();
+}
+
+QList<XPDFTileKey> XPDFTileThread::request(const XPDFTileRequest& tileRequest)
+{
+    QMutexLocker locker(&mMutex);
+
+    QList<XPDFTileKey> dropped;
+
+    mRequests << tileRequest;
+    while (mRequests.size() > sMaxQueuedTiles)
+        dropped << mRequests.takeFirst().key;
+
+    if (!isRunning())
+        start(LowPriority);
+    else
+        mWaitCondition.wakeOne();
+
+    return dropped;
+}
+
+void XPDFTileThread::run()
+{
+    PDFDoc *document = 0;
+    SplashOutputDev *splash = 0;
+
+    XPDFRenderer::xpdfLock()->lock();
+    document = new PDFDoc(new GString(mFileName.toLocal8Bit()), 0, 0, 0);
+
+    if (document->isOk())
+    {
+        SplashColor paperColor = {0xFF, 0xFF, 0xFF}; // white
+        splash = new SplashOutputDev(splashModeRGB8, 1, gFalse, paperColor);
+        splash->startDoc(document->getXRef());
+    }
+    else
+    {
+        qWarning() << "Cannot open" << mFileName << "to render tiles";
+    }
+    XPDFRenderer::xpdfLock()->unlock();
+
+    forever
+    {
+        mMutex.lock();
+        while (mRequests.isEmpty() && !mAbort)
+            mWaitCondition.wait(&mMutex);
+
+        if (mAbort)
+        {
+            mMutex.unlock();
+            break;
+        }
+
+        // latest requests are the ones currently on screen
+        XPDFTileRequest tileRequest = mRequests.takeLast();
+        mMutex.unlock();
+
+        QImage tile;
+        if (splash)
+            tile = XPDFRenderer::renderSlice(document, splash, tileRequest.key.pageNumber, tileRequest.dpi, tileRequest.slice);
+
+        emit tileRendered(tileRequest.key, tile);
+    }
+
+    QMutexLocker xpdfLocker(XPDFRenderer::xpdfLock());
+    delete splash;
+    delete document;
+}
+
+
+XPDFPageBatch::XPDFPageBatch(const QString& filename, int pageCount, int width, QObject *parent)
+    : QObject(parent)
+    , mFileName(filename)
+    , mPageCount(pageCount)
+    , mWidth(width)
+    , mNextPage(1)
+    , mWantedPage(0)
+    , mRunningWorkers(0)
+    , mCancelled(false)
+{
+    // the workers rasterize with their own PDFDoc, only their setup is serialized by the xpdf lock
+    XPDFRenderer::retainGlobalParams();
+
+    QMutexLocker locker(&mMutex);
+
+    int workerCount = qMin(mThreadPool.maxThreadCount(), pageCount);
+    for (; mRunningWorkers < workerCount; mRunningWorkers++)
+        mThreadPool.start(new Worker(this));
+}
+
+XPDFPageBatch::~XPDFPageBatch()
+{
+    mMutex.lock();
+    mCancelled = true;
+    mPageTaken.wakeAll();
+    mMutex.unlock();
+
+    mThreadPool.waitForDone();
+
+    XPDFRenderer::releaseGlobalParams();
+}
+
+QImage XPDFPageBatch::takeImage(int pageNumber)
+{
+    if (pageNumber < 1 || pageNumber > mPageCount)
+        return QImage();
+
+    QMutexLocker locker(&mMutex);
+
+    // a page being waited for is never held back by the pages rendered ahead
+    mWantedPage = pageNumber;
+    mPageTaken.wakeAll();
+
+    while (!mImages.contains(pageNumber))
+    {
+        // the page was already rendered and taken, render it again
+        if (pageNumber < mNextPage && !mPagesInProgress.contains(pageNumber) && !mPagesToRenderAgain.contains(pageNumber))
+        {
+            mPagesToRenderAgain << pageNumber;
+            mPageTaken.wakeAll();
+
+            if (!mRunningWorkers)
+            {
+                mRunningWorkers++;
+                mThreadPool.start(new Worker(this));
+            }
+        }
+
+        mPageRendered.wait(&mMutex);
+    }
+
+    mWantedPage = 0;
+    mPageTaken.wakeAll();
+
+    return mImages.take(pageNumber);
+}
+
+/**
+ * @brief The next page the worker should render, waiting while enough pages are rendered ahead
+ * @return the page number, or 0 when there is nothing left to render
+ */
+int XPDFPageBatch::nextPageToRender()
+{
+    QMutexLocker locker(&mMutex);
+
+    int pageNumber = 0;
+
+    forever
+    {
+        if (mCancelled)
+            break;
+
+        if (!mPagesToRenderAgain.isEmpty())
+        {
+            pageNumber = mPagesToRenderAgain.takeFirst();
+            break;
+        }
+
+        if (mNextPage > mPageCount)
+            break;
+
+        // pages not taken yet do not block a page being waited for
+        if (mImages.size() + mPagesInProgress.size() < sMaxPagesAhead || mWantedPage >= mNextPage)
+        {
+            pageNumber = mNextPage++;
+            break;
+        }
+
+        mPageTaken.wait(&mMutex);
+    }
+
+    if (pageNumber)
+        mPagesInProgress.insert(pageNumber);
+    else
+        mRunningWorkers--;
+
+    return pageNumber;
+}
+
+void XPDFPageBatch::renderPages()
+{
+    PDFDoc *document = 0;
+    SplashOutputDev *splash = 0;
+
+    XPDFRenderer::xpdfLock()->lock();
+    document = new PDFDoc(new GString(mFileName.toLocal8Bit()), 0, 0, 0);
+
+    if (document->isOk())
+    {
+        SplashColor paperColor = {0xFF, 0xFF, 0xFF}; // white
+        splash = new SplashOutputDev(splashModeRGB8, 1, gFalse, paperColor);
+        splash->startDoc(document->getXRef());
+    }
+    else
+    {
+        qWarning() << "Cannot open" << mFileName << "to render pages";
+    }
+    XPDFRenderer::xpdfLock()->unlock();
+
+    forever
+    {
+        int pageNumber = nextPageToRender();
+
+        if (!pageNumber)
+            break;
+
+        QImage image;
+
+        if (splash)
+        {
+            qreal pageWidth = document->getPageCropWidth(pageNumber);
+            qreal pageHeight = document->getPageCropHeight(pageNumber);
+
+            int rotate = document->getPageRotate(pageNumber);
+            if (rotate == 90 || rotate == 270)
+                qSwap(pageWidth, pageHeight);
+
+            if (pageWidth > 0)
+            {
+                qreal dpi = 72.0 * mWidth / pageWidth;
+                QRect slice(0, 0, mWidth, qCeil(pageHeight * mWidth / pageWidth));
+
+                image = XPDFRenderer::renderSlice(document, splash, pageNumber, dpi, slice);
+            }
+        }
+
+        mMutex.lock();
+        mPagesInProgress.remove(pageNumber);
+        mImages.insert(pageNumber, image);
+        mPageRendered.wakeAll();
+        mMutex.unlock();
+    }
+
+    QMutexLocker xpdfLocker(XPDFRenderer::xpdfLock());
+    delete splash;
+    delete document;
+}
+
+
 XPDFRenderer::XPDFRenderer(const QString &filename, bool importingFile)
     : mDocument(0)
     , mpSplashBitmap(0)
     , mSplash(0)
+    , mFileName(filename)
+    , mTileThread(0)
 {
     Q_UNUSED(importingFile);
-    if (!globalParams)
-    {
-        // globalParams must be allocated once and never be deleted
-        // note that this is *not* an instance variable of this XPDFRenderer class
-        globalParams = new GlobalParams(0);
-        globalParams->setupBaseFonts(QFile::encodeName(UBPlatformUtils::applicationResourcesDirectory() + "/" + "fonts").data());
-    }
+
+    qRegisterMetaType<XPDFTileKey>("XPDFTileKey");
+    sTileCache.setMaxCost(UBSettings::settings()->pdfTileCacheSize->get().toInt() * 1024);
+
+    retainGlobalParams();
+
+    QMutexLocker xpdfLocker(xpdfLock());
 
     mDocument = new PDFDoc(new GString(filename.toLocal8Bit()), 0, 0, 0); // the filename GString is deleted on PDFDoc desctruction
-    sInstancesCount.ref();
+
+    // set up now, so that painting never has to wait for the lock
+    if (mDocument->isOk())
+    {
+        SplashColor paperColor = {0xFF, 0xFF, 0xFF}; // white
+        mSplash = new SplashOutputDev(splashModeRGB8, 1, gFalse, paperColor);
+        mSplash->startDoc(mDocument->getXRef());
+    }
 }
 
 XPDFRenderer::~XPDFRenderer()
 {
+    // the thread owns its own document, it must be done before globalParams can be released
+    delete mTileThread;
+    mTileThread = 0;
+
+    xpdfLock()->lock();
+
     if(mSplash){
         delete mSplash;
         mSplash = NULL;
@@ -65,10 +358,32 @@ XPDFRenderer::~XPDFRenderer()
     if (mDocument)
     {
         delete mDocument;
-        sInstancesCount.deref();
     }
 
-    if (sInstancesCount.loadAcquire() == 0 && globalParams)
+    xpdfLock()->unlock();
+
+    releaseGlobalParams();
+}
+
+void XPDFRenderer::retainGlobalParams()
+{
+    QMutexLocker xpdfLocker(xpdfLock());
+
+    if (!globalParams)
+    {
+        // note that this is *not* an instance variable of this XPDFRenderer class
+        globalParams = new GlobalParams(0);
+        globalParams->setupBaseFonts(QFile::encodeName(UBPlatformUtils::applicationResourcesDirectory() + "/" + "fonts").data());
+    }
+
+    sInstancesCount.ref();
+}
+
+void XPDFRenderer::releaseGlobalParams()
+{
+    QMutexLocker xpdfLocker(xpdfLock());
+
+    if (!sInstancesCount.deref() && globalParams)
     {
         delete globalParams;
         globalParams = 0;
@@ -169,11 +484,7 @@ QImage* XPDFRenderer::createPDFImage(int pageNumber, qreal xscale, qreal yscale,
 {
     if (isValid())
     {
-        SplashColor paperColor = {0xFF, 0xFF, 0xFF}; // white
-        if(mSplash)
-            delete mSplash;
-        mSplash = new SplashOutputDev(splashModeRGB8, 1, gFalse, paperColor);
-        mSplash->startDoc(mDocument->getXRef());
+        // mDocument and mSplash are only used by the GUI thread, they were set up with the document
         int rotation = 0; // in degrees (get it from the worldTransform if we want to support rotation)
         GBool useMediaBox = gFalse;
         GBool crop = gTrue;
@@ -201,3 +512,162 @@ QImage* XPDFRenderer::createPDFImage(int pageNumber, qreal xscale, qreal yscale,
     }
     return new QImage(mpSplashBitmap->getDataPtr(), mpSplashBitmap->getWidth(), mpSplashBitmap->getHeight(), mpSplashBitmap->getWidth() * 3, QImage::Format_RGB888);
 }
+
+QMutex* XPDFRenderer::xpdfLock()
+{
+    static QMutex sXpdfLock;
+    return &sXpdfLock;
+}
+
+QImage XPDFRenderer::renderSlice(PDFDoc *document, SplashOutputDev *splash, int pageNumber, qreal dpi, const QRect &slice)
+{
+    int rotation = 0;
+    GBool useMediaBox = gFalse;
+    GBool crop = gTrue;
+    GBool printing = gFalse;
+
+    document->displayPageSlice(splash, pageNumber, dpi, dpi, rotation, useMediaBox, crop, printing,
+                               slice.x(), slice.y(), slice.width(), slice.height());
+
+    // the bitmap belongs to the output device and is reused for the next page
+    SplashBitmap *bitmap = splash->getBitmap();
+    return QImage(bitmap->getDataPtr(), bitmap->getWidth(), bitmap->getHeight(), bitmap->getRowSize(), QImage::Format_RGB888).copy();
+}
+
+void XPDFRenderer::renderProgressively(QPainter *p, int pageNumber, const QRectF &bounds)
+{
+    QTransform transform = p->worldTransform();
+
+    if (!isValid() || transform.isRotating() || transform.m11() <= 0 || transform.m22() <= 0)
+    {
+        render(p, pageNumber, bounds);
+        return;
+    }
+
+    QSizeF pageSize = pageSizeF(pageNumber);
+    QRectF pageRect(QPointF(0, 0), pageSize);
+    QRectF exposed = bounds.isNull() ? pageRect : bounds.intersected(pageRect);
+
+    if (exposed.isEmpty())
+        return;
+
+    qreal scale = qMax(transform.m11(), transform.m22());
+    int bucket = qRound(qLn(scale) / M_LN2 * sZoomBucketsPerOctave);
+    qreal bucketScale = qPow(2., bucket / (qreal)sZoomBucketsPerOctave);
+
+    // tile grid, in pixels of the page rendered at the bucket scale
+    QSize bucketPageSize(qCeil(pageSize.width() * bucketScale), qCeil(pageSize.height() * bucketScale));
+    QRectF bucketExposed(exposed.topLeft() * bucketScale, exposed.size() * bucketScale);
+
+    int firstColumn = qFloor(bucketExposed.left() / sTileSize);
+    int firstRow = qFloor(bucketExposed.top() / sTileSize);
+    int lastColumn = qMin(qCeil(bucketExposed.right() / sTileSize), qCeil(bucketPageSize.width() / (qreal)sTileSize)) - 1;
+    int lastRow = qMin(qCeil(bucketExposed.bottom() / sTileSize), qCeil(bucketPageSize.height() / (qreal)sTileSize)) - 1;
+
+    XPDFTileKey key;
+    key.fileUuid = fileUuid();
+    key.pageNumber = pageNumber;
+    key.bucket = bucket;
+
+    QList<QPair<QPoint, QImage> > tiles;
+    QList<XPDFTileKey> missingTiles;
+
+    for (int row = firstRow; row <= lastRow; row++)
+    {
+        for (int column = firstColumn; column <= lastColumn; column++)
+        {
+            key.column = column;
+            key.row = row;
+
+            QImage* tile = sTileCache.object(key);
+            if (tile)
+                tiles << qMakePair(QPoint(column * sTileSize, row * sTileSize), *tile);
+            else
+                missingTiles << key;
+        }
+    }
+
+    p->save();
+    p->scale(1 / bucketScale, 1 / bucketScale);
+    p->setRenderHint(QPainter::SmoothPixmapTransform);
+
+    if (!missingTiles.isEmpty())
+    {
+        p->drawImage(QRectF(QPointF(0, 0), QSizeF(pageSize * bucketScale)), pagePreview(pageNumber));
+
+        qreal dpi = dpiForRendering * bucketScale;
+        foreach (const XPDFTileKey& missingKey, missingTiles)
+        {
+            QRect slice(missingKey.column * sTileSize, missingKey.row * sTileSize, sTileSize, sTileSize);
+            requestTile(missingKey, dpi, slice.intersected(QRect(QPoint(0, 0), bucketPageSize)));
+        }
+    }
+
+    for (int i = 0; i < tiles.size(); i++)
+        p->drawImage(tiles.at(i).first, tiles.at(i).second);
+
+    p->restore();
+}
+
+QImage XPDFRenderer::pagePreview(int pageNumber)
+{
+    XPDFTileKey key;
+    key.fileUuid = fileUuid();
+    key.pageNumber = pageNumber;
+    key.bucket = sPreviewBucket;
+    key.column = 0;
+    key.row = 0;
+
+    QImage* cachedPreview = sTileCache.object(key);
+    if (cachedPreview)
+        return *cachedPreview;
+
+    QSizeF pageSize = pageSizeF(pageNumber);
+    if (pageSize.isEmpty())
+        return QImage();
+
+    qreal scale = sPreviewSize / qMax(pageSize.width(), pageSize.height());
+    QRect slice(0, 0, qCeil(pageSize.width() * scale), qCeil(pageSize.height() * scale));
+
+    if (!mSplash)
+        return QImage();
+
+    QImage preview = renderSlice(mDocument, mSplash, pageNumber, dpiForRendering * scale, slice);
+    sTileCache.insert(key, new QImage(preview), qMax(1, preview.byteCount() / 1024));
+
+    return preview;
+}
+
+void XPDFRenderer::requestTile(const XPDFTileKey& key, qreal dpi, const QRect& slice)
+{
+    if (mPendingTiles.contains(key))
+        return;
+
+    if (!mTileThread)
+    {
+        mTileThread = new XPDFTileThread(mFileName, this);
+        connect(mTileThread, SIGNAL(tileRendered(XPDFTileKey, QImage)), this, SLOT(onTileRendered(XPDFTileKey, QImage)));
+    }
+
+    XPDFTileRequest tileRequest;
+    tileRequest.key = key;
+    tileRequest.dpi = dpi;
+    tileRequest.slice = slice;
+
+    mPendingTiles.insert(key);
+
+    foreach (const XPDFTileKey& droppedKey, mTileThread->request(tileRequest))
+        mPendingTiles.remove(droppedKey);
+}
+
+void XPDFRenderer::onTileRendered(const XPDFTileKey& key, const QImage& tile)
+{
+    mPendingTiles.remove(key);
+
+    if (tile.isNull())
+        return;
+
+    sTileCache.insert(key, new QImage(tile), qMax(1, tile.byteCount() / 1024));
+
+    emit pageRendered(key.pageNumber);
+}
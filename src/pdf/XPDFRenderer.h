@@ -30,6 +30,14 @@
 #ifndef XPDFRENDERER_H
 #define XPDFRENDERER_H
 #include <QImage>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QUuid>
+#include <QSet>
+#include <QHash>
+#include <QThreadPool>
+#include <QRunnable>
 #include "PDFRenderer.h"
 #include <splash/SplashBitmap.h>
 
@@ -44,6 +52,118 @@ THIRD_PARTY_WARNINGS_ENABLE
 
 class PDFDoc;
 
+/** @brief Identifies a tile of a page rasterized at a given zoom bucket. */
+struct XPDFTileKey
+{
+    QUuid fileUuid;
+    int pageNumber;
+    int bucket;
+    int column;
+    int row;
+
+    bool operator==(const XPDFTileKey& other) const
+    {
+        return fileUuid == other.fileUuid && pageNumber == other.pageNumber && bucket == other.bucket
+                && column == other.column && row == other.row;
+    }
+};
+
+inline uint qHash(const XPDFTileKey& key)
+{
+    return qHash(key.fileUuid) ^ (uint(key.pageNumber) * 2654435761u) ^ (uint(key.bucket) << 24)
+            ^ (uint(key.column) << 12) ^ uint(key.row);
+}
+
+Q_DECLARE_METATYPE(XPDFTileKey)
+
+struct XPDFTileRequest
+{
+    XPDFTileKey key;
+    qreal dpi;
+    QRect slice;
+};
+
+/**
+ * @brief Rasterizes page tiles in the background.
+ *
+ * xpdf documents are not thread safe, so the thread opens its own PDFDoc and output device on the same file.
+ * Only their setup is done under the XPDFRenderer lock, the tiles are rasterized without it.
+ * The most recently requested tiles are rendered first.
+ */
+class XPDFTileThread : public QThread
+{
+    Q_OBJECT
+
+    public:
+        XPDFTileThread(const QString& filename, QObject *parent = 0);
+        virtual ~XPDFTileThread();
+
+        // returns the requests that were dropped to keep the queue short
+        QList<XPDFTileKey> request(const XPDFTileRequest& tileRequest);
+
+    signals:
+        void tileRendered(const XPDFTileKey& key, const QImage& tile);
+
+    protected:
+        void run();
+
+    private:
+        QString mFileName;
+        QMutex mMutex;
+        QWaitCondition mWaitCondition;
+        QList<XPDFTileRequest> mRequests;
+        bool mAbort;
+};
+
+/**
+ * @brief Renders every page of a PDF file at a given width, in the background.
+ *
+ * One worker per core opens its own PDFDoc, together they render the pages in order, at most sMaxPagesAhead
+ * pages ahead of the ones taken. A page taken a second time is rendered again.
+ */
+class XPDFPageBatch : public QObject
+{
+    Q_OBJECT
+
+    public:
+        XPDFPageBatch(const QString& filename, int pageCount, int width, QObject *parent = 0);
+        virtual ~XPDFPageBatch();
+
+        // returns the image of the page, blocking until a worker has rendered it
+        QImage takeImage(int pageNumber);
+
+    private:
+        class Worker : public QRunnable
+        {
+            public:
+                Worker(XPDFPageBatch *batch) : mBatch(batch) {}
+                void run() { mBatch->renderPages(); }
+
+            private:
+                XPDFPageBatch *mBatch;
+        };
+
+        void renderPages();
+        int nextPageToRender();
+
+        QString mFileName;
+        int mPageCount;
+        int mWidth;
+        QThreadPool mThreadPool;
+
+        // all the following is guarded by mMutex
+        QMutex mMutex;
+        QWaitCondition mPageTaken;
+        QWaitCondition mPageRendered;
+        QHash<int, QImage> mImages;
+        QList<int> mPagesToRenderAgain;
+        QSet<int> mPagesInProgress;
+        int mNextPage;
+        int mWantedPage;
+        int mRunningWorkers;
+        bool mCancelled;
+};
+
 class XPDFRenderer : public PDFRenderer
 {
     Q_OBJECT
@@ -62,12 +182,32 @@ class XPDFRenderer : public PDFRenderer
 
         virtual QString title() const;
 
+        static QImage renderSlice(PDFDoc *document, SplashOutputDev *splash, int pageNumber, qreal dpi, const QRect &slice);
+
+        // held while setting up globalParams, a PDFDoc or an output device, which are not thread safe;
+        // rasterizing with a PDFDoc and an output device used by a single thread does not need it
+        static QMutex* xpdfLock();
+
+        // globalParams is shared by the whole process, it is set up by its first user and released by the last one
+        static void retainGlobalParams();
+        static void releaseGlobalParams();
+
     public slots:
         void render(QPainter *p, int pageNumber, const QRectF &bounds = QRectF());
+        void renderProgressively(QPainter *p, int pageNumber, const QRectF &bounds = QRectF());
+
+    private slots:
+        void onTileRendered(const XPDFTileKey& key, const QImage& tile);
 
     private:
         void init();
         QImage* createPDFImage(int pageNumber, qreal xscale = 0.5, qreal yscale = 0.5, const QRectF &bounds = QRectF());
+        QImage pagePreview(int pageNumber);
+        void requestTile(const XPDFTileKey& key, qreal dpi, const QRect& slice);
+
+        QString mFileName;
+        XPDFTileThread* mTileThread;
+        QSet<XPDFTileKey> mPendingTiles;
 
         PDFDoc *mDocument;
         static QAtomicInt sInstancesCount;
@@ -75,6 +75,22 @@ UBPodcastController* UBPodcastController::sInstance = 0;
 
 unsigned int UBPodcastController::sBackgroundColor = 0x00000000;  // BBGGRRAA
 
+/// Side of the square tiles the capture is invalidated by, in video pixels
+static const int sCaptureTileSize = 32;
+/// Above this many separate damaged rectangles, their bounding rect is rendered in one pass
+static const int sMaxCaptureRects = 16;
+
+/// Grow a damaged rect, in video pixels, to the capture tiles it touches
+static QRect alignToCaptureTiles(const QRect& rect)
+{
+    int left = rect.left() - (rect.left() % sCaptureTileSize + sCaptureTileSize) % sCaptureTileSize;
+    int top = rect.top() - (rect.top() % sCaptureTileSize + sCaptureTileSize) % sCaptureTileSize;
+    int right = (rect.right() / sCaptureTileSize + 1) * sCaptureTileSize;
+    int bottom = (rect.bottom() / sCaptureTileSize + 1) * sCaptureTileSize;
+
+    return QRect(QPoint(left, top), QPoint(right - 1, bottom - 1));
+}
+
 
 UBPodcastController::UBPodcastController(QObject* pParent)
     : QObject(pParent)
@@ -197,6 +213,8 @@ void UBPodcastController::setSourceWidget(QWidget* pWidget)
         mInitialized = false;
         mViewToVideoTransform.reset();
         mLatestCapture.fill(sBackgroundColor);
+        mPreviousCapture = QImage();
+        mLastDesktopGrab = QImage();
 
         if (mSourceWidget)
         {
@@ -373,6 +391,7 @@ void UBPodcastController::start()
             mVideoEncoder->setVideoFileName(videoFileName);
 
             mLatestCapture = QImage(mVideoFrameSizeAtStart, QImage::Format_RGB32); //0xffRRGGBB
+            mPreviousCapture = QImage();
 
             mRecordStartTime = QTime::currentTime();
 
@@ -479,12 +498,12 @@ void UBPodcastController::processWidgetPaintEvent()
     if(mRecordingState != Recording)
         return;
 
-    QRect repaintRect;
+    QRegion repaintRegion;
 
     if (!mInitialized)
     {
         mWidgetRepaintRectQueue.clear();
-        repaintRect = mSourceWidget->geometry();
+        repaintRegion = mSourceWidget->geometry();
 
         mLatestCapture.fill(sBackgroundColor);
 
@@ -492,26 +511,37 @@ void UBPodcastController::processWidgetPaintEvent()
     }
     else
     {
+        // Kept as a region: two small far apart updates don't repaint everything in between
         while(mWidgetRepaintRectQueue.size() > 0)
         {
-            repaintRect = repaintRect.united(mWidgetRepaintRectQueue.dequeue());
+            repaintRegion += mWidgetRepaintRectQueue.dequeue();
         }
     }
 
-    if (!repaintRect.isNull())
+    if (!repaintRegion.isEmpty())
     {
         mIsGrabbing = true;
 
-        QPainter p(&mLatestCapture);
-        p.setTransform(mViewToVideoTransform);
-        p.setRenderHints(QPainter::Antialiasing);
-        p.setRenderHints(QPainter::SmoothPixmapTransform);
+        {
+            QPainter p(&mLatestCapture);
+            p.setTransform(mViewToVideoTransform);
+            p.setRenderHints(QPainter::Antialiasing);
+            p.setRenderHints(QPainter::SmoothPixmapTransform);
 
-        mSourceWidget->render(&p, repaintRect.topLeft(), QRegion(repaintRect), QWidget::DrawChildren);
+            mSourceWidget->render(&p, repaintRegion.boundingRect().topLeft(), repaintRegion, QWidget::DrawChildren);
+        }
 
         mIsGrabbing = false;
 
-        sendLatestPixmapToEncoder();
+        QRegion damage;
+        foreach(const QRect& rect, repaintRegion.rects())
+        {
+            damage += alignToCaptureTiles(mViewToVideoTransform.mapRect(QRectF(rect)).toAlignedRect().adjusted(-1, -1, 1, 1));
+        }
+        damage &= mLatestCapture.rect();
+
+        if (captureChanged(damage))
+            sendLatestPixmapToEncoder();
     }
 }
 
@@ -610,12 +640,13 @@ void UBPodcastController::processScenePaintEvent()
     if(!bv)
         return;
 
-    QRectF repaintRect;
+    QTransform sceneToVideo = bv->viewportTransform() * mViewToVideoTransform;
+    QRegion damage;
 
     if (!mInitialized)
     {
         mSceneRepaintRectQueue.clear();
-        repaintRect = bv->mapToScene(QRect(0, 0, bv->width(), bv->height())).boundingRect();
+        damage = mLatestCapture.rect();
 
         if (bv->scene()->isDarkBackground())
                 mLatestCapture.fill(Qt::black);
@@ -628,44 +659,98 @@ void UBPodcastController::processScenePaintEvent()
     }
     else
     {
+        // Damage is accumulated per tile of the capture rather than as one
+        // bounding rect, so only the tiles that changed are rendered again
         while(mSceneRepaintRectQueue.size() > 0)
         {
-            repaintRect = repaintRect.united(mSceneRepaintRectQueue.dequeue());
+            QRect videoRect = sceneToVideo.mapRect(mSceneRepaintRectQueue.dequeue()).toAlignedRect();
+            damage += alignToCaptureTiles(videoRect.adjusted(-1, -1, 1, 1));
         }
+        damage &= mLatestCapture.rect();
     }
 
-    if (!repaintRect.isNull())
+    if (!damage.isEmpty())
     {
         UBGraphicsScene *scene = bv->scene();
 
-        QPainter p(&mLatestCapture);
+        QVector<QRect> rects = damage.rects();
+        if (rects.size() > sMaxCaptureRects)
+            rects = QVector<QRect>() << damage.boundingRect();
+
+        QTransform videoToScene = sceneToVideo.inverted();
 
-        p.setTransform(mViewToVideoTransform);
-        p.setTransform(bv->viewportTransform(), true);
+        QPainter p(&mLatestCapture);
 
         p.setRenderHints(QPainter::Antialiasing);
         p.setRenderHints(QPainter::SmoothPixmapTransform);
 
-        repaintRect.adjust(-1, -1, 1, 1);
+        scene->setRenderingContext(UBGraphicsScene::Podcast);
 
-        p.setClipRect(repaintRect);
+        foreach(const QRect& rect, rects)
+        {
+            QRectF repaintRect = videoToScene.mapRect(QRectF(rect));
 
-        if (scene->isDarkBackground())
-            p.fillRect(repaintRect, Qt::black);
-        else
-            p.fillRect(repaintRect, Qt::white);
+            p.resetTransform();
+            p.setClipRect(rect);
+            p.setTransform(sceneToVideo);
 
-        scene->setRenderingContext(UBGraphicsScene::Podcast);
+            if (scene->isDarkBackground())
+                p.fillRect(repaintRect, Qt::black);
+            else
+                p.fillRect(repaintRect, Qt::white);
 
-        scene->render(&p, repaintRect, repaintRect);
+            scene->render(&p, repaintRect, repaintRect);
+        }
 
         scene->setRenderingContext(UBGraphicsScene::Screen);
 
-        sendLatestPixmapToEncoder();
+        p.end();
+
+        if (captureChanged(damage))
+            sendLatestPixmapToEncoder();
     }
 }
 
 
+/**
+ * Compare the damaged part of the capture with what was last sent to the
+ * encoder, and remember it. Frames where nothing actually changed (e.g. an
+ * item repainted identically) are not encoded again.
+ */
+bool UBPodcastController::captureChanged(const QRegion& damage)
+{
+    if (mPreviousCapture.size() != mLatestCapture.size() || mPreviousCapture.format() != mLatestCapture.format())
+    {
+        mPreviousCapture = mLatestCapture.copy();
+        return true;
+    }
+
+    const int bytesPerPixel = mLatestCapture.depth() / 8;
+    bool changed = false;
+
+    foreach(const QRect& damagedRect, damage.rects())
+    {
+        QRect rect = damagedRect & mLatestCapture.rect();
+        const int offset = rect.left() * bytesPerPixel;
+        const int length = rect.width() * bytesPerPixel;
+
+        for (int y = rect.top(); y <= rect.bottom(); ++y)
+        {
+            const uchar* latest = mLatestCapture.constScanLine(y) + offset;
+            uchar* previous = mPreviousCapture.scanLine(y) + offset;
+
+            if (memcmp(latest, previous, length) != 0)
+            {
+                memcpy(previous, latest, length);
+                changed = true;
+            }
+        }
+    }
+
+    return changed;
+}
+
+
 void UBPodcastController::applicationMainModeChanged(UBApplicationController::MainMode pMode)
 {
     if (pMode == UBApplicationController::Internet)
@@ -772,9 +857,11 @@ void UBPodcastController::timerEvent(QTimerEvent *event)
         QRect dtopRect = dtop->screenGeometry(UBApplication::controlScreenIndex());
         QScreen * screen = UBApplication::controlScreen();
 
-        QPixmap desktop = screen->grabWindow(dtop->effectiveWinId(),
-                                             dtopRect.x(), dtopRect.y(), dtopRect.width(), dtopRect.height());
+        QImage desktop = screen->grabWindow(dtop->effectiveWinId(),
+                                            dtopRect.x(), dtopRect.y(), dtopRect.width(), dtopRect.height()).toImage();
 
+        // A static desktop is not scaled and encoded again
+        if (!mInitialized || desktop != mLastDesktopGrab)
         {
             QPainter p(&mLatestCapture);
 
@@ -788,10 +875,13 @@ void UBPodcastController::timerEvent(QTimerEvent *event)
 
             p.setRenderHints(QPainter::Antialiasing);
             p.setRenderHints(QPainter::SmoothPixmapTransform);
-            p.drawPixmap(targetRect.left(), targetRect.top(), desktop.scaled(targetRect.width(), targetRect.height(),  Qt::KeepAspectRatio, Qt::SmoothTransformation));
-        }
+            p.drawImage(targetRect.left(), targetRect.top(), desktop.scaled(targetRect.width(), targetRect.height(),  Qt::KeepAspectRatio, Qt::SmoothTransformation));
+            p.end();
 
-        sendLatestPixmapToEncoder();
+            mLastDesktopGrab = desktop;
+
+            sendLatestPixmapToEncoder();
+        }
     }
 
     if (mRecordingProgressTimerEventID == event->timerId() && mRecordingState == Recording)
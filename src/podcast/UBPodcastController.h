@@ -125,6 +125,8 @@ class UBPodcastController : public QObject
 
         void sendLatestPixmapToEncoder();
 
+        bool captureChanged(const QRegion& damage);
+
         long elapsedRecordingMs();
 
         static UBPodcastController* sInstance;
@@ -141,6 +143,9 @@ class UBPodcastController : public QObject
         bool mInitialized;
 
         QImage mLatestCapture;
+        /// Copy of the capture as last sent to the encoder, to skip unchanged frames
+        QImage mPreviousCapture;
+        QImage mLastDesktopGrab;
 
         int mVideoFramesPerSecondAtStart;
         QSize mVideoFrameSizeAtStart;
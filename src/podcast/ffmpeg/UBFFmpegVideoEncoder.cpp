@@ -21,6 +21,9 @@
 
 #include "UBFFmpegVideoEncoder.h"
 
+#include "core/UBSettings.h"
+#include "core/UBSetting.h"
+
 // Due to the whole FFmpeg / libAV silliness, we have to support libavresample instead
 // of libswresapmle on some platforms, as well as now-obsolete function names
 #if LIBAVFORMAT_VERSION_MICRO < 100
@@ -153,6 +156,43 @@
 
 #endif
 
+//-------------------------------------------------------------------------
+// Encoding presets
+//-------------------------------------------------------------------------
+
+/**
+ * Encoder setups selectable with the Podcast/FFmpegPreset setting. Board
+ * recordings are mostly static, with sharp edges and flat colours; frames
+ * where nothing changed are not sent at all, so the keyframe interval is
+ * given in seconds rather than frames.
+ */
+struct UBFFmpegEncodingPreset
+{
+    const char* name;
+    const char* x264Preset;
+    const char* x264Tune;
+    int crf;
+    int keyframeIntervalSeconds;
+};
+
+// the first preset, the former encoder setup, is used for unknown names
+static const UBFFmpegEncodingPreset sEncodingPresets[] = {
+    { "Quality",  "slow",     NULL,         20, 1 },
+    { "Balanced", "medium",   "animation",  21, 5 },
+    { "Screen",   "veryfast", "stillimage", 23, 10 }
+};
+
+static const UBFFmpegEncodingPreset& encodingPreset(const QString& name)
+{
+    for (size_t i = 0; i < sizeof(sEncodingPresets) / sizeof(sEncodingPresets[0]); ++i) {
+        if (name.compare(sEncodingPresets[i].name, Qt::CaseInsensitive) == 0)
+            return sEncodingPresets[i];
+    }
+
+    qWarning() << "Unknown podcast encoding preset" << name << "- using" << sEncodingPresets[0].name;
+    return sEncodingPresets[0];
+}
+
 //-------------------------------------------------------------------------
 // Utility functions
 //-------------------------------------------------------------------------
@@ -215,6 +255,8 @@ UBFFmpegVideoEncoder::UBFFmpegVideoEncoder(QObject* parent)
     : UBAbstractVideoEncoder(parent)
     , mOutputFormatContext(NULL)
     , mSwsContext(NULL)
+    , mKeyframeIntervalMs(0)
+    , mLastKeyframeTimestamp(0)
     , mShouldRecordAudio(true)
     , mAudioInput(NULL)
     , mSwrContext(NULL)
@@ -318,13 +360,34 @@ bool UBFFmpegVideoEncoder::init()
 
     AVCodecContext* c = avcodec_alloc_context3(videoCodec);
 
+    const UBFFmpegEncodingPreset& preset = encodingPreset(UBSettings::settings()->podcastFFmpegPreset->get().toString());
+
+    int crf = UBSettings::settings()->podcastFFmpegCrf->get().toInt();
+    if (crf <= 0)
+        crf = preset.crf;
+
+    int keyframeIntervalSeconds = UBSettings::settings()->podcastFFmpegKeyframeInterval->get().toInt();
+    if (keyframeIntervalSeconds <= 0)
+        keyframeIntervalSeconds = preset.keyframeIntervalSeconds;
+
+    mKeyframeIntervalMs = keyframeIntervalSeconds * 1000;
+    mLastKeyframeTimestamp = 0;
+
     c->bit_rate = videoBitsPerSecond();
     c->width = videoSize().width();
     c->height = videoSize().height();
     c->time_base = {1, mVideoTimebase};
-    c->gop_size = 10;
+    c->gop_size = qMax(1, keyframeIntervalSeconds * framesPerSecond());
     c->max_b_frames = 0;
     c->pix_fmt = AV_PIX_FMT_YUV420P;
+    c->thread_count = qMax(0, UBSettings::settings()->podcastFFmpegThreads->get().toInt());
+
+    int maxBitsPerSecond = UBSettings::settings()->podcastFFmpegMaxBitsPerSecond->get().toInt();
+    if (maxBitsPerSecond > 0) {
+        // Caps the constant quality mode, with a one second buffer
+        c->rc_max_rate = maxBitsPerSecond;
+        c->rc_buffer_size = maxBitsPerSecond;
+    }
 
     if (mOutputFormatContext->oformat->flags & AVFMT_GLOBALHEADER)
         c->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
@@ -337,8 +400,12 @@ bool UBFFmpegVideoEncoder::init()
      *   AV_PIX_FMT_YUVJ420P
     */
 
-    av_dict_set(&options, "preset", "slow", 0);
-    av_dict_set(&options, "crf", "20", 0);
+    av_dict_set(&options, "preset", preset.x264Preset, 0);
+    if (preset.x264Tune)
+        av_dict_set(&options, "tune", preset.x264Tune, 0);
+    av_dict_set_int(&options, "crf", crf, 0);
+
+    qDebug() << "Video encoder: preset" << preset.name << "crf" << crf << "keyframe interval" << keyframeIntervalSeconds << "s";
 
     ret = avcodec_open2(c, videoCodec, &options);
 
@@ -468,60 +535,49 @@ bool UBFFmpegVideoEncoder::init()
 
 /**
  * This function should be called every time a new "screenshot" is ready.
- * The image is converted to the right format and sent to the encoder.
+ * The image is copied and handed to the worker thread, which converts it to
+ * the right format and sends it to the encoder.
  */
 void UBFFmpegVideoEncoder::newPixmap(const QImage &pImage, long timestamp)
 {
-    if (!mVideoWorker->isRunning()) {
-        qDebug() << "Encoder worker thread not running. Queuing frame.";
-        mPendingFrames.enqueue({pImage, timestamp});
-    }
-
-    else {
-        // First send any queued frames, then the latest one
-        while (!mPendingFrames.isEmpty()) {
-            AVFrame* avFrame = convertImageFrame(mPendingFrames.dequeue());
-            if (avFrame)
-                mVideoWorker->queueVideoFrame(avFrame);
-        }
-
-        // note: if converting the frame turns out to be too slow to do here, it
-        // can always be done from the worker thread (in that case,
-        // the worker's queue would contain ImageFrames rather than AVFrames)
-
-        AVFrame* avFrame = convertImageFrame({pImage, timestamp});
-        if (avFrame)
-            mVideoWorker->queueVideoFrame(avFrame);
-
-        // signal the worker that frames are available
-        mVideoWorker->mWaitCondition.wakeAll();
-    }
+    mVideoWorker->queueVideoFrame(pImage, timestamp);
 }
 
 /**
  * Convert a frame consisting of a QImage and timestamp to an AVFrame
- * with the right pixel format and PTS
+ * with the right pixel format and PTS. Called from the worker thread; the
+ * converted image is written to avFrame, which is allocated on first use.
  */
-AVFrame* UBFFmpegVideoEncoder::convertImageFrame(ImageFrame frame)
+AVFrame* UBFFmpegVideoEncoder::convertImageFrame(const ImageFrame& frame, AVFrame* avFrame)
 {
-    AVFrame* avFrame = av_frame_alloc();
+    if (!avFrame->data[0]) {
+        avFrame->format = mVideoStream->codec->pix_fmt;
+        avFrame->width = mVideoStream->codec->width;
+        avFrame->height = mVideoStream->codec->height;
+
+        // Allocate the output image
+        if (av_image_alloc(avFrame->data, avFrame->linesize, mVideoStream->codec->width,
+                           mVideoStream->codec->height, mVideoStream->codec->pix_fmt, 32) < 0)
+        {
+            qWarning() << "Couldn't allocate image";
+            return NULL;
+        }
+    }
 
-    avFrame->format = mVideoStream->codec->pix_fmt;
-    avFrame->width = mVideoStream->codec->width;
-    avFrame->height = mVideoStream->codec->height;
     avFrame->pts = mVideoTimebase * frame.timestamp / 1000;
 
-    const uchar * rgbImage = frame.image.bits();
+    // Unchanged frames are skipped, so gop_size alone could leave minutes
+    // between keyframes of an idle recording; force one after the interval
+    if (mKeyframeIntervalMs > 0 && frame.timestamp - mLastKeyframeTimestamp >= mKeyframeIntervalMs) {
+        avFrame->pict_type = AV_PICTURE_TYPE_I;
+        mLastKeyframeTimestamp = frame.timestamp;
+    }
+    else
+        avFrame->pict_type = AV_PICTURE_TYPE_NONE;
 
-    const int in_linesize[1] = { frame.image.bytesPerLine() };
+    const uchar * rgbImage = frame.image.constBits();
 
-    // Allocate the output image
-    if (av_image_alloc(avFrame->data, avFrame->linesize, mVideoStream->codec->width,
-                       mVideoStream->codec->height, mVideoStream->codec->pix_fmt, 32) < 0)
-    {
-        qWarning() << "Couldn't allocate image";
-        return NULL;
-    }
+    const int in_linesize[1] = { frame.image.bytesPerLine() };
 
     sws_scale(mSwsContext,
               (const uint8_t* const*)&rgbImage,
@@ -637,14 +693,23 @@ void UBFFmpegVideoEncoder::processAudio(QByteArray &data)
         }
     }
 
-    if (framesAdded)
+    if (framesAdded) {
+        QMutexLocker locker(&mVideoWorker->mFrameQueueMutex);
         mVideoWorker->mWaitCondition.wakeAll();
+    }
 }
 
 void UBFFmpegVideoEncoder::finishEncoding()
 {
     qDebug() << "VideoEncoder::finishEncoding called";
 
+    mVideoWorker->mFrameQueueMutex.lock();
+    int droppedFrameCount = mVideoWorker->mDroppedFrameCount;
+    mVideoWorker->mFrameQueueMutex.unlock();
+
+    if (droppedFrameCount > 0)
+        qDebug() << "Video encoder:" << droppedFrameCount << "frames dropped because the encoder was behind";
+
     flushStream(mVideoWorker->mVideoPacket, mVideoStream, mOutputFormatContext);
 
     if (mShouldRecordAudio)
@@ -671,17 +736,29 @@ void UBFFmpegVideoEncoder::finishEncoding()
 // Worker
 //-------------------------------------------------------------------------
 
+/// Capture buffers in flight between the GUI thread and the worker; once they
+/// are all in use, newer frames replace the newest one still waiting
+static const int sMaxCaptureBuffers = 4;
+
 UBFFmpegVideoEncoderWorker::UBFFmpegVideoEncoderWorker(UBFFmpegVideoEncoder* controller)
     : mController(controller)
+    , mCaptureBufferCount(0)
+    , mDroppedFrameCount(0)
 {
     mStopRequested = false;
     mIsRunning = false;
+    mVideoFrame = av_frame_alloc();
     mVideoPacket = new AVPacket();
     mAudioPacket = new AVPacket();
 }
 
 UBFFmpegVideoEncoderWorker::~UBFFmpegVideoEncoderWorker()
 {
+    if (mVideoFrame) {
+        av_freep(&mVideoFrame->data[0]);
+        av_frame_free(&mVideoFrame);
+    }
+
     if (mVideoPacket)
         delete mVideoPacket;
 
@@ -692,17 +769,70 @@ UBFFmpegVideoEncoderWorker::~UBFFmpegVideoEncoderWorker()
 void UBFFmpegVideoEncoderWorker::stopEncoding()
 {
     qDebug() << "Video worker: stop requested";
+    QMutexLocker locker(&mFrameQueueMutex);
     mStopRequested = true;
     mWaitCondition.wakeAll();
 }
 
-void UBFFmpegVideoEncoderWorker::queueVideoFrame(AVFrame* frame)
+/**
+ * An RGB32 copy of the image that doesn't share its pixels with it. convertToFormat()
+ * returns a shallow copy when the image already has the target format.
+ */
+static QImage detachedRgb32Copy(const QImage& image)
 {
-    if (frame) {
-        mFrameQueueMutex.lock();
-        mImageQueue.enqueue(frame);
+    if (image.format() == QImage::Format_RGB32)
+        return image.copy();
+
+    return image.convertToFormat(QImage::Format_RGB32);
+}
+
+/**
+ * Queue a copy of the given image for encoding. Called from the GUI thread.
+ *
+ * The pixels are copied into a recycled buffer, so the caller's image is never
+ * shared with the encoder and painting into it again doesn't trigger a deep copy.
+ */
+void UBFFmpegVideoEncoderWorker::queueVideoFrame(const QImage& image, long timestamp)
+{
+    if (image.isNull())
+        return;
+
+    QImage buffer;
+
+    mFrameQueueMutex.lock();
+    if (!mFreeCaptureBuffers.isEmpty())
+        buffer = mFreeCaptureBuffers.takeLast();
+    else if (mCaptureBufferCount < sMaxCaptureBuffers)
+        ++mCaptureBufferCount;
+    else if (!mImageQueue.isEmpty()) {
+        // The encoder is behind: overwrite the newest waiting frame rather
+        // than the current one, so the latest state is never lost
+        UBFFmpegVideoEncoder::ImageFrame& newest = mImageQueue.last();
+        if (newest.image.size() == image.size() && image.format() == QImage::Format_RGB32)
+            memcpy(newest.image.bits(), image.constBits(), image.byteCount());
+        else
+            newest.image = detachedRgb32Copy(image);
+        newest.timestamp = timestamp;
+        ++mDroppedFrameCount;
+        mFrameQueueMutex.unlock();
+        return;
+    }
+    else {
+        ++mDroppedFrameCount;
         mFrameQueueMutex.unlock();
+        return;
     }
+    mFrameQueueMutex.unlock();
+
+    if (buffer.size() != image.size() || image.format() != QImage::Format_RGB32)
+        buffer = detachedRgb32Copy(image);
+    else
+        memcpy(buffer.bits(), image.constBits(), image.byteCount());
+
+    QMutexLocker locker(&mFrameQueueMutex);
+    mImageQueue.enqueue({buffer, timestamp});
+    buffer = QImage();
+    mWaitCondition.wakeAll();
 }
 
 void UBFFmpegVideoEncoderWorker::queueAudioFrame(AVFrame* frame)
@@ -724,32 +854,58 @@ void UBFFmpegVideoEncoderWorker::runEncoding()
 
     while (!mStopRequested) {
         mFrameQueueMutex.lock();
-        mWaitCondition.wait(&mFrameQueueMutex);
-
-        while (!mImageQueue.isEmpty()) {
-            writeLatestVideoFrame();
-        }
-
-        while (!mAudioQueue.isEmpty()) {
-            writeLatestAudioFrame();
-        }
-
+        if (mImageQueue.isEmpty() && mAudioQueue.isEmpty() && !mStopRequested)
+            mWaitCondition.wait(&mFrameQueueMutex);
         mFrameQueueMutex.unlock();
+
+        // Frames are taken one at a time, so the GUI thread can keep queueing
+        // while the previous frame is being converted and encoded
+        while (writeLatestVideoFrame()) {}
+        while (writeLatestAudioFrame()) {}
     }
 
+    // Write what was queued before the stop request, including the last frame
+    while (writeLatestVideoFrame()) {}
+    while (writeLatestAudioFrame()) {}
+
     emit encodingFinished();
 }
 
-void UBFFmpegVideoEncoderWorker::writeLatestVideoFrame()
+bool UBFFmpegVideoEncoderWorker::writeLatestVideoFrame()
 {
-    AVFrame* frame = mImageQueue.dequeue();
-    writeFrame(frame, mVideoPacket, mController->mVideoStream, mController->mOutputFormatContext);
-    av_frame_free(&frame);
+    mFrameQueueMutex.lock();
+    if (mImageQueue.isEmpty()) {
+        mFrameQueueMutex.unlock();
+        return false;
+    }
+    UBFFmpegVideoEncoder::ImageFrame frame = mImageQueue.dequeue();
+    mFrameQueueMutex.unlock();
+
+    AVFrame* avFrame = mController->convertImageFrame(frame, mVideoFrame);
+
+    // Give the buffer back; our reference must be gone before the GUI thread
+    // writes into it again, or it would detach
+    mFrameQueueMutex.lock();
+    mFreeCaptureBuffers.append(frame.image);
+    frame.image = QImage();
+    mFrameQueueMutex.unlock();
+
+    if (avFrame)
+        writeFrame(avFrame, mVideoPacket, mController->mVideoStream, mController->mOutputFormatContext);
+
+    return true;
 }
 
-void UBFFmpegVideoEncoderWorker::writeLatestAudioFrame()
+bool UBFFmpegVideoEncoderWorker::writeLatestAudioFrame()
 {
+    mFrameQueueMutex.lock();
+    if (mAudioQueue.isEmpty()) {
+        mFrameQueueMutex.unlock();
+        return false;
+    }
     AVFrame *frame = mAudioQueue.dequeue();
+    mFrameQueueMutex.unlock();
+
     writeFrame(frame, mAudioPacket, mController->mAudioStream, mController->mOutputFormatContext);
     av_frame_free(&frame);
 
@@ -759,4 +915,6 @@ void UBFFmpegVideoEncoderWorker::writeLatestAudioFrame()
         audio_samples_buffer = NULL;
     }
 #endif
+
+    return true;
 }
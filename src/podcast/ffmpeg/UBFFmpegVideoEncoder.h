@@ -105,7 +105,7 @@ private:
         long timestamp; // unit: ms
     };
 
-    AVFrame* convertImageFrame(ImageFrame frame);
+    AVFrame* convertImageFrame(const ImageFrame& frame, AVFrame* avFrame);
     AVFrame* convertAudio(QByteArray data);
     void processAudio(QByteArray& data);
     bool init();
@@ -123,11 +123,14 @@ private:
 
     // Video
     // ------------------------------------------
-    QQueue<ImageFrame> mPendingFrames;
     struct SwsContext * mSwsContext;
 
     int mVideoTimebase;
 
+    /// Longest time between two keyframes, see convertImageFrame
+    long mKeyframeIntervalMs;
+    long mLastKeyframeTimestamp;
+
     // Audio
     // ------------------------------------------
     bool mShouldRecordAudio;
@@ -156,7 +159,7 @@ public:
 
     bool isRunning() { return mIsRunning; }
 
-    void queueVideoFrame(AVFrame* frame);
+    void queueVideoFrame(const QImage& image, long timestamp);
     void queueAudioFrame(AVFrame* frame);
 
 public slots:
@@ -168,8 +171,8 @@ signals:
     void error(QString message);
 
 private:
-    void writeLatestVideoFrame();
-    void writeLatestAudioFrame();
+    bool writeLatestVideoFrame();
+    bool writeLatestAudioFrame();
 
     UBFFmpegVideoEncoder* mController;
 
@@ -178,12 +181,22 @@ private:
     std::atomic<bool> mStopRequested;
     std::atomic<bool> mIsRunning;
 
-    QQueue<AVFrame*> mImageQueue;
+    /// Captured frames waiting to be converted and encoded
+    QQueue<UBFFmpegVideoEncoder::ImageFrame> mImageQueue;
     QQueue<AVFrame*> mAudioQueue;
 
+    /// Capture buffers given back by the worker once converted, reused by queueVideoFrame
+    QList<QImage> mFreeCaptureBuffers;
+    int mCaptureBufferCount;
+    /// Frames replaced in the queue because the encoder was falling behind
+    int mDroppedFrameCount;
+
     QMutex mFrameQueueMutex;
     QWaitCondition mWaitCondition;
 
+    /// Conversion target, reused for every video frame
+    AVFrame* mVideoFrame;
+
     AVPacket* mVideoPacket;
     AVPacket* mAudioPacket;
 };